@@ -1,27 +1,187 @@
+#define RA2OB_COUNT_ALLOCATIONS  // So debug mode can check the fetch, see AllocCounter.
 #include "Ra2ob"
 
+/**
+ * Look for a value in the game's memory from the console, see Ra2ob::ValueSearch.
+ */
+int runSearch(Ra2ob::Game& g, Ra2ob::FieldType type, int size) {
+    Ra2ob::ValueSearch search(type, size);
+
+    g.getHandle();
+    if (g.r.getHandle() == nullptr) {
+        return 1;
+    }
+
+    std::cout << "s: snapshot, = v: equal, !: changed, ~: unchanged, +: increased, "
+                 "-: decreased, d v: changed by, p: print, q: quit"
+              << std::endl;
+
+    std::string line;
+
+    while (std::cout << "> " << std::flush && std::getline(std::cin, line)) {
+        std::istringstream ss(line);
+        std::string cmd;
+        double operand = 0;
+        ss >> cmd >> operand;
+
+        Ra2ob::SearchOp op;
+        auto start = std::chrono::steady_clock::now();
+
+        if (cmd == "q") {
+            break;
+        } else if (cmd == "p") {
+            g.initAddrs();
+
+            std::array<uint32_t, Ra2ob::MAXPLAYER> bases{};
+            for (int i = 0; i < Ra2ob::MAXPLAYER; i++) {
+                bases[i] = g._players[i] ? g._playerBases[i] : 0;
+            }
+
+            std::cout << search.toConfig(bases).dump(4) << std::endl;
+            continue;
+        } else if (cmd == "s") {
+            search.snapshot(g.r);
+        } else if (Ra2ob::ValueSearch::parseOp(cmd, &op) && search.bytes() != 0) {
+            search.filter(g.r, op, operand);
+        } else {
+            continue;
+        }
+
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+        std::cout << search.count() << " candidates in " << (search.bytes() >> 20) << " MB, "
+                  << ms << " ms" << std::endl;
+    }
+
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
-    int runMode = 0;
+    int runMode     = 0;
+    bool trace      = false;
+    bool traceReads = false;
+    bool readLog    = false;
+    bool pages      = false;
+
+    Ra2ob::FieldType searchType = Ra2ob::FieldType::Int;
+    int searchSize              = 4;
 
     if (argc > 1) {
         for (int i = 0; i < argc; i++) {
             if (std::strcmp(argv[i], "debug") == 0) {
                 runMode = 2;
             }
+            if (std::strcmp(argv[i], "trace") == 0) {
+                // trace [reads], the first TRACESECONDS into F_TRACE.
+                trace      = true;
+                traceReads = i + 1 < argc && std::strcmp(argv[i + 1], "reads") == 0;
+            }
+            if (std::strcmp(argv[i], "pages") == 0) {
+                // Read only the pages the game wrote, see PageCache.
+                pages = true;
+            }
+            if (std::strcmp(argv[i], "readlog") == 0) {
+                // Every read into F_READLOG, for ra2ob_replay.
+                readLog = true;
+            }
+            if (std::strcmp(argv[i], "multi") == 0) {
+                runMode = 3;
+            }
+            if (std::strcmp(argv[i], "learn") == 0) {
+                runMode = 4;
+            }
+            if (std::strcmp(argv[i], "search") == 0) {
+                runMode = 5;
+
+                // search [Type [Size]]
+                if (i + 1 < argc && Ra2ob::PathPlan::parseFieldType(argv[i + 1], &searchType)) {
+                    searchSize = i + 2 < argc ? std::atoi(argv[i + 2])
+                                              : Ra2ob::PathPlan::defaultSize(searchType);
+                }
+            }
+        }
+    }
+
+    if (runMode == 3) {
+        Ra2ob::SessionPool pool;
+        Ra2ob::Viewer viewer;
+
+        pool.start();
+
+        while (true) {
+            Sleep(Ra2ob::T_PRINTTIME);
+            system("cls");
+
+            for (auto& s : pool.getSessions()) {
+                std::shared_ptr<const Ra2ob::tagGameInfo> gi = s->snapshot();
+
+                std::cout << "[pid " << s->getPid() << "]" << std::endl;
+                if (gi->valid) {
+                    viewer.print(*gi, 0);
+                }
+            }
         }
     }
 
     Ra2ob::Game& g = Ra2ob::Game::getInstance();
 
+    if (runMode == 4) {
+        g.getHandle();
+        return g.r.getHandle() != nullptr && g.learnSignatures() ? 0 : 1;
+    }
+
+    if (runMode == 5) {
+        return runSearch(g, searchType, searchSize);
+    }
+
+    if (runMode == 2) {
+        g.checkAllocations();
+    }
+
+    if (trace) {
+        Ra2ob::Tracer::start(traceReads);
+    }
+
+    g._trackDirtyPages = pages;
+
+    if (readLog && !g.startReadLog()) {
+        return 1;
+    }
+
     g.startLoop();
 
+    auto traceEnd = std::chrono::steady_clock::now() + std::chrono::seconds(Ra2ob::TRACESECONDS);
+
     while (true) {
         Sleep(Ra2ob::T_PRINTTIME);
 
+        if (trace && std::chrono::steady_clock::now() >= traceEnd) {
+            Ra2ob::Tracer::stop();
+            if (Ra2ob::Tracer::save()) {
+                std::cout << "Trace written to " << Ra2ob::F_TRACE << std::endl;
+            }
+            trace = false;
+        }
+
         if (g._gameInfo.valid) {
             system("cls");
             if (runMode == 2) {
                 std::cout << "[Debug]" << std::endl;
+                g._latency.delivered(g._gameInfo.stamp);
+                Ra2ob::printProfile(g.profile());
+                Ra2ob::printLatency(g._latency);
+
+                Ra2ob::tagCaptureStats captures = g.captureStats();
+                std::cout << "Captures within one frame: " << captures.rate * 100 << "%, "
+                          << captures.retried << " retried, " << captures.torn << " torn"
+                          << std::endl;
+
+                Ra2ob::tagPageCacheStats pages = g._pageCache.stats();
+                std::cout << "Pages cached: " << pages.pages << ", "
+                          << pages.clean * 100 / std::max<uint64_t>(pages.clean + pages.loaded, 1)
+                          << "% reused unread" << std::endl;
             }
             g.viewer.print(g._gameInfo, runMode);
         }
@@ -0,0 +1,147 @@
+#ifndef RA2OB_SRC_ALLOC_HPP_
+#define RA2OB_SRC_ALLOC_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace Ra2ob {
+
+/**
+ * Counts global heap allocations made by the threads attributed to it, see AllocScope.
+ *
+ * Counting needs the program's operator new, which one translation unit provides by
+ * defining RA2OB_COUNT_ALLOCATIONS before including Ra2ob. Only one may define it.
+ * Without it, nothing is counted and available() stays false.
+ */
+class AllocCounter {
+public:
+    AllocCounter();
+
+    AllocCounter(const AllocCounter&)   = delete;
+    void operator=(const AllocCounter&) = delete;
+
+    uint64_t count() const;
+
+    static bool available();
+    static AllocCounter* current();
+    static void note();
+
+private:
+    friend class AllocScope;
+
+    static AllocCounter*& threadCounter();
+    static std::atomic<bool>& hooked();
+
+    std::atomic<uint64_t> m_count{0};
+};
+
+/**
+ * Attribute the calling thread's allocations to a counter while in scope, nullptr for
+ * none. Scopes nest.
+ */
+class AllocScope {
+public:
+    explicit AllocScope(AllocCounter* counter);
+    ~AllocScope();
+
+    AllocScope(const AllocScope&)     = delete;
+    void operator=(const AllocScope&) = delete;
+
+private:
+    AllocCounter* m_previous;
+};
+
+/**
+ * Source Code
+ */
+
+inline AllocCounter::AllocCounter() {}
+
+inline uint64_t AllocCounter::count() const { return m_count.load(std::memory_order_relaxed); }
+
+/**
+ * Whether allocations are counted at all, once the program has allocated anything.
+ */
+inline bool AllocCounter::available() { return hooked().load(std::memory_order_relaxed); }
+
+inline AllocCounter* AllocCounter::current() { return threadCounter(); }
+
+/**
+ * Called by operator new on every allocation.
+ */
+inline void AllocCounter::note() {
+    AllocCounter* counter = threadCounter();
+
+    if (counter != nullptr) {
+        counter->m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!hooked().load(std::memory_order_relaxed)) {
+        hooked().store(true, std::memory_order_relaxed);
+    }
+}
+
+inline AllocCounter*& AllocCounter::threadCounter() {
+    static thread_local AllocCounter* counter = nullptr;
+    return counter;
+}
+
+inline std::atomic<bool>& AllocCounter::hooked() {
+    static std::atomic<bool> ret{false};
+    return ret;
+}
+
+inline AllocScope::AllocScope(AllocCounter* counter) {
+    m_previous                    = AllocCounter::threadCounter();
+    AllocCounter::threadCounter() = counter;
+}
+
+inline AllocScope::~AllocScope() { AllocCounter::threadCounter() = m_previous; }
+
+}  // end of namespace Ra2ob
+
+#ifdef RA2OB_COUNT_ALLOCATIONS
+// Kept out of line: inlined into their callers, GCC pairs malloc() in one with free() in
+// another and warns about every new/delete it sees (-Wmismatched-new-delete).
+#if defined(__GNUC__)
+#define RA2OB_ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define RA2OB_ALLOC_NOINLINE
+#endif
+
+RA2OB_ALLOC_NOINLINE void* operator new(std::size_t size) {
+    Ra2ob::AllocCounter::note();
+
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+RA2OB_ALLOC_NOINLINE void* operator new[](std::size_t size) { return operator new(size); }
+
+RA2OB_ALLOC_NOINLINE void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    Ra2ob::AllocCounter::note();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+RA2OB_ALLOC_NOINLINE void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+RA2OB_ALLOC_NOINLINE void operator delete(void* p) noexcept { std::free(p); }
+
+RA2OB_ALLOC_NOINLINE void operator delete[](void* p) noexcept { std::free(p); }
+
+RA2OB_ALLOC_NOINLINE void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+RA2OB_ALLOC_NOINLINE void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+#endif
+
+#endif  // RA2OB_SRC_ALLOC_HPP_
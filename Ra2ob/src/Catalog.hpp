@@ -0,0 +1,259 @@
+#ifndef RA2OB_SRC_CATALOG_HPP_
+#define RA2OB_SRC_CATALOG_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Datatypes.hpp"
+#include "./Reader.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+constexpr int CATALOGKINDS = 4;
+
+constexpr UnitType CATALOGTYPES[CATALOGKINDS] = {UnitType::Building, UnitType::Infantry,
+                                                 UnitType::Tank, UnitType::Aircraft};
+
+constexpr const char* CATALOGKEYS[CATALOGKINDS] = {"Building", "Infantry", "Tank", "Aircraft"};
+
+/**
+ * The IDs of every building, infantry, vehicle and aircraft type the running game loaded,
+ * in array index order, which is also the order of the per-house count vectors.
+ *
+ * Discovery takes three batches of reads: the array headers, the type pointers, and the
+ * IDs. A catalog is cached on disk per game executable, and reused as long as the array
+ * sizes still match, since a map may add types of its own.
+ */
+class UnitCatalog {
+public:
+    UnitCatalog();
+
+    static bool readCounts(Reader r, const tagGlobals& globals,
+                           std::array<uint32_t, CATALOGKINDS>* counts);
+    bool discover(Reader r, const tagGlobals& globals);
+
+    bool load(const std::string& filePath);
+    bool save(const std::string& filePath);
+    void clear();
+
+    bool empty() const;
+    size_t size() const;
+    const std::array<uint32_t, CATALOGKINDS>& getCounts() const;
+    tagUnits merge(const tagUnits& configured) const;
+
+    static std::array<uint32_t, CATALOGKINDS> typeArrays(const tagGlobals& globals);
+
+private:
+    std::array<uint32_t, CATALOGKINDS> m_counts;
+    std::array<std::vector<std::string>, CATALOGKINDS> m_ids;
+};
+
+/**
+ * Source Code
+ */
+
+inline UnitCatalog::UnitCatalog() { clear(); }
+
+/**
+ * Sizes of the four type arrays, false if unreadable or still empty.
+ */
+inline bool UnitCatalog::readCounts(Reader r, const tagGlobals& globals,
+                                    std::array<uint32_t, CATALOGKINDS>* counts) {
+    std::array<uint32_t, CATALOGKINDS> arrays = typeArrays(globals);
+    tagReadRequest reqs[CATALOGKINDS];
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        reqs[k] = {arrays[k] + TYPESCOUNTOFFSET, &(*counts)[k], 4, false};
+    }
+
+    if (!r.readBatch(reqs, CATALOGKINDS)) {
+        return false;
+    }
+
+    for (uint32_t c : *counts) {
+        if (c > UNITSAFE) {
+            return false;
+        }
+    }
+
+    return (*counts)[0] != 0;
+}
+
+inline bool UnitCatalog::discover(Reader r, const tagGlobals& globals) {
+    std::array<uint32_t, CATALOGKINDS> arrays = typeArrays(globals);
+    std::array<uint32_t, CATALOGKINDS> items;
+    std::array<uint32_t, CATALOGKINDS> counts;
+    std::vector<tagReadRequest> reqs;
+
+    if (!readCounts(r, globals, &counts)) {
+        return false;
+    }
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        reqs.push_back({arrays[k] + TYPESITEMSOFFSET, &items[k], 4, false});
+    }
+
+    if (!r.readBatch(reqs.data(), reqs.size())) {
+        return false;
+    }
+
+    std::array<std::vector<uint32_t>, CATALOGKINDS> types;
+    reqs.clear();
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        types[k].resize(counts[k]);
+
+        if (counts[k] != 0) {
+            reqs.push_back({items[k], types[k].data(), counts[k] * 4, false});
+        }
+    }
+
+    if (!r.readBatch(reqs.data(), reqs.size())) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (auto& t : types) {
+        total += t.size();
+    }
+
+    std::vector<char> ids(total * TYPEIDSIZE, '\0');
+    reqs.clear();
+
+    for (int k = 0, n = 0; k < CATALOGKINDS; k++) {
+        for (uint32_t type : types[k]) {
+            reqs.push_back({type + TYPEIDOFFSET, &ids[n++ * TYPEIDSIZE], TYPEIDSIZE, false});
+        }
+    }
+
+    // A missing ID only loses its own type.
+    r.readBatch(reqs.data(), reqs.size());
+
+    for (int k = 0, n = 0; k < CATALOGKINDS; k++) {
+        m_ids[k].clear();
+
+        for (size_t i = 0; i < types[k].size(); i++, n++) {
+            const char* id = &ids[n * TYPEIDSIZE];
+            m_ids[k].push_back(reqs[n].ok ? std::string(id, strnlen(id, TYPEIDSIZE)) : "");
+        }
+    }
+
+    m_counts = counts;
+
+    return true;
+}
+
+inline bool UnitCatalog::load(const std::string& filePath) {
+    std::ifstream f(filePath);
+    json data;
+
+    if (!f) {
+        return false;
+    }
+
+    try {
+        data = json::parse(f);
+
+        std::array<uint32_t, CATALOGKINDS> counts;
+        std::array<std::vector<std::string>, CATALOGKINDS> ids;
+
+        for (int k = 0; k < CATALOGKINDS; k++) {
+            ids[k]    = data.at(CATALOGKEYS[k]).get<std::vector<std::string>>();
+            counts[k] = static_cast<uint32_t>(ids[k].size());
+        }
+
+        m_counts = counts;
+        m_ids    = ids;
+    } catch (const json::exception& e) {
+        std::cerr << filePath << ": " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+inline bool UnitCatalog::save(const std::string& filePath) {
+    json data;
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        data[CATALOGKEYS[k]] = m_ids[k];
+    }
+
+    std::ofstream f(filePath);
+    f << data.dump(1);
+
+    if (!f) {
+        std::cerr << "Could not write " << filePath << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+inline void UnitCatalog::clear() {
+    m_counts = std::array<uint32_t, CATALOGKINDS>{};
+
+    for (auto& ids : m_ids) {
+        ids.clear();
+    }
+}
+
+inline bool UnitCatalog::empty() const { return m_counts[0] == 0; }
+
+inline size_t UnitCatalog::size() const {
+    size_t ret = 0;
+
+    for (auto& ids : m_ids) {
+        ret += ids.size();
+    }
+
+    return ret;
+}
+
+inline const std::array<uint32_t, CATALOGKINDS>& UnitCatalog::getCounts() const {
+    return m_counts;
+}
+
+/**
+ * The configured units plus every discovered type none of them covers, named by its ID.
+ * Configured entries keep their display name, index and visibility.
+ */
+inline tagUnits UnitCatalog::merge(const tagUnits& configured) const {
+    tagUnits ret = configured;
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        for (size_t i = 0; i < m_ids[k].size(); i++) {
+            uint32_t offset = static_cast<uint32_t>(i * 4);
+            uint64_t key    = tagUnits::key(offset, CATALOGTYPES[k]);
+
+            if (m_ids[k][i].empty() || configured.index.count(key) != 0) {
+                continue;
+            }
+
+            ret.items.push_back(
+                Unit(NamePool::intern(m_ids[k][i]), offset, CATALOGTYPES[k], 99, true));
+        }
+    }
+
+    ret.buildIndex();
+
+    return ret;
+}
+
+/**
+ * The type arrays in CATALOGTYPES order.
+ */
+inline std::array<uint32_t, CATALOGKINDS> UnitCatalog::typeArrays(const tagGlobals& globals) {
+    return {{globals.buildingTypes, globals.infantryTypes, globals.unitTypes,
+             globals.aircraftTypes}};
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_CATALOG_HPP_
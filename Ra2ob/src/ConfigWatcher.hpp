@@ -0,0 +1,274 @@
+#ifndef RA2OB_SRC_CONFIGWATCHER_HPP_
+#define RA2OB_SRC_CONFIGWATCHER_HPP_
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Platform.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+/**
+ * Calls back on its own thread when any of the watched files changes.
+ *
+ * The directories are watched rather than the files, since editors often replace a file
+ * instead of writing it. Events are filtered by comparing each file's mtime and size, and
+ * the callback runs once the writes have settled for T_SETTLETIME.
+ */
+class ConfigWatcher {
+public:
+    using Callback = std::function<void()>;
+
+    ConfigWatcher(std::vector<std::string> files, Callback onChange);
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher&)  = delete;
+    void operator=(const ConfigWatcher&) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning();
+
+private:
+    static std::string dirOf(const std::string& filePath);
+    bool changed();
+    void run();
+
+    std::vector<std::string> m_files;
+    std::vector<std::string> m_dirs;
+    std::vector<std::pair<int64_t, int64_t>> m_stamps;
+    Callback m_onChange;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+
+#ifdef _WIN32
+    HANDLE m_stopEvent = nullptr;
+    std::vector<HANDLE> m_handles;
+#else
+    int m_inotify     = -1;
+    int m_stopPipe[2] = {-1, -1};
+#endif
+};
+
+/**
+ * Source Code
+ */
+
+inline ConfigWatcher::ConfigWatcher(std::vector<std::string> files, Callback onChange)
+    : m_files(files), m_onChange(onChange) {
+    for (auto& f : m_files) {
+        std::string dir = dirOf(f);
+
+        if (std::find(m_dirs.begin(), m_dirs.end(), dir) == m_dirs.end()) {
+            m_dirs.push_back(dir);
+        }
+    }
+
+    m_stamps.resize(m_files.size());
+    changed();
+}
+
+inline ConfigWatcher::~ConfigWatcher() { stop(); }
+
+inline bool ConfigWatcher::start() {
+    if (m_running) {
+        return true;
+    }
+
+#ifdef _WIN32
+    m_stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+
+    for (auto& dir : m_dirs) {
+        HANDLE h = FindFirstChangeNotificationA(
+            dir.c_str(), FALSE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE);
+
+        if (h == INVALID_HANDLE_VALUE) {
+            std::cerr << "Could not watch " << dir << "\n";
+            continue;
+        }
+        m_handles.push_back(h);
+    }
+
+    if (m_stopEvent == nullptr || m_handles.empty()) {
+        stop();
+        return false;
+    }
+#else
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (m_inotify < 0 || pipe(m_stopPipe) != 0) {
+        std::cerr << "Could not start inotify\n";
+        stop();
+        return false;
+    }
+
+    int watched = 0;
+    for (auto& dir : m_dirs) {
+        uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+
+        if (inotify_add_watch(m_inotify, dir.c_str(), mask) < 0) {
+            std::cerr << "Could not watch " << dir << "\n";
+            continue;
+        }
+        watched++;
+    }
+
+    if (watched == 0) {
+        stop();
+        return false;
+    }
+#endif
+
+    m_running = true;
+    m_thread  = std::thread(&ConfigWatcher::run, this);
+
+    return true;
+}
+
+inline void ConfigWatcher::stop() {
+#ifdef _WIN32
+    if (m_stopEvent != nullptr) {
+        SetEvent(m_stopEvent);
+    }
+#else
+    if (m_stopPipe[1] >= 0) {
+        char c = 0;
+        (void)!write(m_stopPipe[1], &c, 1);
+    }
+#endif
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    m_running = false;
+
+#ifdef _WIN32
+    for (HANDLE h : m_handles) {
+        FindCloseChangeNotification(h);
+    }
+    m_handles.clear();
+
+    if (m_stopEvent != nullptr) {
+        CloseHandle(m_stopEvent);
+        m_stopEvent = nullptr;
+    }
+#else
+    int* fds[] = {&m_inotify, &m_stopPipe[0], &m_stopPipe[1]};
+
+    for (int* fd : fds) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+#endif
+}
+
+inline bool ConfigWatcher::isRunning() { return m_running; }
+
+inline std::string ConfigWatcher::dirOf(const std::string& filePath) {
+    size_t slash = filePath.find_last_of("/\\");
+
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : filePath.substr(0, slash);
+}
+
+/**
+ * Re-stamp every file, true if any of them differs from the last stamp.
+ */
+inline bool ConfigWatcher::changed() {
+    bool ret = false;
+
+    for (size_t i = 0; i < m_files.size(); i++) {
+        std::pair<int64_t, int64_t> stamp(0, -1);
+        statFile(m_files[i], &stamp.first, &stamp.second);
+
+        if (stamp != m_stamps[i]) {
+            m_stamps[i] = stamp;
+            ret         = true;
+        }
+    }
+
+    return ret;
+}
+
+inline void ConfigWatcher::run() {
+#ifdef _WIN32
+    std::vector<HANDLE> handles = m_handles;
+    handles.push_back(m_stopEvent);
+
+    DWORD count = static_cast<DWORD>(handles.size());
+
+    while (true) {
+        DWORD ret = WaitForMultipleObjects(count, handles.data(), FALSE, INFINITE);
+
+        if (ret == WAIT_FAILED || ret == WAIT_OBJECT_0 + count - 1) {
+            break;
+        }
+
+        FindNextChangeNotification(handles[ret - WAIT_OBJECT_0]);
+
+        if (WaitForSingleObject(m_stopEvent, T_SETTLETIME) == WAIT_OBJECT_0) {
+            break;
+        }
+
+        if (changed()) {
+            m_onChange();
+        }
+    }
+#else
+    struct pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_stopPipe[0], POLLIN, 0}};
+    char buf[4096];
+
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        // Drain the events, then give the writer time to finish.
+        while (read(m_inotify, buf, sizeof(buf)) > 0) {
+        }
+
+        if (poll(&fds[1], 1, T_SETTLETIME) > 0) {
+            break;
+        }
+
+        while (read(m_inotify, buf, sizeof(buf)) > 0) {
+        }
+
+        if (changed()) {
+            m_onChange();
+        }
+    }
+#endif
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_CONFIGWATCHER_HPP_
@@ -1,6 +1,7 @@
 #ifndef RA2OB_SRC_CONSTANTS_HPP_
 #define RA2OB_SRC_CONSTANTS_HPP_
 
+#include <cstdint>
 #include <map>
 #include <string>
 
@@ -105,11 +106,39 @@ constexpr int P_UNITTYPEOFFSET     = 0x6C4;
 
 constexpr int P_ARRAYINDEXOFFSET = 0xDF8;
 
+// Type Array Offsets, DynamicVectorClass<TechnoTypeClass*> per kind
+
+constexpr int BUILDINGTYPESOFFSET = 0xa83c68;
+constexpr int INFANTRYTYPESOFFSET = 0xa8e348;
+constexpr int UNITTYPESOFFSET     = 0xa83ce0;
+constexpr int AIRCRAFTTYPESOFFSET = 0xa8b218;
+
+constexpr int TYPESITEMSOFFSET = 0x4;
+constexpr int TYPESCOUNTOFFSET = 0x10;
+
+constexpr int TYPEIDOFFSET = 0x24;
+constexpr int TYPEIDSIZE   = 0x18;
+
+// Executable Image
+
+constexpr int IMAGEBASE     = 0x400000;
+constexpr int PEHEADERSIZE  = 0x1000;
+constexpr int PECODESECTION = 0x20000020;  // IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE.
+constexpr int PEMAXSECTION  = 0x4000000;
+
+// Value Search
+
+constexpr int SEARCHPAGESIZE    = 0x1000;
+constexpr int SEARCHPLAYERSPAN  = 0x20000;  // Candidates this far past a player base are its.
+constexpr int SEARCHMAXPRINT    = 64;
+constexpr double SEARCHFLOATEPS = 0.001;
+
 // Time Ints
 
 constexpr int T_DETECTTIME = 1000;
 constexpr int T_FETCHTIME  = 500;
 constexpr int T_PRINTTIME  = 500;
+constexpr int T_SETTLETIME = 200;
 
 // Color Codes
 
@@ -189,11 +218,111 @@ enum class DisplayMode : int {
     StretchedFullscreen = 1,
     Unknown             = 0,
 };
+enum class FieldType : int { Int = 0, Uint = 1, Bool = 2, Float = 3 };
+
+// Offset tables, see tools/gen_offsets.cpp
+
+struct tagNumericEntry {
+    const char* name;
+    uint32_t offset;
+};
+
+struct tagUnitEntry {
+    const char* name;
+    uint32_t offset;
+    UnitType type;
+    int index;
+    bool show;
+    const char* invalid;  // "", "Yr" or "Ra2".
+};
+
+constexpr int PATHMAXDEPTH = 8;
+
+struct tagPathEntry {
+    const char* name;
+    uint32_t path[PATHMAXDEPTH];
+    int depth;
+    FieldType type;
+    int size;
+};
 
 // Files
 
+constexpr char F_GAMEEXE[] = "gamemd-spawn.exe";
+
 constexpr char F_PANELOFFSETS[] = "./config/panel_offsets.json";
 constexpr char F_UNITOFFSETS[]  = "./config/unit_offsets.json";
+constexpr char F_SIGNATURES[]   = "./config/signatures.json";
+constexpr char F_CACHEDIR[]     = "./cache";
+constexpr char F_TRACE[]        = "./trace.json";
+constexpr char F_READLOG[]      = "./reads.rl";
+
+// Timeline
+
+constexpr char TL_MAGIC[]      = "RA2OBTL1";
+constexpr char TL_INDEXMAGIC[] = "RA2OBIX1";
+constexpr int TL_KEYINTERVAL   = 120;
+
+// Read Log
+
+constexpr char RL_MAGIC[]  = "RA2OBRL1";
+constexpr int RL_FLUSHSIZE = 1 << 16;  // Written out at the next mark past this.
+
+// History
+
+constexpr int HISTORYMINUTES = 5;
+
+// Snapshot
+
+constexpr int SNAPNAMESIZE       = 0x60;  // A player name of STRNAMESIZE chars as UTF-8.
+constexpr int SNAPCOUNTRYSIZE    = 0x20;
+constexpr int SNAPMAPNAMESIZE    = 0x80;
+constexpr int SNAPMAXUNITS       = 4 * UNITSAFE;  // Every type a catalog can hold.
+constexpr int SNAPMAXPLAYERUNITS = 512;           // Types a player has any of.
+constexpr int SNAPMAXBUILDINGS   = 6;             // One per production queue.
+constexpr int SNAPMAXSUPERS      = 16;
+constexpr int SNAPMAXFIELDS      = 16;
+
+// Capture
+
+constexpr int CAPTURERETRIES = 2;  // Refreshes again while the frame moves during one.
+
+// Page Cache
+
+constexpr int PAGECACHESHIFT   = 12;
+constexpr int PAGECACHESIZE    = 1 << PAGECACHESHIFT;
+constexpr int PAGECACHEIDLE    = 8;   // Syncs a page goes unread before it is dropped.
+constexpr int PAGECACHEREFRESH = 4;   // Every page is read again every that many syncs.
+
+// Allocation Check
+
+constexpr int ALLOCWARMUPTICKS = 8;  // Until names, plans and buffers settle.
+
+// Profiling
+
+constexpr int PROFILESUBBITS = 5;   // 32 buckets per power of two, within 3%.
+constexpr int PROFILEMAXBITS = 40;  // Up to 18 minutes in ns.
+
+// Tracing
+
+constexpr int TRACEEVENTS       = 1 << 15;  // Per thread, 1 MB.
+constexpr int TRACESPARETHREADS = 8;        // Buffers beyond one per core.
+constexpr int TRACESECONDS      = 30;       // What `ra2ob trace` records.
+
+// Emulator
+
+constexpr int EMUHEAPBASE      = 0x20000000;
+constexpr int EMUHOUSESIZE     = 0x16100;  // Up to the player name.
+constexpr int EMUTYPESIZE      = 0xe00;
+constexpr int EMUTECHNOSIZE    = 0x700;
+constexpr int EMUFACTORYSIZE   = 0x80;
+constexpr int EMUSUPERSIZE     = 0x40;
+constexpr int EMUSUPERTYPESIZE = 0x100;
+constexpr int EMUQUEUESIZE     = 8;
+constexpr int EMUBUILDSTEPS    = 54;  // Production progress of a finished unit.
+constexpr int EMUOTHERHOUSES   = 2;   // Neutral and Special, before the players.
+constexpr int EMUKILLSLOTS     = 20;  // Houses a house counts its kills of.
+constexpr int EMUTYPESPERKIND  = 64;
 
 // Strings
 
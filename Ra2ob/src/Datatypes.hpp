@@ -1,15 +1,18 @@
 #ifndef RA2OB_SRC_DATATYPES_HPP_
 #define RA2OB_SRC_DATATYPES_HPP_
 
-#include <Windows.h>
-
+#include <algorithm>
 #include <array>
 #include <codecvt>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "./PathPlan.hpp"
 #include "./Reader.hpp"
 #include "./Utils.hpp"
 
@@ -24,6 +27,7 @@ struct tagPanelInfo {
     int powerOutput           = 0;
     std::string color         = "ffffff";
     std::string country       = "";
+    json fields               = json::object();  // Path fields from panel_offsets.json.
 };
 
 struct tagStatusInfo {
@@ -119,6 +123,26 @@ struct tagDebugInfo {
     tagSetting setting;
 };
 
+// The frames a snapshot was read between and when it was read and published, steadyNs()
+// of this process. Left out of the json so that unchanged frames still diff empty;
+// consumers hand it back to LatencyTracker::delivered().
+struct tagStamp {
+    int32_t frame     = 0;  // When the capture started.
+    int32_t frameEnd  = 0;  // When it ended, frame unless the snapshot mixes frames.
+    int64_t captured  = 0;
+    int64_t published = 0;
+};
+
+// How many captures read every field within one game frame, see Game::capture().
+struct tagCaptureStats {
+    uint64_t captures   = 0;
+    uint64_t consistent = 0;
+    uint64_t retried    = 0;  // Captures that took more than one refresh.
+    uint64_t torn       = 0;  // Still mixing frames after the last retry.
+    uint64_t retries    = 0;
+    double rate         = 1;  // consistent / captures.
+};
+
 struct tagGameInfo {
     bool valid              = false;
     bool isObserver         = false;
@@ -132,21 +156,81 @@ struct tagGameInfo {
     std::string mapNameUtf  = "";
     std::array<tagPlayer, MAXPLAYER> players{};
     tagDebugInfo debug;
+    tagStamp stamp;
+};
+
+/**
+ * What is known about a game version at compile time.
+ */
+template <Version V>
+struct VersionTraits;
+
+template <>
+struct VersionTraits<Version::Yr> {
+    static const char* name() { return "Yr"; }
+};
+
+template <>
+struct VersionTraits<Version::Ra2> {
+    static const char* name() { return "Ra2"; }
+};
+
+/**
+ * Addresses of the game's globals: the offsets in Constants.hpp, unless signatures resolved
+ * them for the running executable.
+ */
+struct tagGlobals {
+    uint32_t gamePause      = GAMEPAUSEOFFSET;
+    uint32_t gameFrame      = GAMEFRAMEOFFSET;
+    uint32_t gameTime       = GAMETIMEOFFSET;
+    uint32_t fixed          = FIXEDOFFSET;
+    uint32_t classBaseArray = CLASSBASEARRAYOFFSET;
+    uint32_t superTimer     = SUPERTIMEROFFSET;
+    uint32_t buildingTypes  = BUILDINGTYPESOFFSET;
+    uint32_t infantryTypes  = INFANTRYTYPESOFFSET;
+    uint32_t unitTypes      = UNITTYPESOFFSET;
+    uint32_t aircraftTypes  = AIRCRAFTTYPESOFFSET;
+
+    // Named as in signatures.json.
+    std::vector<std::pair<const char*, uint32_t*>> fields() {
+        return {
+            {"GamePause", &gamePause},
+            {"GameFrame", &gameFrame},
+            {"GameTime", &gameTime},
+            {"Fixed", &fixed},
+            {"ClassBaseArray", &classBaseArray},
+            {"SuperTimer", &superTimer},
+            {"BuildingTypes", &buildingTypes},
+            {"InfantryTypes", &infantryTypes},
+            {"UnitTypes", &unitTypes},
+            {"AircraftTypes", &aircraftTypes},
+        };
+    }
+
+    uint32_t* find(const std::string& name) {
+        for (auto& f : fields()) {
+            if (name == f.first) {
+                return f.second;
+            }
+        }
+        return nullptr;
+    }
 };
 
 class Base {
 public:
-    Base(std::string name, uint32_t offset);
+    Base(const char* name, uint32_t offset);
     virtual ~Base();
 
-    std::string getName();
+    const char* getName() const;
+    uint32_t getOffset() const;
     uint32_t getValueByIndex(int index);
     void setValueByIndex(int index, uint32_t value);
     void fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets);
     bool validIndex(int index);
 
 protected:
-    std::string m_name;
+    const char* m_name;
     std::array<uint32_t, MAXPLAYER> m_value{};
     uint32_t m_offset;
     uint32_t m_size;
@@ -160,12 +244,15 @@ public:
 
 class Unit : public Base {
 public:
-    Unit(std::string name, uint32_t offset, UnitType ut, int index, bool show);
+    Unit(const char* name, uint32_t offset, UnitType ut, int index, bool show,
+         const char* invalid = "");
+    explicit Unit(const tagUnitEntry& entry);
     ~Unit();
 
-    UnitType getUnitType();
-    void setInvalid(std::string version);
-    bool checkOffset(int offsetCmp, UnitType type, Version version) const;
+    UnitType getUnitType() const;
+    void setInvalid(const char* version);
+    template <Version V>
+    bool isValid() const;
     bool checkShow();
     int getUnitIndex();
     void fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets,
@@ -175,27 +262,30 @@ protected:
     UnitType m_unitType;
     int m_unitIndex;
     bool m_show;
-    std::string m_invalid;
+    const char* m_invalid;
 };
 
 class StrName : public Base {
 public:
-    explicit StrName(std::string name = "Player Name", uint32_t offset = STRNAMEOFFSET);
+    explicit StrName(const char* name = "Player Name", uint32_t offset = STRNAMEOFFSET);
     ~StrName();
 
-    std::string getValueByIndex(int index);
-    std::string getValueByIndexUtf(int index);
+    const std::string& getValueByIndex(int index);
+    const std::string& getValueByIndexUtf(int index);
     void setValueByIndex(int index, std::string value);
     void fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets);
 
 protected:
+    bool readChanged(Reader r, uint32_t addr, int index);
+
     std::array<std::string, MAXPLAYER> m_value{};
     std::array<std::string, MAXPLAYER> m_value_utf{};
+    std::array<std::array<char, STRNAMESIZE>, MAXPLAYER> m_raw{};  // As last decoded.
 };
 
 class StrCountry : public StrName {
 public:
-    explicit StrCountry(std::string name = "Country", uint32_t offset = STRCOUNTRYOFFSET);
+    explicit StrCountry(const char* name = "Country", uint32_t offset = STRCOUNTRYOFFSET);
     ~StrCountry();
 
     void fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets);
@@ -203,18 +293,41 @@ public:
 
 struct tagNumerics {
     std::vector<Numeric> items;
+    std::unordered_map<std::string, size_t> index;  // Name -> item.
+    PathPlan paths;
 
-    Numeric getItem(std::string query) {
-        for (auto& it : items) {
-            if (it.getName() == query) {
-                return it;
-            }
+    void buildIndex() {
+        index.clear();
+        for (size_t i = 0; i < items.size(); i++) {
+            index.emplace(items[i].getName(), i);
         }
     }
+
+    Numeric* find(const std::string& query) {
+        auto it = index.find(query);
+        return it == index.end() ? nullptr : &items[it->second];
+    }
+
+    Numeric getItem(std::string query) {
+        Numeric* n = find(query);
+        return n == nullptr ? Numeric("", 0) : *n;
+    }
 };
 
 struct tagUnits {
     std::vector<Unit> items;
+    std::unordered_multimap<uint64_t, size_t> index;  // Type and offset -> items.
+
+    static uint64_t key(uint32_t offset, UnitType type) {
+        return static_cast<uint64_t>(type) << 32 | offset;
+    }
+
+    void buildIndex() {
+        index.clear();
+        for (size_t i = 0; i < items.size(); i++) {
+            index.emplace(key(items[i].getOffset(), items[i].getUnitType()), i);
+        }
+    }
 
     Unit getItem(std::string query) {
         for (auto& it : items) {
@@ -222,14 +335,64 @@ struct tagUnits {
                 return it;
             }
         }
+        return Unit("", 0, UnitType::Unknown, 99, false);
     }
 };
 
+constexpr int UNITSLOTS = 4;  // Building, infantry, tank and aircraft counts.
+
+/**
+ * The units as fetched for one game version. Entries the version does not have are left
+ * out when the plan is built, and the rest are grouped by the count array they are read
+ * from, so neither the fetch loops nor production lookups check the version again.
+ *
+ * Each unit also has an id, its position when listed by index, ties in load order.
+ */
+class UnitPlan {
+public:
+    static UnitPlan build(const tagUnits& units, Version version);
+    template <Version V>
+    static UnitPlan build(const tagUnits& units);
+
+    Version getVersion() const;
+    size_t size() const;
+    int findId(uint32_t offset, UnitType type) const;
+    const Unit* find(uint32_t offset, UnitType type) const;
+    Unit& getUnit(size_t id);
+    std::vector<Unit>& getUnits(UnitType type);
+
+private:
+    static int slot(UnitType type);
+
+    Version m_version = Version::Yr;
+    std::array<std::vector<Unit>, UNITSLOTS> m_units;
+    std::vector<std::pair<int, size_t>> m_order;  // Id -> unit.
+    std::unordered_map<uint64_t, int> m_index;    // tagUnits::key -> id.
+};
+
+/**
+ * Everything loaded from the offset configs, built off the fetch thread on reload. A part
+ * not loaded keeps the current one.
+ */
+struct tagOffsetTables {
+    tagNumerics numerics;
+    tagUnits units;
+    bool hasNumerics = true;
+    bool hasUnits    = true;
+};
+
+/**
+ * Lossless json conversions, used to persist and diff tagGameInfo.
+ */
+
+void to_json(json& j, const tagGameInfo& gi);
+void from_json(const json& j, tagGameInfo& gi);
+
 /**
  * Source Code
  */
 
-inline Base::Base(std::string name, uint32_t offset) {
+inline Base::Base(const char* name, uint32_t offset) {
     m_name   = name;
     m_offset = offset;
     m_size   = NUMSIZE;
@@ -237,7 +400,9 @@ inline Base::Base(std::string name, uint32_t offset) {
 
 inline Base::~Base() {}
 
-inline std::string Base::getName() { return m_name; }
+inline const char* Base::getName() const { return m_name; }
+
+inline uint32_t Base::getOffset() const { return m_offset; }
 
 inline uint32_t Base::getValueByIndex(int index) {
     if (validIndex(index)) {
@@ -275,13 +440,18 @@ inline bool Base::validIndex(int index) {
 
 inline Numeric::~Numeric() {}
 
-inline Unit::Unit(std::string name, uint32_t offset, UnitType ut, int index, bool show)
+inline Unit::Unit(const char* name, uint32_t offset, UnitType ut, int index, bool show,
+                  const char* invalid)
     : Base(name, offset) {
     m_unitType  = ut;
     m_unitIndex = index;
     m_show      = show;
+    m_invalid   = invalid;
 }
 
+inline Unit::Unit(const tagUnitEntry& entry)
+    : Unit(entry.name, entry.offset, entry.type, entry.index, entry.show, entry.invalid) {}
+
 inline Unit::~Unit() {}
 
 inline void Unit::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets,
@@ -309,23 +479,120 @@ inline void Unit::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& bas
     }
 }
 
-inline void Unit::setInvalid(std::string version) { m_invalid = version; }
-
-inline bool Unit::checkOffset(int offsetCmp, UnitType type, Version version) const {
-    bool infoMatch    = offsetCmp == m_offset && type == m_unitType;
-    bool versionMatch = (m_invalid == "") || (version == Version::Ra2 && m_invalid == "Yr") ||
-                        (version == Version::Yr && m_invalid == "Ra2");
+inline void Unit::setInvalid(const char* version) { m_invalid = version; }
 
-    return infoMatch && versionMatch;
+/**
+ * Whether the unit exists in version V, "Invalid" names the version it does not.
+ */
+template <Version V>
+inline bool Unit::isValid() const {
+    return strcmp(m_invalid, VersionTraits<V>::name()) != 0;
 }
 
 inline bool Unit::checkShow() { return m_show; }
 
-inline UnitType Unit::getUnitType() { return m_unitType; }
+inline UnitType Unit::getUnitType() const { return m_unitType; }
 
 inline int Unit::getUnitIndex() { return m_unitIndex; }
 
-inline StrName::StrName(std::string name, uint32_t offset) : Base(name, offset) {
+/**
+ * The plan for the version attach() found, the one place the version is branched on.
+ */
+inline UnitPlan UnitPlan::build(const tagUnits& units, Version version) {
+    if (version == Version::Ra2) {
+        return build<Version::Ra2>(units);
+    }
+    return build<Version::Yr>(units);
+}
+
+template <Version V>
+inline UnitPlan UnitPlan::build(const tagUnits& units) {
+    UnitPlan plan;
+    plan.m_version = V;
+
+    for (auto& u : units.items) {
+        if (!u.isValid<V>()) {
+            continue;
+        }
+
+        int s = slot(u.getUnitType());
+
+        plan.m_order.push_back(std::make_pair(s, plan.m_units[s].size()));
+        plan.m_units[s].push_back(u);
+    }
+
+    std::vector<std::pair<int, size_t>> loaded = plan.m_order;
+
+    std::stable_sort(plan.m_order.begin(), plan.m_order.end(),
+                     [&plan](const std::pair<int, size_t>& a, const std::pair<int, size_t>& b) {
+                         return plan.m_units[a.first][a.second].getUnitIndex() <
+                                plan.m_units[b.first][b.second].getUnitIndex();
+                     });
+
+    std::array<std::vector<int>, UNITSLOTS> ids;
+    for (int s = 0; s < UNITSLOTS; s++) {
+        ids[s].resize(plan.m_units[s].size());
+    }
+    for (size_t id = 0; id < plan.m_order.size(); id++) {
+        ids[plan.m_order[id].first][plan.m_order[id].second] = static_cast<int>(id);
+    }
+
+    // The first unit in load order at an offset is the one production shows.
+    for (auto& it : loaded) {
+        Unit& u = plan.m_units[it.first][it.second];
+        plan.m_index.emplace(tagUnits::key(u.getOffset(), u.getUnitType()),
+                             ids[it.first][it.second]);
+    }
+
+    return plan;
+}
+
+inline Version UnitPlan::getVersion() const { return m_version; }
+
+inline size_t UnitPlan::size() const {
+    size_t ret = 0;
+
+    for (auto& units : m_units) {
+        ret += units.size();
+    }
+
+    return ret;
+}
+
+/**
+ * Id of the unit production shows for a type index, -1 if the plan has none.
+ */
+inline int UnitPlan::findId(uint32_t offset, UnitType type) const {
+    auto it = m_index.find(tagUnits::key(offset, type));
+    return it == m_index.end() ? -1 : it->second;
+}
+
+inline const Unit* UnitPlan::find(uint32_t offset, UnitType type) const {
+    int id = findId(offset, type);
+    return id < 0 ? nullptr : &m_units[m_order[id].first][m_order[id].second];
+}
+
+inline Unit& UnitPlan::getUnit(size_t id) { return m_units[m_order[id].first][m_order[id].second]; }
+
+/**
+ * The units read from one type's count array. Unknown types are read like aircraft.
+ */
+inline std::vector<Unit>& UnitPlan::getUnits(UnitType type) { return m_units[slot(type)]; }
+
+inline int UnitPlan::slot(UnitType type) {
+    switch (type) {
+        case UnitType::Building:
+            return 0;
+        case UnitType::Infantry:
+            return 1;
+        case UnitType::Tank:
+            return 2;
+        default:
+            return 3;
+    }
+}
+
+inline StrName::StrName(const char* name, uint32_t offset) : Base(name, offset) {
     m_size = STRNAMESIZE;
 }
 
@@ -337,26 +604,50 @@ inline void StrName::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>&
             continue;
         }
 
-        wchar_t buf[STRNAMESIZE] = L"";
-        r.readMemory(baseOffsets[i] + m_offset, &buf, m_size);
+        if (!readChanged(r, baseOffsets[i] + m_offset, i)) {
+            continue;
+        }
+
+        utf16char buf[STRNAMESIZE] = {};
+        std::memcpy(buf, m_raw[i].data(), m_size);
 
         m_value[i]     = utf16ToGbk(buf);
         m_value_utf[i] = utf16ToUtf8(buf);
     }
 }
 
-inline std::string StrName::getValueByIndexUtf(int index) {
+/**
+ * Read the string's bytes for a player, true if they differ from the ones last decoded.
+ * Names only change between games, so most ticks decode nothing.
+ */
+inline bool StrName::readChanged(Reader r, uint32_t addr, int index) {
+    std::array<char, STRNAMESIZE> buf{};
+    r.readMemory(addr, buf.data(), m_size);
+
+    if (buf == m_raw[index]) {
+        return false;
+    }
+
+    m_raw[index] = buf;
+    return true;
+}
+
+inline const std::string& StrName::getValueByIndexUtf(int index) {
+    static const std::string empty;
+
     if (validIndex(index)) {
         return m_value_utf[index];
     }
-    return "";
+    return empty;
 }
 
-inline std::string StrName::getValueByIndex(int index) {
+inline const std::string& StrName::getValueByIndex(int index) {
+    static const std::string empty;
+
     if (validIndex(index)) {
         return m_value[index];
     }
-    return "";
+    return empty;
 }
 
 inline void StrName::setValueByIndex(int index, std::string value) {
@@ -365,7 +656,7 @@ inline void StrName::setValueByIndex(int index, std::string value) {
     }
 }
 
-inline StrCountry::StrCountry(std::string name, uint32_t offset) : StrName(name, offset) {
+inline StrCountry::StrCountry(const char* name, uint32_t offset) : StrName(name, offset) {
     m_size = STRCOUNTRYSIZE;
 }
 
@@ -377,9 +668,12 @@ inline void StrCountry::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER
             continue;
         }
 
-        char buf[STRCOUNTRYSIZE] = "\0";
+        if (!readChanged(r, baseOffsets[i] + m_offset, i)) {
+            continue;
+        }
 
-        r.readMemory(baseOffsets[i] + m_offset, &buf, m_size);
+        char buf[STRCOUNTRYSIZE + 1] = "\0";
+        std::memcpy(buf, m_raw[i].data(), m_size);
 
         auto it = COUNTRYMAP.find(buf);
         if (it == COUNTRYMAP.end()) {
@@ -390,6 +684,195 @@ inline void StrCountry::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER
     }
 }
 
+inline void to_json(json& j, const tagGameInfo& gi) {
+    j["valid"]        = gi.valid;
+    j["isObserver"]   = gi.isObserver;
+    j["isGameOver"]   = gi.isGameOver;
+    j["isGamePaused"] = gi.isGamePaused;
+    j["allPlayers"]   = gi.allPlayers;
+    j["leftPlayers"]  = gi.leftPlayers;
+    j["gameVersion"]  = gi.gameVersion;
+    j["currentFrame"] = gi.currentFrame;
+    j["mapName"]      = gi.mapName;
+    j["mapNameUtf"]   = gi.mapNameUtf;
+
+    json players = json::array();
+
+    for (auto& p : gi.players) {
+        json jp;
+
+        jp["valid"] = p.valid;
+
+        jp["status"]["teamNumber"]       = p.status.teamNumber;
+        jp["status"]["infantrySelfHeal"] = p.status.infantrySelfHeal;
+        jp["status"]["unitSelfHeal"]     = p.status.unitSelfHeal;
+
+        jp["panel"]["playerName"]    = p.panel.playerName;
+        jp["panel"]["playerNameUtf"] = p.panel.playerNameUtf;
+        jp["panel"]["balance"]       = p.panel.balance;
+        jp["panel"]["creditSpent"]   = p.panel.creditSpent;
+        jp["panel"]["powerDrain"]    = p.panel.powerDrain;
+        jp["panel"]["powerOutput"]   = p.panel.powerOutput;
+        jp["panel"]["color"]         = p.panel.color;
+        jp["panel"]["country"]       = p.panel.country;
+        jp["panel"]["fields"]        = p.panel.fields;
+
+        jp["units"] = json::array();
+        for (auto& u : p.units.units) {
+            jp["units"].push_back({u.unitName, u.num, u.index, u.show});
+        }
+
+        jp["building"] = json::array();
+        for (auto& b : p.building.list) {
+            jp["building"].push_back({b.name, b.number, b.progress, b.status});
+        }
+
+        jp["superTimer"] = json::array();
+        for (auto& s : p.superTimer.list) {
+            jp["superTimer"].push_back({s.name, s.total, s.left, s.status});
+        }
+
+        jp["score"] = {p.score.kills, p.score.lost, p.score.built, p.score.alive};
+
+        players.push_back(jp);
+    }
+
+    j["players"] = players;
+
+    j["debug"]["playerBase"]         = gi.debug.playerBase;
+    j["debug"]["buildingBase"]       = gi.debug.buildingBase;
+    j["debug"]["infantryBase"]       = gi.debug.infantryBase;
+    j["debug"]["tankBase"]           = gi.debug.tankBase;
+    j["debug"]["aircraftBase"]       = gi.debug.aircraftBase;
+    j["debug"]["houseType"]          = gi.debug.houseType;
+    j["debug"]["playerTeamNumber"]   = gi.debug.playerTeamNumber;
+    j["debug"]["playerDefeatFlag"]   = gi.debug.playerDefeatFlag;
+    j["debug"]["playerGameoverFlag"] = gi.debug.playerGameoverFlag;
+    j["debug"]["playerWinnerFlag"]   = gi.debug.playerWinnerFlag;
+
+    const tagSetting& st                  = gi.debug.setting;
+    j["debug"]["setting"]["pid"]          = st.pid;
+    j["debug"]["setting"]["gamePath"]     = st.gamePath;
+    j["debug"]["setting"]["platform"]     = st.platform;
+    j["debug"]["setting"]["version"]      = static_cast<int>(st.version);
+    j["debug"]["setting"]["isReplay"]     = st.isReplay;
+    j["debug"]["setting"]["mapName"]      = st.mapName;
+    j["debug"]["setting"]["screenWidth"]  = st.screenWidth;
+    j["debug"]["setting"]["screenHeight"] = st.screenHeight;
+    j["debug"]["setting"]["fullScreen"]   = st.fullScreen;
+    j["debug"]["setting"]["windowed"]     = st.windowed;
+    j["debug"]["setting"]["border"]       = st.border;
+    j["debug"]["setting"]["display"]      = st.display;
+    j["debug"]["setting"]["renderer"]     = st.renderer;
+}
+
+/**
+ * Scalars missing from j keep their defaults, missing players, units or debug parts throw
+ * json::out_of_range like any malformed value.
+ */
+inline void from_json(const json& j, tagGameInfo& gi) {
+    gi = tagGameInfo{};
+
+    gi.valid        = j.value("valid", false);
+    gi.isObserver   = j.value("isObserver", false);
+    gi.isGameOver   = j.value("isGameOver", false);
+    gi.isGamePaused = j.value("isGamePaused", false);
+    gi.allPlayers   = j.value("allPlayers", 0);
+    gi.leftPlayers  = j.value("leftPlayers", 0);
+    gi.gameVersion  = j.value("gameVersion", "Yr");
+    gi.currentFrame = j.value("currentFrame", 0);
+    gi.mapName      = j.value("mapName", "");
+    gi.mapNameUtf   = j.value("mapNameUtf", "");
+
+    if (j.contains("players")) {
+        const json& players = j.at("players");
+
+        for (int i = 0; i < MAXPLAYER && i < static_cast<int>(players.size()); i++) {
+            const json& jp = players[i];
+            tagPlayer& p   = gi.players[i];
+
+            p.valid = jp.value("valid", false);
+
+            const json& st            = jp.at("status");
+            p.status.teamNumber       = st.value("teamNumber", 0);
+            p.status.infantrySelfHeal = st.value("infantrySelfHeal", false);
+            p.status.unitSelfHeal     = st.value("unitSelfHeal", false);
+
+            const json& pn        = jp.at("panel");
+            p.panel.playerName    = pn.value("playerName", "");
+            p.panel.playerNameUtf = pn.value("playerNameUtf", "");
+            p.panel.balance       = pn.value("balance", 0);
+            p.panel.creditSpent   = pn.value("creditSpent", 0);
+            p.panel.powerDrain    = pn.value("powerDrain", 0);
+            p.panel.powerOutput   = pn.value("powerOutput", 0);
+            p.panel.color         = pn.value("color", "ffffff");
+            p.panel.country       = pn.value("country", "");
+            p.panel.fields        = pn.value("fields", json::object());
+
+            for (auto& ju : jp.at("units")) {
+                tagUnitSingle us;
+                us.unitName = ju.at(0);
+                us.num      = ju.at(1);
+                us.index    = ju.at(2);
+                us.show     = ju.at(3);
+                p.units.units.push_back(us);
+            }
+
+            for (auto& jb : jp.at("building")) {
+                tagBuildingNode bn(jb.at(0));
+                bn.number   = jb.at(1);
+                bn.progress = jb.at(2);
+                bn.status   = jb.at(3);
+                p.building.list.push_back(bn);
+            }
+
+            for (auto& js : jp.at("superTimer")) {
+                tagSuperNode sn(js.at(0), js.at(1));
+                sn.left   = js.at(2);
+                sn.status = js.at(3);
+                p.superTimer.list.push_back(sn);
+            }
+
+            const json& sc = jp.at("score");
+            p.score.kills  = sc.at(0);
+            p.score.lost   = sc.at(1);
+            p.score.built  = sc.at(2);
+            p.score.alive  = sc.at(3);
+        }
+    }
+
+    if (j.contains("debug")) {
+        const json& d = j.at("debug");
+
+        gi.debug.playerBase         = d.at("playerBase");
+        gi.debug.buildingBase       = d.at("buildingBase");
+        gi.debug.infantryBase       = d.at("infantryBase");
+        gi.debug.tankBase           = d.at("tankBase");
+        gi.debug.aircraftBase       = d.at("aircraftBase");
+        gi.debug.houseType          = d.at("houseType");
+        gi.debug.playerTeamNumber   = d.at("playerTeamNumber");
+        gi.debug.playerDefeatFlag   = d.at("playerDefeatFlag");
+        gi.debug.playerGameoverFlag = d.at("playerGameoverFlag");
+        gi.debug.playerWinnerFlag   = d.at("playerWinnerFlag");
+
+        const json& st = d.at("setting");
+        tagSetting& s  = gi.debug.setting;
+        s.pid          = st.value("pid", 0);
+        s.gamePath     = st.value("gamePath", "");
+        s.platform     = st.value("platform", "");
+        s.version      = static_cast<Version>(st.value("version", 0));
+        s.isReplay     = st.value("isReplay", false);
+        s.mapName      = st.value("mapName", "");
+        s.screenWidth  = st.value("screenWidth", 0);
+        s.screenHeight = st.value("screenHeight", 0);
+        s.fullScreen   = st.value("fullScreen", false);
+        s.windowed     = st.value("windowed", false);
+        s.border       = st.value("border", false);
+        s.display      = st.value("display", "");
+        s.renderer     = st.value("renderer", "");
+    }
+}
+
 }  // end of namespace Ra2ob
 
 #endif  // RA2OB_SRC_DATATYPES_HPP_
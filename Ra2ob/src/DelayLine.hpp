@@ -0,0 +1,244 @@
+#ifndef RA2OB_SRC_DELAYLINE_HPP_
+#define RA2OB_SRC_DELAYLINE_HPP_
+
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "./Datatypes.hpp"
+
+namespace Ra2ob {
+
+using Publisher = std::function<void(const tagGameInfo&)>;
+
+/**
+ * Holds captured frames back by a fixed amount of game time before publishing them.
+ *
+ * Each capture is kept as a msgpack json patch against the previous one, so memory follows
+ * how much the state changes. Release is driven by currentFrame: while the game is paused
+ * nothing is released, and a paused capture that changes nothing is not stored at all.
+ * Once a match ends (game over, process gone or frames restart) its remaining captures
+ * are released by wall clock instead, keeping the same delay.
+ */
+class DelayLine {
+public:
+    explicit DelayLine(int delaySeconds = 0);
+
+    void setDelay(int delaySeconds);
+    int getDelayFrames();
+    bool enabled();
+
+    void addPublisher(Publisher publisher);
+
+    void push(const tagGameInfo& gi);
+    void poll();
+    void finish();
+    void clear();
+
+    size_t pending();
+    size_t memoryBytes();
+
+private:
+    struct Entry {
+        int frame;
+        int64_t captured;
+        tagStamp stamp;  // Published again on release.
+        std::vector<uint8_t> delta;
+    };
+
+    static int64_t nowMs();
+    void release(std::vector<tagGameInfo>* due);
+    void publish(const std::vector<tagGameInfo>& due);
+
+    int m_delayFrames = 0;
+    int64_t m_delayMs = 0;
+    int m_lastFrame   = -1;
+    size_t m_ended    = 0;
+    size_t m_bytes    = 0;
+
+    json m_head;
+    json m_released;
+    std::deque<Entry> m_entries;
+
+    std::vector<Publisher> m_publishers;
+    std::mutex m_mutex;
+};
+
+/**
+ * Source Code
+ */
+
+inline DelayLine::DelayLine(int delaySeconds) { setDelay(delaySeconds); }
+
+inline void DelayLine::setDelay(int delaySeconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_delayFrames = delaySeconds * GAMESPEED;
+    m_delayMs     = static_cast<int64_t>(delaySeconds) * 1000;
+}
+
+inline int DelayLine::getDelayFrames() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_delayFrames;
+}
+
+inline bool DelayLine::enabled() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_delayFrames > 0 || !m_entries.empty();
+}
+
+inline void DelayLine::addPublisher(Publisher publisher) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_publishers.push_back(publisher);
+}
+
+/**
+ * Capture a frame, then publish every frame that has become due.
+ */
+inline void DelayLine::push(const tagGameInfo& gi) {
+    if (!gi.valid) {
+        return;
+    }
+
+    std::vector<tagGameInfo> due;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (gi.currentFrame < m_lastFrame) {
+        m_ended = m_entries.size();
+    }
+
+    json cur   = gi;
+    json patch = json::diff(m_head, cur);
+
+    if (!patch.empty()) {
+        Entry e;
+        e.frame    = gi.currentFrame;
+        e.captured = nowMs();
+        e.stamp    = gi.stamp;
+        e.delta    = json::to_msgpack(patch);
+
+        m_bytes += e.delta.size() + sizeof(Entry);
+        m_entries.push_back(std::move(e));
+        m_head = std::move(cur);
+    }
+
+    m_lastFrame = gi.currentFrame;
+
+    if (gi.isGameOver) {
+        m_ended = m_entries.size();
+    }
+
+    release(&due);
+    lock.unlock();
+
+    publish(due);
+}
+
+/**
+ * Publish what has become due without capturing, call it while no game is running.
+ */
+inline void DelayLine::poll() {
+    std::vector<tagGameInfo> due;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    release(&due);
+    lock.unlock();
+
+    publish(due);
+}
+
+/**
+ * The match is gone, release what is left by wall clock.
+ */
+inline void DelayLine::finish() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_ended     = m_entries.size();
+    m_lastFrame = -1;
+}
+
+inline void DelayLine::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_entries.clear();
+    m_head      = json();
+    m_released  = json();
+    m_lastFrame = -1;
+    m_ended     = 0;
+    m_bytes     = 0;
+}
+
+inline size_t DelayLine::pending() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+inline size_t DelayLine::memoryBytes() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+inline int64_t DelayLine::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Take what has become due off the line, to be published once m_mutex is unlocked.
+ */
+inline void DelayLine::release(std::vector<tagGameInfo>* due) {
+    while (!m_entries.empty()) {
+        Entry& e = m_entries.front();
+
+        if (m_ended > 0) {
+            if (nowMs() < e.captured + m_delayMs) {
+                break;
+            }
+            m_ended--;
+        } else if (e.frame + m_delayFrames > m_lastFrame) {
+            break;
+        }
+
+        json patch = json::from_msgpack(e.delta);
+
+        applyJsonPatch(&m_released, patch);
+        m_bytes -= e.delta.size() + sizeof(Entry);
+
+        due->push_back(m_released.get<tagGameInfo>());
+        due->back().stamp           = e.stamp;
+        due->back().stamp.published = steadyNs();
+
+        m_entries.pop_front();
+    }
+}
+
+/**
+ * Publishers run without m_mutex held, so they may call back into the line and a slow one
+ * only holds up the thread releasing.
+ */
+inline void DelayLine::publish(const std::vector<tagGameInfo>& due) {
+    if (due.empty()) {
+        return;
+    }
+
+    std::vector<Publisher> publishers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        publishers = m_publishers;
+    }
+
+    for (auto& gi : due) {
+        for (auto& p : publishers) {
+            p(gi);
+        }
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_DELAYLINE_HPP_
@@ -0,0 +1,942 @@
+#ifndef RA2OB_SRC_EMULATOR_HPP_
+#define RA2OB_SRC_EMULATOR_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <vector>
+
+#include "./Catalog.hpp"
+#include "./Constants.hpp"
+#include "./Datatypes.hpp"
+#include "./Reader.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+// Per CATALOGTYPES kind: count vector, produced vector, factory, and a techno's type.
+constexpr int EMUCOUNTVECTORS[CATALOGKINDS]    = {ALLIVEBUILDINGTYPES, ALLIVEINFANTRYTYPES,
+                                                  ALLIVEUNITTYPES, ALLIVEAIRCRAFTTYPES};
+constexpr int EMUPRODUCEDVECTORS[CATALOGKINDS] = {
+    FACTORYPRODUCEDBUILDINGTYPES, FACTORYPRODUCEDINFANTRYTYPES, FACTORYPRODUCEDUNITTYPES,
+    FACTORYPRODUCEDAIRCRAFTTYPES};
+constexpr int EMUFACTORIES[CATALOGKINDS]   = {P_BUILDINGFIRSTOFFSET, P_INFANTRYOFFSET,
+                                              P_TANKOFFSET, P_AIRCRAFTOFFSET};
+constexpr int EMUTECHNOTYPES[CATALOGKINDS] = {P_BUILDINGTYPEOFFSET, P_INFANTRYTYPEOFFSET,
+                                              P_UNITTYPEOFFSET, P_UNITTYPEOFFSET};
+constexpr const char* EMUTYPEIDS[CATALOGKINDS] = {"BLD", "INF", "VEH", "AIR"};
+
+struct tagEmuPlayer {
+    std::string name;  // ASCII.
+    std::string country;
+    uint32_t color = 0;  // 0xRRGGBB.
+    int team       = 0;
+    bool local     = false;  // The player at this computer, without one the game is observed.
+};
+
+struct tagEmuSuper {
+    std::string name;
+    int duration;  // Frames to charge.
+};
+
+enum class EmuAction : int {
+    Build,     // count units of a type appear.
+    Lose,      // count units of a type die, killed by player by.
+    Produce,   // count units of a type are queued in the kind's factory.
+    Charge,    // A super weapon starts charging.
+    Hold,      // A super weapon stops.
+    Set,       // value is written as an int at offset into the house.
+    Defeat,    // Everything the player has is lost.
+    Win,       // The player won.
+    GameOver,  // For every player.
+    Pause,     // The frame counter stops, later events wait for Resume.
+    Resume,
+};
+
+struct tagEmuEvent {
+    int frame        = 0;  // Script time, which goes on while the game is paused.
+    EmuAction action = EmuAction::Build;
+    int player       = 0;
+    int kind         = 0;  // Into CATALOGTYPES.
+    int index        = 0;  // Type array index, or the player's super weapon.
+    int count        = 1;
+    int by           = -1;
+    uint32_t offset  = 0;
+    int value        = 0;
+};
+
+/**
+ * A running game without the game: its globals, houses, count vectors, factory queues and
+ * super weapons laid out at the offsets the game uses, read through a Reader like a
+ * process. Game runs against it unchanged, see Game::attachSource().
+ *
+ * State changes as script time advances. Events are applied when their frame comes,
+ * production progresses one step per game frame, and paused frames do not count. Call
+ * advance() between ticks, not during one: reads are not synchronized with it. To have the
+ * game move on during a tick as a real one does, see advanceDuringReads().
+ */
+class GameEmulator : public MemorySource {
+public:
+    GameEmulator();
+
+    void setup(const std::vector<tagEmuPlayer>& players, int typesPerKind = EMUTYPESPERKIND,
+               const std::vector<tagEmuSuper>& supers = defaultSupers());
+    bool schedule(const tagEmuEvent& event);
+    bool loadScript(const json& data, std::string* error);
+
+    static json randomScript(int players, int frames, uint32_t seed,
+                             int typesPerKind = EMUTYPESPERKIND);
+    static std::vector<tagEmuSuper> defaultSupers();
+
+    void advance(int frames = 1);
+    void advanceDuringReads(int readsPerFrame);
+
+    int clock() const;
+    int frame() const;
+    size_t pending() const;
+    int playerCount() const;
+    int typesPerKind() const;
+    int getCount(int player, int kind, int index);
+    bool isDefeated(int player) const;
+
+    bool read(uint32_t addr, void* value, uint32_t size) override;
+    bool takeDirtyPages(const uint32_t* pages, size_t count, uint8_t* dirty) override;
+
+private:
+    struct Factory {
+        uint32_t addr;
+        uint32_t queueAddr;
+        std::array<uint32_t, EMUQUEUESIZE + 1> technos;
+        std::vector<int> queue;  // Type indexes, the first one in production.
+        int progress;
+    };
+
+    struct House {
+        uint32_t addr;
+        std::array<Factory, CATALOGKINDS> factories;
+        std::vector<uint32_t> supers;
+        bool defeated;
+    };
+
+    uint32_t alloc(uint32_t size);
+    uint8_t* at(uint32_t addr, uint32_t size);
+
+    template <class T>
+    T get(uint32_t addr);
+    template <class T>
+    void put(uint32_t addr, T value);
+    void markWritten(uint32_t addr, uint32_t size);
+
+    int addCount(House& h, uint32_t vector, int index, int delta);
+    void syncFactory(House& h, int kind);
+    void stepFactories();
+    void applyDue();
+    void apply(const tagEmuEvent& e);
+
+    std::map<uint32_t, std::vector<uint8_t>> m_regions;  // By base address.
+    std::map<uint32_t, std::vector<uint8_t>> m_written;  // Per region, a flag per page.
+    std::vector<House> m_houses;
+    std::array<std::vector<uint32_t>, CATALOGKINDS> m_types;
+    std::vector<uint32_t> m_superTypes;
+    std::vector<int> m_superDurations;
+
+    std::vector<tagEmuEvent> m_events;  // By frame, applied up to m_next.
+    size_t m_next = 0;
+
+    int m_typesPerKind = 0;
+    int m_clock        = 0;
+    int m_frame        = 0;
+    bool m_paused      = false;
+
+    int m_readsPerFrame = 0;
+    int m_reads         = 0;
+    std::mutex m_readMutex;  // Reads that advance take turns.
+};
+
+/**
+ * Source Code
+ */
+
+inline GameEmulator::GameEmulator() { setup({}); }
+
+/**
+ * Start over with a game of these players, each type array holding typesPerKind types and
+ * every player owning one of each super weapon, all on hold. Scheduled events are dropped.
+ */
+inline void GameEmulator::setup(const std::vector<tagEmuPlayer>& players, int typesPerKind,
+                                const std::vector<tagEmuSuper>& supers) {
+    tagGlobals globals;
+    uint32_t low  = UINT32_MAX;
+    uint32_t high = 0;
+
+    for (auto& f : globals.fields()) {
+        low  = std::min(low, *f.second);
+        high = std::max(high, *f.second + TYPESCOUNTOFFSET + 4);
+    }
+
+    low  = low & ~(SEARCHPAGESIZE - 1);
+    high = (high + SEARCHPAGESIZE - 1) & ~(SEARCHPAGESIZE - 1);
+
+    m_regions.clear();
+    m_regions[low].resize(high - low);
+    m_regions[EMUHEAPBASE].reserve(0x100000);
+
+    m_houses.clear();
+    m_events.clear();
+    m_next         = 0;
+    m_typesPerKind = typesPerKind;
+    m_clock        = 0;
+    m_frame        = 0;
+    m_paused       = false;
+
+    // Type arrays, each type with its ID and its index in the array.
+    std::array<uint32_t, CATALOGKINDS> arrays = UnitCatalog::typeArrays(globals);
+
+    for (int k = 0; k < CATALOGKINDS; k++) {
+        uint32_t items = alloc(typesPerKind * 4);
+
+        m_types[k].clear();
+
+        for (int i = 0; i < typesPerKind; i++) {
+            uint32_t type  = alloc(EMUTYPESIZE);
+            std::string id = EMUTYPEIDS[k] + std::to_string(i);
+
+            std::memcpy(at(type + TYPEIDOFFSET, id.size()), id.data(), id.size());
+            put<int>(type + P_ARRAYINDEXOFFSET, i);
+            put<uint32_t>(items + i * 4, type);
+            m_types[k].push_back(type);
+        }
+
+        put<uint32_t>(arrays[k] + TYPESITEMSOFFSET, items);
+        put<uint32_t>(arrays[k] + TYPESCOUNTOFFSET, typesPerKind);
+    }
+
+    m_superTypes.clear();
+    m_superDurations.clear();
+
+    for (auto& s : supers) {
+        uint32_t type    = alloc(EMUSUPERTYPESIZE);
+        std::string name = s.name.substr(0, STRUNITNAMESIZE - 1);
+
+        std::memcpy(at(type + SUPERTIMENAMEOFFSET, name.size()), name.data(), name.size());
+        put<int>(type + SUPERTIMEDURATIONOFFSET, s.duration);
+        m_superTypes.push_back(type);
+        m_superDurations.push_back(s.duration);
+    }
+
+    // The class base array lists every house, the player array the players' indexes in it.
+    int count          = std::min(static_cast<int>(players.size()), MAXPLAYER);
+    uint32_t fixed     = alloc(PLAYERBASEARRAYPTROFFSET + MAXPLAYER * 4);
+    uint32_t classBase = alloc((EMUOTHERHOUSES + count) * 4);
+
+    put<uint32_t>(globals.fixed, fixed);
+    put<uint32_t>(globals.classBaseArray, classBase);
+
+    for (int i = 0; i < EMUOTHERHOUSES; i++) {
+        put<uint32_t>(classBase + i * 4, alloc(EMUHOUSESIZE));
+    }
+
+    for (int i = 0; i < MAXPLAYER; i++) {
+        put<uint32_t>(fixed + PLAYERBASEARRAYPTROFFSET + i * 4,
+                      i < count ? EMUOTHERHOUSES + i : INVALIDCLASS);
+    }
+
+    std::vector<uint32_t> superVector;
+
+    for (int i = 0; i < count; i++) {
+        const tagEmuPlayer& p = players[i];
+        House h;
+
+        h.addr     = alloc(EMUHOUSESIZE);
+        h.defeated = false;
+        put<uint32_t>(classBase + (EMUOTHERHOUSES + i) * 4, h.addr);
+
+        uint32_t houseType  = alloc(STRCOUNTRYOFFSET + STRCOUNTRYSIZE);
+        std::string country = p.country.substr(0, STRCOUNTRYSIZE - 1);
+
+        std::memcpy(at(houseType + STRCOUNTRYOFFSET, country.size()), country.data(),
+                    country.size());
+        put<uint32_t>(h.addr + HOUSETYPEOFFSET, houseType);
+
+        for (size_t c = 0; c < p.name.size() && c + 1 < STRNAMESIZE; c++) {
+            put<uint16_t>(h.addr + STRNAMEOFFSET + c * 2, static_cast<uint8_t>(p.name[c]));
+        }
+
+        // Stored as R, G, B bytes.
+        put<uint8_t>(h.addr + COLOROFFSET, p.color >> 16 & 0xff);
+        put<uint8_t>(h.addr + COLOROFFSET + 1, p.color >> 8 & 0xff);
+        put<uint8_t>(h.addr + COLOROFFSET + 2, p.color & 0xff);
+
+        put<int>(h.addr + TEAMNUMBEROFFSET, p.team);
+        put<int>(h.addr + CURRENTPLAYEROFFSET, p.local ? 0x101 : 0);
+
+        for (int k = 0; k < CATALOGKINDS; k++) {
+            for (uint32_t vector : {EMUCOUNTVECTORS[k], EMUPRODUCEDVECTORS[k]}) {
+                put<uint32_t>(h.addr + vector + 4, alloc(typesPerKind * 4));
+                put<uint32_t>(h.addr + vector + 8, typesPerKind);
+            }
+
+            Factory& f = h.factories[k];
+
+            f.addr      = alloc(EMUFACTORYSIZE);
+            f.queueAddr = alloc(EMUQUEUESIZE * 4);
+            f.progress  = 0;
+            for (auto& t : f.technos) {
+                t = alloc(EMUTECHNOSIZE);
+            }
+            put<uint32_t>(f.addr + P_QUEUEPTROFFSET, f.queueAddr);
+        }
+
+        for (size_t s = 0; s < m_superTypes.size(); s++) {
+            uint32_t super = alloc(EMUSUPERSIZE);
+
+            put<uint32_t>(super + SUPERTIMETYPEOFFSET, m_superTypes[s]);
+            put<uint32_t>(super + SUPERTIMEOWNEROFFSET, h.addr);
+            put<int>(super + SUPERTIMESTARTOFFSET, -1);
+            put<int>(super + SUPERTIMELEFTOFFSET, m_superDurations[s]);
+            h.supers.push_back(super);
+            superVector.push_back(super);
+        }
+
+        m_houses.push_back(h);
+    }
+
+    uint32_t supersAddr = alloc(superVector.size() * 4);
+    for (size_t s = 0; s < superVector.size(); s++) {
+        put<uint32_t>(supersAddr + s * 4, superVector[s]);
+    }
+    put<uint32_t>(globals.superTimer + SUPERTIMEVECTOROFFSET, supersAddr);
+    put<int>(globals.superTimer + SUPERTIMERNUMSOFFSET, static_cast<int>(superVector.size()));
+
+    // All of it is new to a cache of the last game.
+    m_written.clear();
+    for (auto& region : m_regions) {
+        m_written[region.first].assign(
+            (region.second.size() + PAGECACHESIZE - 1) >> PAGECACHESHIFT, 1);
+    }
+}
+
+/**
+ * Queue an event, applied at once if its frame has passed. False if it names a player,
+ * type or super weapon the game does not have.
+ */
+inline bool GameEmulator::schedule(const tagEmuEvent& event) {
+    bool global = event.action == EmuAction::GameOver || event.action == EmuAction::Pause ||
+                  event.action == EmuAction::Resume;
+
+    if (!global && (event.player < 0 || event.player >= playerCount())) {
+        return false;
+    }
+
+    switch (event.action) {
+        case EmuAction::Build:
+        case EmuAction::Lose:
+        case EmuAction::Produce:
+            if (event.kind < 0 || event.kind >= CATALOGKINDS || event.index < 0 ||
+                event.index >= m_typesPerKind || event.count < 0 || event.by >= playerCount()) {
+                return false;
+            }
+            break;
+        case EmuAction::Charge:
+        case EmuAction::Hold:
+            if (event.index < 0 || event.index >= static_cast<int>(m_superTypes.size())) {
+                return false;
+            }
+            break;
+        case EmuAction::Set:
+            if (event.offset + 4 > EMUHOUSESIZE) {
+                return false;
+            }
+            break;
+        default:
+            break;
+    }
+
+    bool held = m_paused && event.action != EmuAction::Pause && event.action != EmuAction::Resume;
+
+    if (event.frame <= m_clock && !held) {
+        apply(event);
+        return true;
+    }
+
+    auto it = std::upper_bound(
+        m_events.begin() + m_next, m_events.end(), event,
+        [](const tagEmuEvent& a, const tagEmuEvent& b) { return a.frame < b.frame; });
+    m_events.insert(it, event);
+
+    return true;
+}
+
+/**
+ * Set up the game of a script and schedule its events:
+ *
+ * {"Players": [{"Name", "Country", "Color": "0xRRGGBB", "Team", "Local"}], "Types": 64,
+ *  "Supers": [{"Name", "Duration"}],
+ *  "Events": [{"Frame", "Action", "Player", "Kind", "Index", "Count", "By", "Super",
+ *              "Offset", "Value"}]}
+ *
+ * Action is an EmuAction name, Kind one of CATALOGKEYS. Supers defaults to defaultSupers().
+ */
+inline bool GameEmulator::loadScript(const json& data, std::string* error) {
+    static const std::map<std::string, EmuAction> actions = {
+        {"Build", EmuAction::Build},       {"Lose", EmuAction::Lose},
+        {"Produce", EmuAction::Produce},   {"Charge", EmuAction::Charge},
+        {"Hold", EmuAction::Hold},         {"Set", EmuAction::Set},
+        {"Defeat", EmuAction::Defeat},     {"Win", EmuAction::Win},
+        {"GameOver", EmuAction::GameOver}, {"Pause", EmuAction::Pause},
+        {"Resume", EmuAction::Resume},
+    };
+
+    auto parseColor = [](const json& value, uint32_t* color) {
+        if (value.is_number_integer()) {
+            *color = value.get<uint32_t>();
+            return true;
+        }
+        return value.is_string() && parseHex(value.get<std::string>(), color);
+    };
+
+    try {
+        if (!data.is_object() || !data.contains("Players") || !data["Players"].is_array()) {
+            *error = "expected an object with a Players array";
+            return false;
+        }
+
+        std::vector<tagEmuPlayer> players;
+
+        for (auto& it : data["Players"]) {
+            tagEmuPlayer p;
+
+            p.name    = it.value("Name", "Player " + std::to_string(players.size() + 1));
+            p.country = it.value("Country", "Americans");
+            p.team    = it.value("Team", static_cast<int>(players.size()));
+            p.local   = it.value("Local", false);
+
+            if (it.contains("Color") && !parseColor(it["Color"], &p.color)) {
+                *error = "invalid color in " + it.dump();
+                return false;
+            }
+
+            players.push_back(p);
+        }
+
+        std::vector<tagEmuSuper> supers = defaultSupers();
+
+        if (data.contains("Supers")) {
+            supers.clear();
+            for (auto& it : data["Supers"]) {
+                supers.push_back(tagEmuSuper{it.at("Name").get<std::string>(),
+                                             it.at("Duration").get<int>()});
+            }
+        }
+
+        setup(players, data.value("Types", EMUTYPESPERKIND), supers);
+
+        for (auto& it : data.value("Events", json::array())) {
+            tagEmuEvent e;
+
+            auto action = actions.find(it.at("Action").get<std::string>());
+            if (action == actions.end()) {
+                *error = "unknown action in " + it.dump();
+                return false;
+            }
+
+            e.frame  = it.at("Frame").get<int>();
+            e.action = action->second;
+            e.player = it.value("Player", 0);
+            e.index  = it.value("Super", it.value("Index", 0));
+            e.count  = it.value("Count", 1);
+            e.by     = it.value("By", -1);
+            e.value  = it.value("Value", 0);
+
+            if (it.contains("Kind")) {
+                std::string kind = it["Kind"].get<std::string>();
+
+                e.kind = -1;
+                for (int k = 0; k < CATALOGKINDS; k++) {
+                    if (kind == CATALOGKEYS[k]) {
+                        e.kind = k;
+                    }
+                }
+            }
+
+            if (it.contains("Offset") && !parseHex(it["Offset"].get<std::string>(), &e.offset)) {
+                *error = "invalid offset in " + it.dump();
+                return false;
+            }
+
+            if (!schedule(e)) {
+                *error = "invalid event " + it.dump();
+                return false;
+            }
+        }
+    } catch (const json::exception& e) {
+        *error = e.what();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * A script of frames of play: every half second each player queues production, loses
+ * something it built or charges a super weapon. Halfway through the game pauses for two
+ * seconds, the last player is defeated at three quarters and the first one wins at the end.
+ */
+inline json GameEmulator::randomScript(int players, int frames, uint32_t seed,
+                                       int typesPerKind) {
+    static const char* countries[] = {"Americans", "Russians",  "Alliance", "Confederation",
+                                      "French",    "Africans",  "Germans",  "YuriCountry"};
+    static const int colors[] = {C_YELLOW, C_RED,  C_BLUE, C_GREEN,
+                                 C_ORANGE, C_PINK, C_PURPLE, C_SKYBLUE};
+
+    std::mt19937 rng(seed);
+    json script;
+
+    players = std::max(1, std::min(players, MAXPLAYER));
+
+    script["Types"]   = typesPerKind;
+    script["Players"] = json::array();
+    script["Events"]  = json::array();
+
+    json& events = script["Events"];
+
+    for (int i = 0; i < players; i++) {
+        script["Players"].push_back({{"Name", "Player " + std::to_string(i + 1)},
+                                     {"Country", countries[i]},
+                                     {"Color", colors[i]},
+                                     {"Team", i}});
+
+        events.push_back({{"Frame", 0}, {"Action", "Build"}, {"Player", i},
+                          {"Kind", "Building"}, {"Index", 0}, {"Count", 1}});
+        events.push_back({{"Frame", 0}, {"Action", "Charge"}, {"Player", i}, {"Super", 0}});
+    }
+
+    std::vector<std::vector<std::pair<int, int>>> built(players);
+    int defeatAt = players > 1 ? frames * 3 / 4 : frames + 1;
+    int step     = std::max(1, GAMESPEED / 2);
+
+    for (int f = step; f < frames; f += step) {
+        for (int i = 0; i < players; i++) {
+            if (i == players - 1 && f >= defeatAt) {
+                continue;
+            }
+
+            int roll = static_cast<int>(rng() % 100);
+
+            if (roll < 50) {
+                int kind  = static_cast<int>(rng() % CATALOGKINDS);
+                int index = static_cast<int>(rng() % typesPerKind);
+
+                events.push_back({{"Frame", f},
+                                  {"Action", "Produce"},
+                                  {"Player", i},
+                                  {"Kind", CATALOGKEYS[kind]},
+                                  {"Index", index},
+                                  {"Count", 1 + rng() % 3}});
+                built[i].push_back({kind, index});
+            } else if (roll < 70 && !built[i].empty() && players > 1) {
+                auto unit = built[i][rng() % built[i].size()];
+                int by    = static_cast<int>((i + 1 + rng() % (players - 1)) % players);
+
+                events.push_back({{"Frame", f},
+                                  {"Action", "Lose"},
+                                  {"Player", i},
+                                  {"Kind", CATALOGKEYS[unit.first]},
+                                  {"Index", unit.second},
+                                  {"Count", 1},
+                                  {"By", by}});
+            } else if (roll < 72) {
+                events.push_back({{"Frame", f},
+                                  {"Action", "Charge"},
+                                  {"Player", i},
+                                  {"Super", rng() % defaultSupers().size()}});
+            }
+        }
+    }
+
+    events.push_back({{"Frame", frames / 2}, {"Action", "Pause"}});
+    events.push_back({{"Frame", frames / 2 + GAMESPEED * 2}, {"Action", "Resume"}});
+
+    if (players > 1) {
+        events.push_back({{"Frame", defeatAt}, {"Action", "Defeat"}, {"Player", players - 1}});
+        events.push_back({{"Frame", frames}, {"Action", "Win"}, {"Player", 0}});
+        events.push_back({{"Frame", frames}, {"Action", "GameOver"}});
+    }
+
+    return script;
+}
+
+inline std::vector<tagEmuSuper> GameEmulator::defaultSupers() {
+    return {{"NukeSpecial", 6300}, {"LightningStormSpecial", 6300}};
+}
+
+/**
+ * Move script time on by frames, one frame at a time.
+ */
+inline void GameEmulator::advance(int frames) {
+    for (int i = 0; i < frames; i++) {
+        m_clock++;
+        applyDue();
+
+        if (!m_paused) {
+            m_frame++;
+            put<int>(GAMEFRAMEOFFSET, m_frame);
+            stepFactories();
+        }
+    }
+}
+
+/**
+ * Advance a frame every readsPerFrame reads as well, 0 to stop. Reads are serialized
+ * meanwhile.
+ */
+inline void GameEmulator::advanceDuringReads(int readsPerFrame) {
+    std::lock_guard<std::mutex> lock(m_readMutex);
+
+    m_readsPerFrame = std::max(0, readsPerFrame);
+    m_reads         = 0;
+}
+
+inline int GameEmulator::clock() const { return m_clock; }
+
+inline int GameEmulator::frame() const { return m_frame; }
+
+/**
+ * Events still to come.
+ */
+inline size_t GameEmulator::pending() const { return m_events.size() - m_next; }
+
+inline int GameEmulator::playerCount() const { return static_cast<int>(m_houses.size()); }
+
+inline int GameEmulator::typesPerKind() const { return m_typesPerKind; }
+
+/**
+ * How many of a type a player has, kind indexing CATALOGTYPES.
+ */
+inline int GameEmulator::getCount(int player, int kind, int index) {
+    if (player < 0 || player >= playerCount() || index < 0 || index >= m_typesPerKind) {
+        return 0;
+    }
+
+    uint32_t items = get<uint32_t>(m_houses[player].addr + EMUCOUNTVECTORS[kind] + 4);
+    return get<int>(items + index * 4);
+}
+
+inline bool GameEmulator::isDefeated(int player) const { return m_houses[player].defeated; }
+
+inline bool GameEmulator::read(uint32_t addr, void* value, uint32_t size) {
+    std::unique_lock<std::mutex> lock(m_readMutex, std::defer_lock);
+
+    if (m_readsPerFrame > 0) {
+        lock.lock();
+
+        if (++m_reads % m_readsPerFrame == 0) {
+            advance();
+        }
+    }
+
+    uint8_t* p = at(addr, size);
+
+    if (p == nullptr) {
+        return false;
+    }
+
+    std::memcpy(value, p, size);
+    return true;
+}
+
+/**
+ * Which pages put() wrote since the last call, as the kernel's soft-dirty bits tell for a
+ * process. Pages outside the regions count as written, reading them fails anyway.
+ */
+inline bool GameEmulator::takeDirtyPages(const uint32_t* pages, size_t count, uint8_t* dirty) {
+    std::lock_guard<std::mutex> lock(m_readMutex);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t addr = pages[i] << PAGECACHESHIFT;
+        auto it       = m_written.upper_bound(addr);
+
+        dirty[i] = 1;
+        if (it != m_written.begin()) {
+            --it;
+
+            uint64_t page = (addr - it->first) >> PAGECACHESHIFT;
+            if (page < it->second.size()) {
+                dirty[i] = it->second[page];
+            }
+        }
+    }
+
+    for (auto& w : m_written) {
+        std::fill(w.second.begin(), w.second.end(), 0);
+    }
+
+    return true;
+}
+
+inline uint32_t GameEmulator::alloc(uint32_t size) {
+    std::vector<uint8_t>& heap = m_regions[EMUHEAPBASE];
+    uint32_t ret               = EMUHEAPBASE + static_cast<uint32_t>(heap.size());
+
+    heap.resize(heap.size() + ((size + 15) & ~15u));
+
+    return ret;
+}
+
+/**
+ * The bytes at addr, nullptr unless all size of them are mapped.
+ */
+inline uint8_t* GameEmulator::at(uint32_t addr, uint32_t size) {
+    auto it = m_regions.upper_bound(addr);
+
+    if (it == m_regions.begin()) {
+        return nullptr;
+    }
+    --it;
+
+    uint64_t offset = addr - it->first;
+    if (offset + size > it->second.size()) {
+        return nullptr;
+    }
+
+    return it->second.data() + offset;
+}
+
+template <class T>
+inline T GameEmulator::get(uint32_t addr) {
+    T ret{};
+    uint8_t* p = at(addr, sizeof(ret));
+
+    if (p != nullptr) {
+        std::memcpy(&ret, p, sizeof(ret));
+    }
+
+    return ret;
+}
+
+template <class T>
+inline void GameEmulator::put(uint32_t addr, T value) {
+    uint8_t* p = at(addr, sizeof(value));
+
+    if (p != nullptr) {
+        std::memcpy(p, &value, sizeof(value));
+        markWritten(addr, sizeof(value));
+    }
+}
+
+inline void GameEmulator::markWritten(uint32_t addr, uint32_t size) {
+    auto it = m_written.upper_bound(addr);
+
+    if (it == m_written.begin()) {
+        return;
+    }
+    --it;
+
+    uint64_t first = (addr - it->first) >> PAGECACHESHIFT;
+    uint64_t last  = (addr + size - 1 - it->first) >> PAGECACHESHIFT;
+
+    for (uint64_t page = first; page <= last && page < it->second.size(); page++) {
+        it->second[page] = 1;
+    }
+}
+
+/**
+ * Change one count of a count vector at vector, never below 0, keeping the total at +0x10.
+ * Returns the change made.
+ */
+inline int GameEmulator::addCount(House& h, uint32_t vector, int index, int delta) {
+    uint32_t items = get<uint32_t>(h.addr + vector + 4);
+    int current    = get<int>(items + index * 4);
+    int next       = std::max(0, current + delta);
+
+    put<int>(items + index * 4, next);
+    put<int>(h.addr + vector + FACTORYTYPESOFFSET,
+             get<int>(h.addr + vector + FACTORYTYPESOFFSET) + next - current);
+
+    return next - current;
+}
+
+/**
+ * Write a factory's queue where the game keeps it: the unit in production, the rest of the
+ * queue behind it, and the house pointing at the factory while it has anything to build.
+ */
+inline void GameEmulator::syncFactory(House& h, int kind) {
+    Factory& f = h.factories[kind];
+
+    if (f.queue.empty()) {
+        put<uint32_t>(h.addr + EMUFACTORIES[kind], 0);
+        return;
+    }
+
+    for (size_t j = 0; j < f.queue.size(); j++) {
+        put<uint32_t>(f.technos[j] + EMUTECHNOTYPES[kind], m_types[kind][f.queue[j]]);
+
+        if (j > 0) {
+            put<uint32_t>(f.queueAddr + (j - 1) * 4, f.technos[j]);
+        }
+    }
+
+    put<uint32_t>(f.addr + P_CURRENTOFFSET, f.technos[0]);
+    put<int>(f.addr + P_QUEUELENGTHOFFSET, static_cast<int>(f.queue.size()) - 1);
+    put<int>(f.addr + P_TIMEOFFSET, f.progress);
+    put<uint32_t>(h.addr + EMUFACTORIES[kind], f.addr);
+}
+
+/**
+ * One frame of production. A unit stays at EMUBUILDSTEPS for a frame, then it is out.
+ */
+inline void GameEmulator::stepFactories() {
+    for (auto& h : m_houses) {
+        for (int k = 0; k < CATALOGKINDS; k++) {
+            Factory& f = h.factories[k];
+
+            if (f.queue.empty()) {
+                continue;
+            }
+
+            if (f.progress < EMUBUILDSTEPS) {
+                f.progress++;
+                put<int>(f.addr + P_TIMEOFFSET, f.progress);
+                continue;
+            }
+
+            addCount(h, EMUCOUNTVECTORS[k], f.queue.front(), 1);
+            addCount(h, EMUPRODUCEDVECTORS[k], f.queue.front(), 1);
+
+            f.queue.erase(f.queue.begin());
+            f.progress = 0;
+            syncFactory(h, k);
+        }
+    }
+}
+
+/**
+ * Nothing changes while the game is paused, as the frame counter does not: events that fall
+ * into a pause are held until the Resume is due, then applied after it.
+ */
+inline void GameEmulator::applyDue() {
+    while (m_next < m_events.size() && m_events[m_next].frame <= m_clock) {
+        EmuAction action = m_events[m_next].action;
+
+        if (m_paused && action != EmuAction::Pause && action != EmuAction::Resume) {
+            size_t resume = m_next;
+
+            while (resume < m_events.size() && m_events[resume].frame <= m_clock &&
+                   m_events[resume].action != EmuAction::Resume) {
+                resume++;
+            }
+
+            if (resume == m_events.size() || m_events[resume].frame > m_clock) {
+                return;
+            }
+
+            std::rotate(m_events.begin() + m_next, m_events.begin() + resume,
+                        m_events.begin() + resume + 1);
+        }
+
+        apply(m_events[m_next++]);
+    }
+}
+
+inline void GameEmulator::apply(const tagEmuEvent& e) {
+    switch (e.action) {
+        case EmuAction::Pause:
+        case EmuAction::Resume:
+            m_paused = e.action == EmuAction::Pause;
+            put<uint8_t>(GAMEPAUSEOFFSET, m_paused);
+            return;
+        case EmuAction::GameOver:
+            for (auto& h : m_houses) {
+                put<uint8_t>(h.addr + ISGAMEOVEROFFSET, 1);
+            }
+            return;
+        default:
+            break;
+    }
+
+    House& h = m_houses[e.player];
+
+    if (h.defeated) {
+        return;
+    }
+
+    switch (e.action) {
+        case EmuAction::Build:
+            addCount(h, EMUCOUNTVECTORS[e.kind], e.index, e.count);
+            break;
+        case EmuAction::Lose: {
+            int lost      = -addCount(h, EMUCOUNTVECTORS[e.kind], e.index, -e.count);
+            bool building = CATALOGTYPES[e.kind] == UnitType::Building;
+
+            put<int>(h.addr + (building ? TOTALKILLEDBUILDINGS : TOTALKILLEDUNITS),
+                     get<int>(h.addr + (building ? TOTALKILLEDBUILDINGS : TOTALKILLEDUNITS)) +
+                         lost);
+
+            if (e.by >= 0) {
+                uint32_t kills = m_houses[e.by].addr +
+                                 (building ? KILLEDBUILDINGSOFHOUSES : KILLEDUNITSOFHOUSES) +
+                                 (EMUOTHERHOUSES + e.player) * 4;
+                put<int>(kills, get<int>(kills) + lost);
+            }
+            break;
+        }
+        case EmuAction::Produce: {
+            Factory& f = h.factories[e.kind];
+
+            for (int c = 0; c < e.count && f.queue.size() < f.technos.size(); c++) {
+                f.queue.push_back(e.index);
+            }
+            syncFactory(h, e.kind);
+            break;
+        }
+        case EmuAction::Charge:
+            put<int>(h.supers[e.index] + SUPERTIMESTARTOFFSET, m_frame);
+            put<int>(h.supers[e.index] + SUPERTIMELEFTOFFSET, m_superDurations[e.index]);
+            break;
+        case EmuAction::Hold:
+            put<int>(h.supers[e.index] + SUPERTIMESTARTOFFSET, -1);
+            break;
+        case EmuAction::Set:
+            put<int>(h.addr + e.offset, e.value);
+            break;
+        case EmuAction::Defeat: {
+            tagEmuEvent lose = e;
+
+            lose.action = EmuAction::Lose;
+            lose.count  = INT32_MAX;
+            lose.by     = -1;
+
+            for (int k = 0; k < CATALOGKINDS; k++) {
+                lose.kind = k;
+                for (lose.index = 0; lose.index < m_typesPerKind; lose.index++) {
+                    apply(lose);
+                }
+
+                h.factories[k].queue.clear();
+                syncFactory(h, k);
+            }
+
+            for (uint32_t super : h.supers) {
+                put<uint32_t>(super + SUPERTIMEOWNEROFFSET, 0);
+            }
+
+            h.defeated = true;
+            put<uint8_t>(h.addr + ISDEFEATEDOFFSET, 1);
+            break;
+        }
+        case EmuAction::Win:
+            put<uint8_t>(h.addr + ISWINNEROFFSET, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_EMULATOR_HPP_
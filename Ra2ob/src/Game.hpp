@@ -3,16 +3,34 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <memory>
+#include <mutex>  // NOLINT
 #include <sstream>
 #include <string>
 #include <thread>  // NOLINT
+#include <unordered_map>
 #include <vector>
 
+#include "./Catalog.hpp"
+#include "./ConfigWatcher.hpp"
+#include "./DelayLine.hpp"
+#include "./History.hpp"
+#include "./Latency.hpp"
+#include "./PageCache.hpp"
+#include "./Pipeline.hpp"
+#include "./Process.hpp"
+#include "./ReadLog.hpp"
+#include "./Scanner.hpp"
+#include "./Settings.hpp"
+#include "./Snapshot.hpp"
+#include "./Timeline.hpp"
 #include "./Viewer.hpp"
-// clang-format off
-#include <psapi.h> // NOLINT
-#include <TlHelp32.h>
-// clang-format on
+#ifdef RA2OB_OFFSET_TABLES
+#include "OffsetTables.hpp"  // Generated from config/ by the build.
+#endif
 
 namespace Ra2ob {
 
@@ -20,23 +38,54 @@ class Game {
 public:
     static Game& getInstance();
 
+    Game();
+    ~Game();
+
     Game(const Game&)           = delete;
     void operator=(const Game&) = delete;
 
     void getHandle();
+    bool attach(DWORD pid);
+    bool attachSource(MemorySource* source, Version v = Version::Yr, std::string map = "");
+    bool attachReplay(ReadReplay* replay);
     DisplayMode getDisplayMode(bool fullscreen, bool windowed, bool border);
     void initAddrs();
-
-    void loadNumericsFromJson(std::string filePath = F_PANELOFFSETS);
-    void loadUnitsFromJson(std::string filePath = F_UNITOFFSETS);
+    bool addrsValid();
+    void resolveAddrs();
+    void refreshPlayerFlags();
+
+    void loadNumericsFromTable();
+    void loadUnitsFromTable();
+    bool loadNumericsFromJson(std::string filePath = F_PANELOFFSETS);
+    bool loadUnitsFromJson(std::string filePath = F_UNITOFFSETS);
+    static bool readConfig(const std::string& filePath, json* data, std::string* error);
+    static bool parseNumerics(const json& data, tagNumerics* numerics, std::string* error);
+    static bool parsePathField(const json& entry, PathPlan* paths, std::string* error);
+    static bool parseUnits(const json& data, tagUnits* units, std::string* error);
+
+    bool watchConfig(std::string unitPath = F_UNITOFFSETS, std::string panelPath = F_PANELOFFSETS);
+    void unwatchConfig();
+    bool reloadConfig(std::string unitPath = F_UNITOFFSETS, std::string panelPath = F_PANELOFFSETS);
+    void queueTables(std::shared_ptr<tagOffsetTables> tables);
+    void applyConfig();
+    void refreshCatalog();
+    void mergeCatalog();
+    void resolveGlobals();
+    bool learnSignatures(std::string filePath = F_SIGNATURES);
     void initStrTypes();
     void initArrays();
     void initGameInfo();
+    void initSnapshot();
 
     int hasPlayer();
+    bool revalidate();
 
+    void initStages();
+    void refreshUnits(UnitType utype);
     void refreshInfo();
-    void getBuildingInfo(tagBuildingInfo* bi, int addr, int offset_0, int offset_1, UnitType utype);
+    void capture();
+    tagCaptureStats captureStats();
+    void getBuildingInfo(tagSnapPlayer* p, int addr, int offset_0, int offset_1, UnitType utype);
     void refreshBuildingInfos();
     void refreshSuperTimer();
     void refreshColors();
@@ -45,7 +94,21 @@ public:
     void refreshGameInfos();
 
     void structBuild();
+    void checkAllocations(int warmupTicks = ALLOCWARMUPTICKS);
+
+    std::vector<tagStageStats> profile();
+    uint64_t percentile(const std::string& stage, double p);
+    void resetProfile();
+
+    bool startRecording(std::string filePath, int keyInterval = TL_KEYINTERVAL);
+    void stopRecording();
+    void record();
+
+    bool startReadLog(std::string filePath = F_READLOG);
+    void stopReadLog();
+    void applyReadLog();
 
+    void tick();
     void restart(bool valid);
 
     void detectTask(int interval = 500);
@@ -53,19 +116,22 @@ public:
     void startLoop();
 
     tagNumerics _numerics;
-    tagUnits _units;
+    tagUnits _units;        // _configUnits plus discovered types.
+    tagUnits _configUnits;  // From unit_offsets.json.
+    UnitPlan _unitPlan;     // _units of the attached version, what the stages fetch.
+    bool _unitPlanPending = false;
     tagGameInfo _gameInfo;
+    GameSnapshot _snapshot{};  // Filled by the stages, converted into _gameInfo.
+    std::atomic<bool> _attached{false};  // While detectTask() holds a game, see fetchTask().
+
+    // Heap allocations of the last refreshInfo() and structBuild(), see checkAllocations().
+    AllocCounter _allocs;
+    uint64_t _fetchAllocs = 0;
+    int _allocWarmup      = -1;
 
     StrName _strName;
     StrCountry _strCountry;
 
-    std::array<tagBuildingInfo, MAXPLAYER> _buildingInfos;
-    std::array<tagSuperTimer, MAXPLAYER> _superTimers;
-    std::array<tagStatusInfo, MAXPLAYER> _statusInfos;
-    std::array<tagScoreInfo, MAXPLAYER> _scoreInfos;
-
-    std::array<std::string, MAXPLAYER> _colors;
-
     std::array<bool, MAXPLAYER> _players;
     std::array<uint32_t, MAXPLAYER> _playerBases;
 
@@ -81,11 +147,55 @@ public:
 
     std::array<uint32_t, MAXPLAYER> _houseTypes;
 
+    std::unordered_map<uint32_t, uint32_t> _superNames;  // Super weapon type -> NamePool id.
+
+    // What the cached player bases were resolved from, see addrsValid().
+    bool _addrsResolved      = false;
+    uint32_t _fixed          = 0;
+    uint32_t _classBaseArray = 0;
+    std::array<uint32_t, MAXPLAYER> _playerIndexes;
+
     std::array<uint32_t, MAXPLAYER> _playerTeamNumber;
     std::array<bool, MAXPLAYER> _playerDefeatFlag;
     std::array<bool, MAXPLAYER> _playerGameoverFlag;
     std::array<bool, MAXPLAYER> _playerWinnerFlag;
 
+    HistoryRing _history;
+    DelayLine _delayLine;
+    LatencyTracker _latency;  // Consumers report what they received to _latency.delivered().
+
+    std::unique_ptr<TimelineWriter> _recorder;
+    std::mutex _recorderMutex;
+
+    StageGraph _stages;
+    bool _serialRefresh = false;
+
+    // Frame consistency of the captures, see capture().
+    int _captureRetries = CAPTURERETRIES;
+    std::atomic<uint64_t> _captures{0};
+    std::atomic<uint64_t> _capturesRetried{0};
+    std::atomic<uint64_t> _capturesTorn{0};
+    std::atomic<uint64_t> _captureRetriesUsed{0};
+
+    // Pages refreshInfo() reads, read again only once written, see capture(). Off until it
+    // is measured against a real game, see PageCache.
+    PageCache _pageCache;
+    bool _trackDirtyPages = false;
+    std::atomic<bool> _pageCacheStale{false};  // Set by restart(), reset by capture().
+
+    // Every read of the ticks, see startReadLog(). _readLog belongs to the fetch thread.
+    std::unique_ptr<ReadRecorder> _readLog;
+    std::unique_ptr<ReadRecorder> _pendingReadLog;
+    bool _readLogPending = false;
+    std::mutex _readLogMutex;
+
+    // Whole ticks and the steps around the stages, see profile().
+    StageProfile _tickProfile{"tick"};
+    StageProfile _captureProfile{"capture"};
+    StageProfile _initAddrsProfile{"initAddrs"};
+    StageProfile _structBuildProfile{"structBuild"};
+    StageProfile _publishProfile{"publish"};
+
     Reader r;
     Viewer viewer;
     Version version        = Version::Yr;
@@ -93,9 +203,22 @@ public:
     std::string mapName    = "";
     std::string mapNameUtf = "";
 
-private:
-    Game();
-    ~Game();
+    // Addresses of the attached game's globals, see resolveGlobals().
+    tagGlobals _globals;
+
+    // Types of the attached game, discovered on its first tick with players.
+    UnitCatalog _catalog;
+    uint64_t _exeHash    = 0;
+    bool _catalogPending = false;
+    bool _catalogRead    = false;  // Discover the next catalog from the game, not the cache.
+
+    // Tables rebuilt by reloadConfig() or the json loaders, swapped in by applyConfig() on
+    // the fetch thread.
+    std::shared_ptr<tagOffsetTables> _pendingTables;
+    std::mutex _pendingTablesMutex;  // Between threads queueing tables, see queueTables().
+
+    // Last, so its thread stops before anything it reloads into goes away.
+    std::unique_ptr<ConfigWatcher> _configWatcher;
 };
 
 inline Game& Game::getInstance() {
@@ -104,14 +227,17 @@ inline Game& Game::getInstance() {
 }
 
 inline Game::Game() {
-    loadNumericsFromJson();
-    loadUnitsFromJson();
+    loadNumericsFromTable();
+    loadUnitsFromTable();
     initStrTypes();
     initArrays();
     initGameInfo();
+    initStages();
 }
 
 inline Game::~Game() {
+    unwatchConfig();
+
     if (r.getHandle() != nullptr) {
         CloseHandle(r.getHandle());
     }
@@ -121,97 +247,47 @@ inline Game::~Game() {
  * Get game handle, set Reader.
  */
 inline void Game::getHandle() {
-    DWORD pid = 0;
-
-    std::wstring w_name = L"gamemd-spawn.exe";
-    std::string name    = "gamemd-spawn.exe";
-
-    HANDLE hProcessSnap = INVALID_HANDLE_VALUE;
-    hProcessSnap        = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
-
-    HANDLE hThreadSnap = INVALID_HANDLE_VALUE;
-    hThreadSnap        = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
-
-    if (hProcessSnap == INVALID_HANDLE_VALUE) {
-        std::cerr << "Failed to create process snapshot\n";
-        return;
-    }
+    std::vector<DWORD> pids = findGameProcesses();
 
-    if (hThreadSnap == INVALID_HANDLE_VALUE) {
-        std::cerr << "Failed to create thread snapshot\n";
+    if (pids.empty()) {
+        std::cerr << "No Valid PID. Finding \"" << F_GAMEEXE << "\".\n";
+        r = Reader(nullptr);
         return;
     }
 
-    PROCESSENTRY32 processInfo{};
-    processInfo.dwSize = sizeof(PROCESSENTRY32);
-
-    for (BOOL success = Process32First(hProcessSnap, &processInfo); success;
-         success      = Process32Next(hProcessSnap, &processInfo)) {
-        BOOL processMatch = false;
-
-#ifdef UNICODE
-        if (wcscmp(processInfo.szExeFile, w_name.c_str()) == 0) {
-            processMatch = true;
-        }
-#else
-        if (name == processInfo.szExeFile) {
-            processMatch = true;
-        }
-#endif
-
-        if (processMatch) {
-            THREADENTRY32 threadInfo{};
-            threadInfo.dwSize = sizeof(THREADENTRY32);
-
-            pid = processInfo.th32ProcessID;
-
-            int thread_nums = 0;
-
-            for (BOOL success = Thread32First(hThreadSnap, &threadInfo); success;
-                 success      = Thread32Next(hThreadSnap, &threadInfo)) {
-                if (threadInfo.th32OwnerProcessID == pid) {
-                    thread_nums++;
-                }
-            }
-
-            if (thread_nums != 0) {
-                break;
-            }
-
-            pid = 0;
-        }
-    }
+    attach(pids.front());
+}
 
-    if (pid == 0) {
-        std::cerr << "No Valid PID. Finding \"gamemd-spawn.exe\".\n";
+/**
+ * Open the given game process, set Reader and load its settings.
+ */
+inline bool Game::attach(DWORD pid) {
+    if (r.getHandle() != nullptr) {
+        CloseHandle(r.getHandle());
         r = Reader(nullptr);
-        return;
     }
 
-    HANDLE pHandle = OpenProcess(
-        PROCESS_QUERY_INFORMATION | PROCESS_CREATE_THREAD | PROCESS_VM_OPERATION | PROCESS_VM_READ,
-        FALSE, pid);
+    HANDLE pHandle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_CREATE_THREAD |
+                                     PROCESS_VM_OPERATION | PROCESS_VM_READ | SYNCHRONIZE,
+                                 FALSE, pid);
 
     if (pHandle == nullptr) {
         std::cerr << "Could not open process\n";
         r = Reader(nullptr);
-        return;
+        return false;
     }
 
     r = Reader(pHandle);
 
-#ifdef UNICODE
-    wchar_t exePath[256];
-    GetModuleFileNameEx(pHandle, NULL, exePath, sizeof(exePath));
-    std::string filePath = utf16ToGbk(exePath);
-#else
-    char exePath[256];
-    GetModuleFileNameEx(pHandle, NULL, exePath, sizeof(exePath));
-    std::string filePath = exePath;
-#endif
+    std::string filePath = gameExePath(pHandle, pid);
+
+    _exeHash        = hashFile(filePath);
+    _catalogPending = true;
+
+    resolveGlobals();
 
     std::string gamePath = filePath;
-    std::string destPart = "gamemd-spawn.exe";
+    std::string destPart = F_GAMEEXE;
 
     // Get info from spawnini
     std::string spawnini = "spawn.ini";
@@ -241,6 +317,8 @@ inline void Game::getHandle() {
         }
     }
 
+    _unitPlanPending = _unitPlan.getVersion() != version;
+
     if (sif.isItemExist(recordFile)) {
         isReplay = true;
     } else {
@@ -341,6 +419,74 @@ inline void Game::getHandle() {
         default:
             _gameInfo.debug.setting.display = "Unknown Displaymode";
     }
+
+    return true;
+}
+
+/**
+ * Read a game from source instead of a process, like attach() does for one. There is no
+ * executable, so the built-in globals are used and the discovered catalog is not cached.
+ */
+inline bool Game::attachSource(MemorySource* source, Version v, std::string map) {
+    if (r.getHandle() != nullptr) {
+        CloseHandle(r.getHandle());
+    }
+
+    r = Reader(nullptr, source);
+
+    _exeHash        = 0;
+    _catalogPending = true;
+    _globals        = tagGlobals();
+
+    version          = v;
+    _unitPlanPending = _unitPlan.getVersion() != version;
+    isReplay         = false;
+    mapName          = map;
+    mapNameUtf       = map;
+
+    _gameInfo.debug.setting          = tagSetting();
+    _gameInfo.debug.setting.platform = "Emulated";
+    _gameInfo.debug.setting.version  = version;
+    _gameInfo.debug.setting.mapName  = mapName;
+
+    return source != nullptr;
+}
+
+/**
+ * Replay a read log written by startReadLog(): attach to it as recorded and resolve the
+ * players from the reads before its first mark. Each tick() then replays a recorded one.
+ */
+inline bool Game::attachReplay(ReadReplay* replay) {
+    const json& meta = replay->meta();
+    tagGlobals globals;
+    Version v = Version::Yr;
+    std::string map;
+
+    try {
+        json saved = meta.value("globals", json::object());
+
+        v   = static_cast<Version>(meta.value("version", 1));
+        map = meta.value("map", std::string());
+
+        for (auto& f : globals.fields()) {
+            *f.second = saved.value(f.first, *f.second);
+        }
+    } catch (const json::exception& e) {
+        std::cerr << "ReadLog: bad meta record, " << e.what() << "\n";
+        return false;
+    }
+
+    attachSource(replay, v, map);
+    _globals = globals;
+
+    _gameInfo.debug.setting.platform = "Replay";
+    _trackDirtyPages                 = false;
+    _addrsResolved                   = false;
+
+    replay->rewind();
+    initAddrs();
+
+    return replay->segments() > 1;
 }
 
 inline DisplayMode Game::getDisplayMode(bool fullscreen, bool windowed, bool border) {
@@ -360,84 +506,359 @@ inline DisplayMode Game::getDisplayMode(bool fullscreen, bool windowed, bool bor
 }
 
 /**
- * Initialize all the addresses.
+ * Resolve the player bases only when the cached ones went stale, then refresh what changes
+ * during a match.
  */
 inline void Game::initAddrs() {
-    if (nullptr == r.getHandle()) {
+    ProfileScope scope(&_initAddrsProfile);
+
+    if (!r.attached()) {
         std::cerr << "No valid process handle, call Game::getHandle() first.\n";
     }
 
-    uint32_t fixed              = r.getAddr(FIXEDOFFSET);
-    uint32_t classBaseArray     = r.getAddr(CLASSBASEARRAYOFFSET);
-    uint32_t playerBaseArrayPtr = fixed + PLAYERBASEARRAYPTROFFSET;
+    if (!addrsValid()) {
+        resolveAddrs();
+    }
+
+    refreshPlayerFlags();
+}
 
-    bool isObserverFlag = true;
-    bool isThisGameOver = false;
+/**
+ * Whether the cached player bases still hold: the same player array, and every occupied
+ * slot of the class base array still pointing at the same house.
+ */
+inline bool Game::addrsValid() {
+    if (!_addrsResolved) {
+        return false;
+    }
+
+    if (r.getAddr(_globals.fixed) != _fixed ||
+        r.getAddr(_globals.classBaseArray) != _classBaseArray) {
+        return false;
+    }
+
+    std::array<uint32_t, MAXPLAYER> indexes;
+    if (!r.readMemory(_fixed + PLAYERBASEARRAYPTROFFSET, indexes.data(), sizeof(indexes)) ||
+        indexes != _playerIndexes) {
+        return false;
+    }
+
+    for (int i = 0; i < MAXPLAYER; i++) {
+        if (_players[i] && r.getAddr(indexes[i] * 4 + _classBaseArray) != _playerBases[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Walk the pointer chain from the fixed offsets to every house.
+ */
+inline void Game::resolveAddrs() {
+    _fixed          = r.getAddr(_globals.fixed);
+    _classBaseArray = r.getAddr(_globals.classBaseArray);
+
+    uint32_t playerBaseArrayPtr = _fixed + PLAYERBASEARRAYPTROFFSET;
 
     for (int i = 0; i < MAXPLAYER; i++, playerBaseArrayPtr += 4) {
         uint32_t playerBase = r.getAddr(playerBaseArrayPtr);
 
-        _players[i] = false;
+        _playerIndexes[i] = playerBase;
+        _players[i]       = false;
 
         if (playerBase != INVALIDCLASS) {
-            uint32_t realPlayerBase = r.getAddr(playerBase * 4 + classBaseArray);
-            int cur_c               = r.getInt(realPlayerBase + CURRENTPLAYEROFFSET);
+            uint32_t realPlayerBase = r.getAddr(playerBase * 4 + _classBaseArray);
 
-            if (cur_c == 0x1010000 || cur_c == 0x101) {
-                isObserverFlag = false;
-            }
+            _players[i]     = true;
+            _playerBases[i] = realPlayerBase;
+            _houseTypes[i]  = r.getAddr(realPlayerBase + HOUSETYPEOFFSET);
+        }
+    }
+
+    _addrsResolved = true;
+}
 
-            bool isDefeated = r.getBool(realPlayerBase + ISDEFEATEDOFFSET);
-            bool isGameOver = r.getBool(realPlayerBase + ISGAMEOVEROFFSET);
-            bool isWinner   = r.getBool(realPlayerBase + ISWINNEROFFSET);
+/**
+ * Two block reads per house: team number through the winner flag, and the four type-count
+ * vectors, whose buffers move when they grow.
+ */
+inline void Game::refreshPlayerFlags() {
+    constexpr int flagsSize  = ISWINNEROFFSET + 1 - TEAMNUMBEROFFSET;
+    constexpr int countsSize = AIRCRAFTOFFSET + 8 - BUILDINGOFFSET;
 
-            _playerTeamNumber[i]   = r.getInt(realPlayerBase + TEAMNUMBEROFFSET);
-            _playerDefeatFlag[i]   = isDefeated;
-            _playerGameoverFlag[i] = isGameOver;
-            _playerWinnerFlag[i]   = isWinner;
+    bool isObserverFlag = true;
+    bool isThisGameOver = false;
 
-            if (isGameOver || isWinner) {
-                isThisGameOver = true;
-            }
+    for (int i = 0; i < MAXPLAYER; i++) {
+        if (!_players[i]) {
+            continue;
+        }
 
-            _players[i]     = true;
-            _playerBases[i] = realPlayerBase;
+        uint32_t realPlayerBase = _playerBases[i];
+
+        uint8_t flags[flagsSize];
+        uint8_t counts[countsSize];
+
+        if (!r.readMemory(realPlayerBase + TEAMNUMBEROFFSET, flags, flagsSize) ||
+            !r.readMemory(realPlayerBase + BUILDINGOFFSET, counts, countsSize)) {
+            _addrsResolved = false;
+            continue;
+        }
+
+        auto flagInt = [&flags](int offset) {
+            int value;
+            std::memcpy(&value, flags + offset - TEAMNUMBEROFFSET, 4);
+            return value;
+        };
+        auto countAddr = [&counts](int offset) {
+            uint32_t value;
+            std::memcpy(&value, counts + offset - BUILDINGOFFSET, 4);
+            return value;
+        };
+
+        int cur_c = flagInt(CURRENTPLAYEROFFSET);
+
+        if (cur_c == 0x1010000 || cur_c == 0x101) {
+            isObserverFlag = false;
+        }
 
-            _buildings[i] = r.getAddr(realPlayerBase + BUILDINGOFFSET);
-            _tanks[i]     = r.getAddr(realPlayerBase + TANKOFFSET);
-            _infantrys[i] = r.getAddr(realPlayerBase + INFANTRYOFFSET);
-            _aircrafts[i] = r.getAddr(realPlayerBase + AIRCRAFTOFFSET);
+        bool isDefeated = flags[ISDEFEATEDOFFSET - TEAMNUMBEROFFSET] != 0;
+        bool isGameOver = flags[ISGAMEOVEROFFSET - TEAMNUMBEROFFSET] != 0;
+        bool isWinner   = flags[ISWINNEROFFSET - TEAMNUMBEROFFSET] != 0;
 
-            _buildings_valid[i] = r.getAddr(realPlayerBase + BUILDINGOFFSET + 4);
-            _tanks_valid[i]     = r.getAddr(realPlayerBase + TANKOFFSET + 4);
-            _infantrys_valid[i] = r.getAddr(realPlayerBase + INFANTRYOFFSET + 4);
-            _aircrafts_valid[i] = r.getAddr(realPlayerBase + AIRCRAFTOFFSET + 4);
+        _playerTeamNumber[i]   = flagInt(TEAMNUMBEROFFSET);
+        _playerDefeatFlag[i]   = isDefeated;
+        _playerGameoverFlag[i] = isGameOver;
+        _playerWinnerFlag[i]   = isWinner;
 
-            _houseTypes[i] = r.getAddr(realPlayerBase + HOUSETYPEOFFSET);
+        if (isGameOver || isWinner) {
+            isThisGameOver = true;
         }
+
+        _buildings[i] = countAddr(BUILDINGOFFSET);
+        _tanks[i]     = countAddr(TANKOFFSET);
+        _infantrys[i] = countAddr(INFANTRYOFFSET);
+        _aircrafts[i] = countAddr(AIRCRAFTOFFSET);
+
+        _buildings_valid[i] = countAddr(BUILDINGOFFSET + 4);
+        _tanks_valid[i]     = countAddr(TANKOFFSET + 4);
+        _infantrys_valid[i] = countAddr(INFANTRYOFFSET + 4);
+        _aircrafts_valid[i] = countAddr(AIRCRAFTOFFSET + 4);
     }
 
-    _gameInfo.isObserver = isObserverFlag || isReplay;
-    _gameInfo.isGameOver = isThisGameOver;
+    _snapshot.isObserver = isObserverFlag || isReplay;
+    _snapshot.isGameOver = isThisGameOver;
 }
 
-inline void Game::loadNumericsFromJson(std::string filePath) {
-    json data = readJsonFromFile(filePath);
-
+/**
+ * Load the offsets compiled in from config/ by the build, or the json files when the build
+ * has no tables, without which nothing runs. The json loaders below stay available to
+ * override them at runtime.
+ */
+inline void Game::loadNumericsFromTable() {
+#ifdef RA2OB_OFFSET_TABLES
     _numerics.items.clear();
+    _numerics.items.reserve(sizeof(NUMERICTABLE) / sizeof(NUMERICTABLE[0]));
+
+    for (const tagNumericEntry& e : NUMERICTABLE) {
+        _numerics.items.push_back(Numeric(e.name, e.offset));
+    }
+
+    _numerics.paths.clear();
+    for (const tagPathEntry& e : PATHTABLE) {
+        _numerics.paths.addField(e);
+    }
+
+    _numerics.buildIndex();
+#else
+    if (!loadNumericsFromJson()) {
+        std::exit(1);
+    }
+    applyConfig();
+#endif
+}
+
+inline void Game::loadUnitsFromTable() {
+#ifdef RA2OB_OFFSET_TABLES
+    _configUnits.items.clear();
+    _configUnits.items.reserve(sizeof(UNITTABLE) / sizeof(UNITTABLE[0]));
+
+    for (const tagUnitEntry& e : UNITTABLE) {
+        _configUnits.items.push_back(Unit(e));
+    }
+
+    _configUnits.buildIndex();
+    mergeCatalog();
+#else
+    if (!loadUnitsFromJson()) {
+        std::exit(1);
+    }
+    applyConfig();
+#endif
+}
+
+/**
+ * Replace the numerics with panel_offsets.json before the next tick, like a reload. Safe
+ * from any thread. False, keeping the current numerics, if the file is broken.
+ */
+inline bool Game::loadNumericsFromJson(std::string filePath) {
+    std::shared_ptr<tagOffsetTables> tables = std::make_shared<tagOffsetTables>();
+    json data;
+    std::string error;
+
+    if (!readConfig(filePath, &data, &error) || !parseNumerics(data, &tables->numerics, &error)) {
+        std::cerr << filePath << ": " << error << ". Keeping the current numerics.\n";
+        return false;
+    }
+
+    tables->hasUnits = false;
+    queueTables(tables);
+
+    return true;
+}
+
+/**
+ * Replace the configured units with unit_offsets.json before the next tick, like a reload.
+ * Safe from any thread. False, keeping the current units, if the file is broken.
+ */
+inline bool Game::loadUnitsFromJson(std::string filePath) {
+    std::shared_ptr<tagOffsetTables> tables = std::make_shared<tagOffsetTables>();
+    json data;
+    std::string error;
+
+    if (!readConfig(filePath, &data, &error) || !parseUnits(data, &tables->units, &error)) {
+        std::cerr << filePath << ": " << error << ". Keeping the current units.\n";
+        return false;
+    }
+
+    tables->hasNumerics = false;
+    queueTables(tables);
+
+    return true;
+}
+
+/**
+ * Parse a config file, false with the reason if it is missing or not json.
+ */
+inline bool Game::readConfig(const std::string& filePath, json* data, std::string* error) {
+    std::ifstream f(filePath);
+
+    if (!f) {
+        *error = "cannot open the file";
+        return false;
+    }
+
+    try {
+        *data = json::parse(f);
+    } catch (const json::exception& e) {
+        *error = e.what();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Build the numerics from panel_offsets.json, false with the reason if any entry is broken
+ * or one of the numerics structBuild() reads is missing.
+ */
+inline bool Game::parseNumerics(const json& data, tagNumerics* numerics, std::string* error) {
+    if (!data.is_array() || data.empty()) {
+        *error = "expected a non-empty array of numerics";
+        return false;
+    }
+
+    tagNumerics ret;
 
     for (auto& it : data) {
-        std::string offset = it["Offset"];
-        uint32_t s_offset  = std::stoul(offset, nullptr, 16);
-        Numeric n(it["Name"], s_offset);
-        _numerics.items.push_back(n);
+        uint32_t s_offset;
+
+        if (it.is_object() && it.contains("Path")) {
+            if (!parsePathField(it, &ret.paths, error)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (!it.is_object() || !it.contains("Name") || !it["Name"].is_string() ||
+            !it.contains("Offset") || !it["Offset"].is_string() ||
+            !parseHex(it["Offset"].get<std::string>(), &s_offset)) {
+            *error = "invalid numeric entry " + it.dump();
+            return false;
+        }
+
+        ret.items.push_back(Numeric(NamePool::intern(it["Name"]), s_offset));
+    }
+
+    ret.buildIndex();
+
+    for (const char* name : {"Balance", "Credit Spent", "Power Drain", "Power Output"}) {
+        if (ret.find(name) == nullptr) {
+            *error = std::string("missing numeric \"") + name + "\"";
+            return false;
+        }
+    }
+
+    *numerics = std::move(ret);
+
+    return true;
+}
+
+/**
+ * Add a `{"Name", "Path": [...], "Type", "Size"}` entry to the plan. Path elements are hex
+ * strings like Offset, or plain numbers; Type defaults to Int and Size to the type's size.
+ */
+inline bool Game::parsePathField(const json& entry, PathPlan* paths, std::string* error) {
+    const json& steps = entry["Path"];
+    std::vector<uint32_t> path;
+    FieldType type = FieldType::Int;
+
+    bool valid = entry.contains("Name") && entry["Name"].is_string() && steps.is_array() &&
+                 !steps.empty() && steps.size() <= PATHMAXDEPTH;
+
+    for (size_t i = 0; valid && i < steps.size(); i++) {
+        uint32_t offset = 0;
+
+        if (steps[i].is_string()) {
+            valid = parseHex(steps[i].get<std::string>(), &offset);
+        } else if (steps[i].is_number_unsigned() && steps[i].get<uint64_t>() <= 0xFFFFFFFFu) {
+            offset = steps[i].get<uint32_t>();
+        } else {
+            valid = false;
+        }
+        path.push_back(offset);
+    }
+
+    if (valid && entry.contains("Type")) {
+        valid = entry["Type"].is_string() &&
+                PathPlan::parseFieldType(entry["Type"].get<std::string>(), &type);
+    }
+
+    int size = PathPlan::defaultSize(type);
+    if (valid && entry.contains("Size")) {
+        valid = entry["Size"].is_number_integer();
+        size  = valid ? entry["Size"].get<int>() : 0;
+    }
+
+    if (!valid || !paths->addField(NamePool::intern(entry["Name"]), path, type, size)) {
+        *error = "invalid path entry " + entry.dump();
+        return false;
     }
+
+    return true;
 }
 
-inline void Game::loadUnitsFromJson(std::string filePath) {
-    json data = readJsonFromFile(filePath);
+/**
+ * Build the units from unit_offsets.json, false with the reason if any entry is broken.
+ */
+inline bool Game::parseUnits(const json& data, tagUnits* units, std::string* error) {
+    if (!data.is_object()) {
+        *error = "expected an object of unit lists";
+        return false;
+    }
 
-    _units.items.clear();
+    tagUnits ret;
 
     for (auto& ut : data.items()) {
         UnitType s_ut;
@@ -454,91 +875,494 @@ inline void Game::loadUnitsFromJson(std::string filePath) {
             s_ut = UnitType::Unknown;
         }
 
-        for (auto& u : data[ut.key()]) {
+        if (!ut.value().is_array()) {
+            *error = "\"" + ut.key() + "\" is not a list";
+            return false;
+        }
+
+        for (auto& u : ut.value()) {
             if (u.empty()) {
                 continue;
             }
 
+            uint32_t s_offset;
+
+            if (!u.is_object() || !u.contains("Name") || !u["Name"].is_string() ||
+                !u.contains("Offset") || !u["Offset"].is_string() ||
+                !parseHex(u["Offset"].get<std::string>(), &s_offset) || s_offset % 4 != 0 ||
+                (u.contains("Index") && !u["Index"].is_number_integer()) ||
+                (u.contains("Show") && !u["Show"].is_number()) ||
+                (u.contains("Invalid") && u["Invalid"] != "Yr" && u["Invalid"] != "Ra2")) {
+                *error = "invalid " + ut.key() + " entry " + u.dump();
+                return false;
+            }
+
             bool s_show = true;
             if (u.contains("Show") && u["Show"] == 0) {
                 s_show = false;
             }
 
-            std::string offset = u["Offset"];
-            uint32_t s_offset  = std::stoul(offset, nullptr, 16);
-
             int s_index = 99;
             if (u.contains("Index")) {
                 s_index = u["Index"];
             }
 
-            Unit ub(u["Name"], s_offset, s_ut, s_index, s_show);
+            Unit ub(NamePool::intern(u["Name"]), s_offset, s_ut, s_index, s_show);
 
-            std::string s_invalid;
             if (u.contains("Invalid")) {
-                ub.setInvalid(u["Invalid"]);
+                ub.setInvalid(NamePool::intern(u["Invalid"]));
             }
 
-            _units.items.push_back(ub);
+            ret.items.push_back(ub);
         }
     }
-}
 
-inline void Game::initStrTypes() {
-    _strName    = StrName();
-    _strCountry = StrCountry();
-}
+    if (ret.items.empty()) {
+        *error = "no units";
+        return false;
+    }
 
-inline void Game::initArrays() {
-    _players     = std::array<bool, MAXPLAYER>{};
-    _playerBases = std::array<uint32_t, MAXPLAYER>{};
+    ret.buildIndex();
+    *units = std::move(ret);
 
-    _buildings = std::array<uint32_t, MAXPLAYER>{};
-    _infantrys = std::array<uint32_t, MAXPLAYER>{};
-    _tanks     = std::array<uint32_t, MAXPLAYER>{};
-    _aircrafts = std::array<uint32_t, MAXPLAYER>{};
+    return true;
+}
 
-    _buildings_valid = std::array<uint32_t, MAXPLAYER>{};
-    _infantrys_valid = std::array<uint32_t, MAXPLAYER>{};
-    _tanks_valid     = std::array<uint32_t, MAXPLAYER>{};
-    _aircrafts_valid = std::array<uint32_t, MAXPLAYER>{};
+/**
+ * Reload both offset configs whenever one of them changes on disk.
+ */
+inline bool Game::watchConfig(std::string unitPath, std::string panelPath) {
+    unwatchConfig();
 
-    _houseTypes    = std::array<uint32_t, MAXPLAYER>{};
-    _buildingInfos = std::array<tagBuildingInfo, MAXPLAYER>{};
-    _superTimers   = std::array<tagSuperTimer, MAXPLAYER>{};
-    _statusInfos   = std::array<tagStatusInfo, MAXPLAYER>{};
-    _scoreInfos    = std::array<tagScoreInfo, MAXPLAYER>{};
-    _colors        = std::array<std::string, MAXPLAYER>{};
-    _colors.fill("0x000000");
+    _configWatcher.reset(new ConfigWatcher(
+        {unitPath, panelPath}, [this, unitPath, panelPath] { reloadConfig(unitPath, panelPath); }));
 
-    _playerTeamNumber   = std::array<uint32_t, MAXPLAYER>{};
-    _playerDefeatFlag   = std::array<bool, MAXPLAYER>{};
-    _playerGameoverFlag = std::array<bool, MAXPLAYER>{};
-    _playerWinnerFlag   = std::array<bool, MAXPLAYER>{};
+    if (!_configWatcher->start()) {
+        _configWatcher.reset();
+        return false;
+    }
+
+    return true;
 }
 
-inline void Game::initGameInfo() { _gameInfo = tagGameInfo{}; }
+inline void Game::unwatchConfig() { _configWatcher.reset(); }
 
 /**
- * Return valid player number.
+ * Parse both configs into fresh tables for the next tick. A broken config is reported and
+ * the current tables stay.
  */
-inline int Game::hasPlayer() {
-    int count = 0;
+inline bool Game::reloadConfig(std::string unitPath, std::string panelPath) {
+    std::shared_ptr<tagOffsetTables> tables = std::make_shared<tagOffsetTables>();
+    std::string error;
+    std::string errorPath;
 
-    for (bool it : _players) {
-        if (it) {
-            count++;
+    for (const std::string* filePath : {&unitPath, &panelPath}) {
+        json data;
+
+        bool ok = readConfig(*filePath, &data, &error) &&
+                  (filePath == &unitPath ? parseUnits(data, &tables->units, &error)
+                                         : parseNumerics(data, &tables->numerics, &error));
+
+        if (!ok) {
+            errorPath = *filePath;
+            break;
         }
     }
-    if (count == 0) {
-        std::cerr << "No valid player." << std::endl;
+
+    if (!errorPath.empty()) {
+        std::cerr << "Config reload rejected, " << errorPath << ": " << error
+                  << ". Keeping the current tables.\n";
+        return false;
+    }
+
+    std::cout << "Config reloaded: " << tables->units.items.size() << " units, "
+              << tables->numerics.items.size() << " numerics.\n";
+
+    queueTables(tables);
+
+    return true;
+}
+
+/**
+ * Hand tables to the fetch thread, on top of any it has not applied yet. The fetch thread
+ * owns them from here on.
+ */
+inline void Game::queueTables(std::shared_ptr<tagOffsetTables> tables) {
+    std::lock_guard<std::mutex> lock(_pendingTablesMutex);
+    std::shared_ptr<tagOffsetTables> pending = std::atomic_exchange(&_pendingTables, {});
+
+    if (pending != nullptr && !tables->hasNumerics && pending->hasNumerics) {
+        tables->numerics    = std::move(pending->numerics);
+        tables->hasNumerics = true;
+    }
+
+    if (pending != nullptr && !tables->hasUnits && pending->hasUnits) {
+        tables->units    = std::move(pending->units);
+        tables->hasUnits = true;
+    }
+
+    std::atomic_store(&_pendingTables, tables);
+}
+
+/**
+ * Swap in tables from the last reload, if any. Only called between ticks, so no stage
+ * sees the tables change under it.
+ */
+inline void Game::applyConfig() {
+    std::shared_ptr<tagOffsetTables> tables = std::atomic_exchange(&_pendingTables, {});
+
+    if (tables == nullptr) {
+        return;
+    }
+
+    if (tables->hasNumerics) {
+        _numerics = std::move(tables->numerics);
+    }
+
+    if (tables->hasUnits) {
+        _configUnits = std::move(tables->units);
+    }
+
+    mergeCatalog();
+}
+
+/**
+ * Build the unit catalog of a newly attached game, from the cache if its executable and
+ * type counts were seen before. Waits until the game has loaded its types.
+ */
+inline void Game::refreshCatalog() {
+    std::array<uint32_t, CATALOGKINDS> counts;
+
+    if (!UnitCatalog::readCounts(r, _globals, &counts)) {
+        return;
+    }
+
+    std::string catalogPath = cachePath("catalog", _exeHash);
+
+    if (_exeHash == 0 || _catalogRead || !_catalog.load(catalogPath) ||
+        _catalog.getCounts() != counts) {
+        auto start = std::chrono::steady_clock::now();
+
+        if (!_catalog.discover(r, _globals)) {
+            return;
+        }
+
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+        std::cout << "Discovered " << _catalog.size() << " unit types in " << us / 1000.0
+                  << " ms.\n";
+
+        if (_exeHash != 0 && makeDir(F_CACHEDIR)) {
+            _catalog.save(catalogPath);
+        }
+    }
+
+    _catalogPending = false;
+    _catalogRead    = false;
+    mergeCatalog();
+}
+
+inline void Game::mergeCatalog() {
+    _units           = _catalog.empty() ? _configUnits : _catalog.merge(_configUnits);
+    _unitPlan        = UnitPlan::build(_units, version);
+    _unitPlanPending = false;
+
+    initSnapshot();
+}
+
+/**
+ * Locate the globals of the attached executable from signatures.json, keeping the built-in
+ * offset of any global it does not resolve. Results are cached per executable and
+ * signature file, so a known build is only scanned once.
+ */
+inline void Game::resolveGlobals() {
+    _globals = tagGlobals();
+
+    MappedFile sigFile;
+    if (!sigFile.open(F_SIGNATURES)) {
+        return;
+    }
+
+    std::vector<tagSignature> sigs;
+    std::string error;
+
+    try {
+        json data = json::parse(sigFile.data(), sigFile.data() + sigFile.size());
+
+        if (!SignatureScanner::parse(data, &sigs, &error)) {
+            std::cerr << F_SIGNATURES << ": " << error << "\n";
+            return;
+        }
+    } catch (const json::exception& e) {
+        std::cerr << F_SIGNATURES << ": " << e.what() << "\n";
+        return;
+    }
+
+    if (sigs.empty()) {
+        return;
+    }
+
+    uint64_t sigHash        = fnv1a(sigFile.data(), sigFile.size());
+    std::string globalsPath = cachePath("globals", _exeHash);
+    std::ifstream cached(globalsPath);
+
+    if (_exeHash != 0 && cached) {
+        try {
+            json data = json::parse(cached);
+
+            if (data.at("Signatures").get<uint64_t>() == sigHash) {
+                for (auto& f : _globals.fields()) {
+                    *f.second = data.at(f.first).get<uint32_t>();
+                }
+                return;
+            }
+        } catch (const json::exception&) {
+            _globals = tagGlobals();
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    ProcessImage image;
+    if (!image.load(r)) {
+        std::cerr << "Could not read the game executable, using built-in offsets\n";
+        return;
+    }
+
+    size_t resolved = 0;
+
+    for (auto& sig : sigs) {
+        uint32_t* global = _globals.find(sig.name);
+
+        if (global == nullptr) {
+            std::cerr << F_SIGNATURES << ": unknown global " << sig.name << "\n";
+        } else if (SignatureScanner::resolve(image, sig, global)) {
+            resolved++;
+        } else {
+            std::cerr << "Signature " << sig.name << " not found, using built-in offset\n";
+        }
+    }
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+
+    std::cout << "Resolved " << resolved << " of " << sigs.size() << " globals in "
+              << us / 1000.0 << " ms.\n";
+
+    if (_exeHash != 0 && makeDir(F_CACHEDIR)) {
+        json data;
+        data["Signatures"] = sigHash;
+
+        for (auto& f : _globals.fields()) {
+            data[f.first] = *f.second;
+        }
+
+        std::ofstream f(globalsPath);
+        f << data.dump(1);
+    }
+}
+
+/**
+ * Learn a signature for every global from the attached game, whose offsets must be the
+ * right ones, and write them for resolveGlobals() to use on other builds.
+ */
+inline bool Game::learnSignatures(std::string filePath) {
+    ProcessImage image;
+
+    if (!image.load(r)) {
+        std::cerr << "Could not read the game executable\n";
+        return false;
+    }
+
+    std::vector<tagSignature> sigs;
+
+    for (auto& f : _globals.fields()) {
+        tagSignature sig;
+
+        if (SignatureScanner::learn(image, f.first, *f.second, &sig)) {
+            sigs.push_back(sig);
+        } else {
+            std::cerr << "No unique signature for " << f.first << "\n";
+        }
+    }
+
+    std::ofstream f(filePath);
+    f << SignatureScanner::toJson(sigs).dump(4);
+
+    if (!f) {
+        std::cerr << "Could not write " << filePath << "\n";
+        return false;
+    }
+
+    std::cout << "Learned " << sigs.size() << " of " << _globals.fields().size()
+              << " signatures.\n";
+
+    return true;
+}
+
+inline void Game::initStrTypes() {
+    _strName    = StrName();
+    _strCountry = StrCountry();
+}
+
+inline void Game::initArrays() {
+    _players     = std::array<bool, MAXPLAYER>{};
+    _playerBases = std::array<uint32_t, MAXPLAYER>{};
+
+    _buildings = std::array<uint32_t, MAXPLAYER>{};
+    _infantrys = std::array<uint32_t, MAXPLAYER>{};
+    _tanks     = std::array<uint32_t, MAXPLAYER>{};
+    _aircrafts = std::array<uint32_t, MAXPLAYER>{};
+
+    _buildings_valid = std::array<uint32_t, MAXPLAYER>{};
+    _infantrys_valid = std::array<uint32_t, MAXPLAYER>{};
+    _tanks_valid     = std::array<uint32_t, MAXPLAYER>{};
+    _aircrafts_valid = std::array<uint32_t, MAXPLAYER>{};
+
+    _houseTypes = std::array<uint32_t, MAXPLAYER>{};
+    _superNames.clear();
+
+    _playerTeamNumber   = std::array<uint32_t, MAXPLAYER>{};
+    _playerDefeatFlag   = std::array<bool, MAXPLAYER>{};
+    _playerGameoverFlag = std::array<bool, MAXPLAYER>{};
+    _playerWinnerFlag   = std::array<bool, MAXPLAYER>{};
+
+    _addrsResolved  = false;
+    _fixed          = 0;
+    _classBaseArray = 0;
+    _playerIndexes  = std::array<uint32_t, MAXPLAYER>{};
+}
+
+inline void Game::initGameInfo() {
+    _gameInfo = tagGameInfo{};
+    _snapshot = GameSnapshot{};
+    initSnapshot();
+}
+
+/**
+ * Describe the units and path fields in the snapshot, whenever their plans change.
+ */
+inline void Game::initSnapshot() {
+    size_t units  = std::min(_unitPlan.size(), static_cast<size_t>(SNAPMAXUNITS));
+    size_t fields = std::min(_numerics.paths.fieldCount(), static_cast<size_t>(SNAPMAXFIELDS));
+
+    if (units < _unitPlan.size() || fields < _numerics.paths.fieldCount()) {
+        std::cerr << "Snapshot: only the first " << units << " units and " << fields
+                  << " path fields are listed.\n";
+    }
+
+    for (size_t id = 0; id < units; id++) {
+        Unit& u = _unitPlan.getUnit(id);
+
+        _snapshot.units[id].name  = NamePool::id(u.getName());
+        _snapshot.units[id].index = static_cast<int16_t>(u.getUnitIndex());
+        _snapshot.units[id].show  = u.checkShow();
+    }
+
+    for (size_t f = 0; f < fields; f++) {
+        _snapshot.fields[f].name = NamePool::id(_numerics.paths.getFieldName(f));
+        _snapshot.fields[f].type = _numerics.paths.getFieldType(f);
+        _snapshot.fields[f].size = _numerics.paths.getFieldSize(f);
+    }
+
+    _snapshot.unitCount    = static_cast<int32_t>(units);
+    _snapshot.unitsDropped = static_cast<int32_t>(_unitPlan.size() - units);
+    _snapshot.fieldCount   = static_cast<int32_t>(fields);
+}
+
+/**
+ * Return valid player number.
+ */
+inline int Game::hasPlayer() {
+    int count = 0;
+
+    for (bool it : _players) {
+        if (it) {
+            count++;
+        }
+    }
+    if (count == 0) {
+        std::cerr << "No valid player." << std::endl;
     }
 
     return count;
 }
 
 /**
- * Fetch the data in all the base class.
+ * Mark an attached game valid again once it has players, such as one attached while still
+ * loading. Quiet while there are none, unlike hasPlayer(). Returns whether it is valid.
+ */
+inline bool Game::revalidate() {
+    if (_gameInfo.valid) {
+        return true;
+    }
+
+    if (!r.attached()) {
+        return false;
+    }
+
+    initAddrs();
+    _gameInfo.valid = std::find(_players.begin(), _players.end(), true) != _players.end();
+
+    return _gameInfo.valid;
+}
+
+/**
+ * Declare the refresh stages once. Each stage writes only its own members, a stage that
+ * reads another's output lists it as a dependency.
+ */
+inline void Game::initStages() {
+    _stages.clear();
+
+    _stages.addStage("numerics", [this] {
+        for (auto& it : _numerics.items) {
+            it.fetchData(r, _playerBases);
+        }
+    });
+    _stages.addStage("buildings", [this] { refreshUnits(UnitType::Building); });
+    _stages.addStage("infantry", [this] { refreshUnits(UnitType::Infantry); });
+    _stages.addStage("tanks", [this] { refreshUnits(UnitType::Tank); });
+    _stages.addStage("aircraft", [this] { refreshUnits(UnitType::Aircraft); });
+    _stages.addStage("paths", [this] { _numerics.paths.fetchData(r, _playerBases); });
+    _stages.addStage("names", [this] { _strName.fetchData(r, _playerBases); });
+
+    int countries = _stages.addStage("countries",
+                                     [this] { _strCountry.fetchData(r, _houseTypes); });
+
+    _stages.addStage("buildingInfos", [this] { refreshBuildingInfos(); });
+    _stages.addStage("superTimer", [this] { refreshSuperTimer(); });
+    _stages.addStage("colors", [this] { refreshColors(); });
+    _stages.addStage("status", [this] { refreshStatusInfos(); });
+    _stages.addStage("score", [this] { refreshScoreInfos(); });
+    _stages.addStage("gameInfos", [this] { refreshGameInfos(); }, {countries});
+}
+
+inline void Game::refreshUnits(UnitType utype) {
+    const std::array<uint32_t, MAXPLAYER>* bases  = &_aircrafts;
+    const std::array<uint32_t, MAXPLAYER>* valids = &_aircrafts_valid;
+
+    if (utype == UnitType::Building) {
+        bases  = &_buildings;
+        valids = &_buildings_valid;
+    } else if (utype == UnitType::Infantry) {
+        bases  = &_infantrys;
+        valids = &_infantrys_valid;
+    } else if (utype == UnitType::Tank) {
+        bases  = &_tanks;
+        valids = &_tanks_valid;
+    }
+
+    for (auto& it : _unitPlan.getUnits(utype)) {
+        it.fetchData(r, *bases, *valids);
+    }
+}
+
+/**
+ * Fetch the data in all the base class, independent stages run in parallel unless
+ * _serialRefresh is set.
  */
 inline void Game::refreshInfo() {
     if (!hasPlayer()) {
@@ -547,35 +1371,89 @@ inline void Game::refreshInfo() {
         return;
     }
 
-    for (auto& it : _numerics.items) {
-        it.fetchData(r, _playerBases);
+    TraceScope trace(TraceKind::Stage, "refreshInfo");
+
+    if (_serialRefresh) {
+        _stages.runSerial();
+    } else {
+        _stages.run(&WorkStealingPool::shared());
     }
+}
 
-    for (auto& it : _units.items) {
-        if (it.getUnitType() == UnitType::Building) {
-            it.fetchData(r, _buildings, _buildings_valid);
-        } else if (it.getUnitType() == UnitType::Infantry) {
-            it.fetchData(r, _infantrys, _infantrys_valid);
-        } else if (it.getUnitType() == UnitType::Tank) {
-            it.fetchData(r, _tanks, _tanks_valid);
-        } else {
-            it.fetchData(r, _aircrafts, _aircrafts_valid);
+/**
+ * refreshInfo() between two reads of the frame counter. While the game moved on in between,
+ * the snapshot mixes frames and is refreshed again, up to _captureRetries times; one still
+ * mixed after that goes out with stamp.frameEnd past stamp.frame.
+ *
+ * With _trackDirtyPages, refreshInfo() reads unwritten pages from _pageCache, synced right
+ * before. The frame counter is always read from the game.
+ */
+inline void Game::capture() {
+    ProfileScope scope(&_captureProfile, true);
+
+    auto bump = [](std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    };
+
+    int retries = 0;
+
+    // A new process may reuse the pid of the one restart() let go.
+    if (_pageCacheStale.exchange(false)) {
+        _pageCache.reset();
+    }
+
+    while (true) {
+        int32_t frame    = r.getInt(_globals.gameFrame);
+        int64_t captured = steadyNs();
+
+        // The pages synced are not reads of the game's values, keep them out of a read log.
+        r.setListener(nullptr);
+        bool cached = _trackDirtyPages && _pageCache.sync(r);
+        r.setListener(_readLog.get());
+
+        r.setCache(cached ? &_pageCache : nullptr);
+        refreshInfo();
+        r.setCache(nullptr);
+
+        _snapshot.stamp.frame    = frame;
+        _snapshot.stamp.frameEnd = r.getInt(_globals.gameFrame);
+        _snapshot.stamp.captured = captured;
+
+        if (!_gameInfo.valid || frame == _snapshot.stamp.frameEnd || retries >= _captureRetries) {
+            break;
         }
+
+        retries++;
     }
 
-    _strName.fetchData(r, _playerBases);
-    _strCountry.fetchData(r, _houseTypes);
+    if (!_gameInfo.valid) {
+        return;
+    }
+
+    bump(_captures, 1);
+    bump(_captureRetriesUsed, retries);
+    bump(_capturesRetried, retries > 0 ? 1 : 0);
+    bump(_capturesTorn, _snapshot.stamp.frame != _snapshot.stamp.frameEnd ? 1 : 0);
+}
 
-    refreshBuildingInfos();
-    refreshSuperTimer();
-    refreshColors();
-    refreshStatusInfos();
-    refreshScoreInfos();
+/**
+ * Captures so far and how many of them held a single frame. Safe while the fetch thread
+ * ticks.
+ */
+inline tagCaptureStats Game::captureStats() {
+    tagCaptureStats ret;
 
-    refreshGameInfos();
+    ret.captures   = _captures.load(std::memory_order_relaxed);
+    ret.retried    = _capturesRetried.load(std::memory_order_relaxed);
+    ret.torn       = _capturesTorn.load(std::memory_order_relaxed);
+    ret.retries    = _captureRetriesUsed.load(std::memory_order_relaxed);
+    ret.consistent = ret.captures - std::min(ret.torn, ret.captures);
+    ret.rate       = ret.captures == 0 ? 1 : static_cast<double>(ret.consistent) / ret.captures;
+
+    return ret;
 }
 
-inline void Game::getBuildingInfo(tagBuildingInfo* bi, int addr, int offset_0, int offset_1,
+inline void Game::getBuildingInfo(tagSnapPlayer* p, int addr, int offset_0, int offset_1,
                                   UnitType utype) {
     uint32_t base = r.getAddr(addr + offset_0);
 
@@ -599,23 +1477,15 @@ inline void Game::getBuildingInfo(tagBuildingInfo* bi, int addr, int offset_0, i
         count++;
     }
 
-    Version v = version;
-    auto it   = std::find_if(
-        _units.items.begin(), _units.items.end(),
-        [offset, utype, v](const Unit& u) { return u.checkOffset(offset * 4, utype, v); });
-
-    std::string name;
-
-    if (it != _units.items.end()) {
-        name = it->getName();
+    int id = _unitPlan.findId(offset * 4, utype);
 
-        tagBuildingNode bn = tagBuildingNode(name);
+    if (id >= 0 && id < _snapshot.unitCount && p->buildingCount < SNAPMAXBUILDINGS) {
+        tagSnapBuilding& bn = p->building[p->buildingCount++];
 
+        bn.unit     = static_cast<uint16_t>(id);
         bn.progress = currentCD;
         bn.status   = status;
         bn.number   = count;
-
-        bi->list.push_back(bn);
     }
 }
 
@@ -625,27 +1495,28 @@ inline void Game::refreshBuildingInfos() {
             continue;
         }
 
-        tagBuildingInfo bi;
-
-        uint32_t addr = _playerBases[i];
+        tagSnapPlayer* p = &_snapshot.players[i];
+        uint32_t addr    = _playerBases[i];
 
-        getBuildingInfo(&bi, addr, P_AIRCRAFTOFFSET, P_UNITTYPEOFFSET, UnitType::Aircraft);
-        getBuildingInfo(&bi, addr, P_BUILDINGFIRSTOFFSET, P_BUILDINGTYPEOFFSET, UnitType::Building);
-        getBuildingInfo(&bi, addr, P_BUILDINGSECONDOFFSET, P_BUILDINGTYPEOFFSET,
-                        UnitType::Building);
-        getBuildingInfo(&bi, addr, P_INFANTRYOFFSET, P_INFANTRYTYPEOFFSET, UnitType::Infantry);
-        getBuildingInfo(&bi, addr, P_TANKOFFSET, P_UNITTYPEOFFSET, UnitType::Tank);
-        getBuildingInfo(&bi, addr, P_SHIPOFFSET, P_UNITTYPEOFFSET, UnitType::Tank);
+        p->buildingCount = 0;
 
-        _buildingInfos[i] = bi;
+        getBuildingInfo(p, addr, P_AIRCRAFTOFFSET, P_UNITTYPEOFFSET, UnitType::Aircraft);
+        getBuildingInfo(p, addr, P_BUILDINGFIRSTOFFSET, P_BUILDINGTYPEOFFSET, UnitType::Building);
+        getBuildingInfo(p, addr, P_BUILDINGSECONDOFFSET, P_BUILDINGTYPEOFFSET, UnitType::Building);
+        getBuildingInfo(p, addr, P_INFANTRYOFFSET, P_INFANTRYTYPEOFFSET, UnitType::Infantry);
+        getBuildingInfo(p, addr, P_TANKOFFSET, P_UNITTYPEOFFSET, UnitType::Tank);
+        getBuildingInfo(p, addr, P_SHIPOFFSET, P_UNITTYPEOFFSET, UnitType::Tank);
     }
 }
 
 inline void Game::refreshSuperTimer() {
-    int superNums = r.getInt(SUPERTIMEROFFSET + SUPERTIMERNUMSOFFSET);
+    int superNums = r.getInt(_globals.superTimer + SUPERTIMERNUMSOFFSET);
+
+    uint32_t vectorAddr = r.getAddr(_globals.superTimer + SUPERTIMEVECTOROFFSET);
 
-    uint32_t vectorAddr = r.getAddr(SUPERTIMEROFFSET + SUPERTIMEVECTOROFFSET);
-    std::array<tagSuperTimer, MAXPLAYER> sts;
+    for (auto& p : _snapshot.players) {
+        p.superCount = 0;
+    }
 
     for (int i = 0; i < superNums; i++) {
         uint32_t curAddr = r.getAddr(vectorAddr + i * 4);
@@ -655,28 +1526,37 @@ inline void Game::refreshSuperTimer() {
 
         uint32_t typeAddr = r.getAddr(curAddr + SUPERTIMETYPEOFFSET);
         int duration      = r.getInt(typeAddr + SUPERTIMEDURATIONOFFSET);
-        std::string name  = r.getString(typeAddr + SUPERTIMENAMEOFFSET);
+
+        // Types live as long as the game, so each name is read and interned once.
+        auto name = _superNames.find(typeAddr);
+        if (name == _superNames.end()) {
+            uint32_t id = NamePool::id(r.getString(typeAddr + SUPERTIMENAMEOFFSET));
+            name        = _superNames.emplace(typeAddr, id).first;
+        }
 
         for (int j = 0; j < MAXPLAYER; j++) {
-            if (owner == _playerBases[j]) {
-                tagSuperNode sn(name, duration);
+            tagSnapPlayer& p = _snapshot.players[j];
+
+            if (owner == _playerBases[j] && p.superCount < SNAPMAXSUPERS) {
+                tagSnapSuper& sn = p.superTimer[p.superCount++];
+
+                sn.name   = name->second;
+                sn.total  = duration;
+                sn.left   = 0;
+                sn.status = 0;
                 if (start == -1) {
                     sn.status = 1;
-                    sts[j].list.push_back(sn);
                     continue;
                 }
-                int currentFrame = r.getInt(GAMEFRAMEOFFSET);
+                int currentFrame = r.getInt(_globals.gameFrame);
                 sn.left          = left - (currentFrame - start);
                 if (sn.left <= 0) {
                     sn.left   = 0;
                     sn.status = 2;
                 }
-                sts[j].list.push_back(sn);
             }
         }
     }
-
-    _superTimers = sts;
 }
 
 inline void Game::refreshColors() {
@@ -690,9 +1570,7 @@ inline void Game::refreshColors() {
 
         color = (color & 0x00FF00) | (color << 16 & 0xFF0000) | (color >> 16 & 0x0000FF);
 
-        std::stringstream ss;
-        ss << std::hex << color;
-        _colors[i] = ss.str();
+        _snapshot.players[i].panel.color = color;
     }
 }
 
@@ -714,7 +1592,7 @@ inline void Game::refreshStatusInfos() {
         si.infantrySelfHeal = infantrySelfHeal;
         si.unitSelfHeal     = unitSelfHeal;
 
-        _statusInfos[i] = si;
+        _snapshot.players[i].status = si;
     }
 }
 
@@ -763,23 +1641,18 @@ inline void Game::refreshScoreInfos() {
         si.built = totalBuilt;
         si.alive = totalAlive;
 
-        _scoreInfos[i] = si;
+        _snapshot.players[i].score = si;
     }
 }
 
 inline void Game::refreshGameInfos() {
-    if (version == Version::Yr) {
-        _gameInfo.gameVersion = "Yr";
-    } else {
-        _gameInfo.gameVersion = "Ra2";
-    }
-
-    _gameInfo.currentFrame = r.getInt(GAMEFRAMEOFFSET);
+    _snapshot.gameVersion  = version;
+    _snapshot.currentFrame = r.getInt(_globals.gameFrame);
 
-    _gameInfo.mapName    = mapName;
-    _gameInfo.mapNameUtf = mapNameUtf;
+    copyString(_snapshot.mapName, mapName);
+    copyString(_snapshot.mapNameUtf, mapNameUtf);
 
-    _gameInfo.isGamePaused = r.getBool(GAMEPAUSEOFFSET);
+    _snapshot.isGamePaused = r.getBool(_globals.gamePause);
 
     int playersNum         = 0;
     int defeatedPlayersNum = 0;
@@ -790,18 +1663,31 @@ inline void Game::refreshGameInfos() {
         }
         playersNum++;
 
-        if (_gameInfo.debug.playerDefeatFlag[i]) {
+        if (_playerDefeatFlag[i]) {
             defeatedPlayersNum++;
         }
     }
 
-    _gameInfo.allPlayers  = playersNum;
-    _gameInfo.leftPlayers = playersNum - defeatedPlayersNum;
+    _snapshot.allPlayers  = playersNum;
+    _snapshot.leftPlayers = playersNum - defeatedPlayersNum;
 }
 
+/**
+ * Complete the snapshot with what the stages leave in their own members. Like the stages,
+ * this does not allocate once names and plans are settled.
+ */
 inline void Game::structBuild() {
+    ProfileScope scope(&_structBuildProfile);
+
+    auto numeric = [this](const char* name, int index) {
+        Numeric* n = _numerics.find(name);
+        return n == nullptr ? 0 : static_cast<int32_t>(n->getValueByIndex(index));
+    };
+
+    _snapshot.valid = _gameInfo.valid;
+
     for (int i = 0; i < MAXPLAYER; i++) {
-        tagPlayer p;
+        tagSnapPlayer& p = _snapshot.players[i];
 
         // Filter invalid players
         if (!_players[i] || _strCountry.getValueByIndex(i) == "") {
@@ -810,56 +1696,287 @@ inline void Game::structBuild() {
         }
 
         // Panel info
-        tagPanelInfo pi;
-        pi.playerName    = _strName.getValueByIndex(i);
-        pi.playerNameUtf = _strName.getValueByIndexUtf(i);
-        pi.balance       = _numerics.getItem("Balance").getValueByIndex(i);
-        pi.creditSpent   = _numerics.getItem("Credit Spent").getValueByIndex(i);
-        pi.powerDrain    = _numerics.getItem("Power Drain").getValueByIndex(i);
-        pi.powerOutput   = _numerics.getItem("Power Output").getValueByIndex(i);
-        pi.color         = _colors[i];
-        pi.country       = _strCountry.getValueByIndex(i);
-
-        // Units info
-        tagUnitsInfo ui;
-        for (auto& it : _units.items) {
-            tagUnitSingle us;
-            us.unitName = it.getName();
-            us.index    = it.getUnitIndex();
-            us.num      = it.getValueByIndex(i);
-            us.show     = it.checkShow();
-            ui.units.push_back(us);
-        }
-
-        std::sort(ui.units.begin(), ui.units.end(),
-                  [](const tagUnitSingle& a, const tagUnitSingle& b) { return a.index < b.index; });
-
-        // Players info
-        p.valid      = true;
-        p.panel      = pi;
-        p.units      = ui;
-        p.building   = _buildingInfos[i];
-        p.superTimer = _superTimers[i];
-        p.status     = _statusInfos[i];
-        p.score      = _scoreInfos[i];
+        tagSnapPanel& pi = p.panel;
+        copyString(pi.playerName, _strName.getValueByIndex(i));
+        copyString(pi.playerNameUtf, _strName.getValueByIndexUtf(i));
+        copyString(pi.country, _strCountry.getValueByIndex(i));
+        pi.balance     = numeric("Balance", i);
+        pi.creditSpent = numeric("Credit Spent", i);
+        pi.powerDrain  = numeric("Power Drain", i);
+        pi.powerOutput = numeric("Power Output", i);
+
+        for (int f = 0; f < _snapshot.fieldCount; f++) {
+            pi.fields[f] = _numerics.paths.getRaw(f, i);
+        }
+
+        // Units info, only those the player has any of
+        int32_t dropped = p.unitsDropped;
+
+        p.unitCount    = 0;
+        p.unitsDropped = 0;
+        for (int id = 0; id < _snapshot.unitCount; id++) {
+            uint32_t num = _unitPlan.getUnit(id).getValueByIndex(i);
+
+            if (num != 0 && p.unitCount < SNAPMAXPLAYERUNITS) {
+                p.units[p.unitCount++] = {static_cast<uint16_t>(id), static_cast<int32_t>(num)};
+            } else if (num != 0) {
+                p.unitsDropped++;
+            }
+        }
+
+        if (p.unitsDropped != 0 && dropped == 0) {
+            std::cerr << "Snapshot: player " << i << " has units of " << p.unitsDropped
+                      << " types more than listed.\n";
+        }
+
+        p.valid = true;
 
         // Game info
-        _gameInfo.players[i]            = p;
-        _gameInfo.debug.playerBase[i]   = _playerBases[i];
-        _gameInfo.debug.buildingBase[i] = _buildings[i];
-        _gameInfo.debug.infantryBase[i] = _infantrys[i];
-        _gameInfo.debug.tankBase[i]     = _tanks[i];
-        _gameInfo.debug.aircraftBase[i] = _aircrafts[i];
-        _gameInfo.debug.houseType[i]    = _houseTypes[i];
+        _snapshot.debug.playerBase[i]   = _playerBases[i];
+        _snapshot.debug.buildingBase[i] = _buildings[i];
+        _snapshot.debug.infantryBase[i] = _infantrys[i];
+        _snapshot.debug.tankBase[i]     = _tanks[i];
+        _snapshot.debug.aircraftBase[i] = _aircrafts[i];
+        _snapshot.debug.houseType[i]    = _houseTypes[i];
 
         // Info flags
-        _gameInfo.debug.playerTeamNumber[i]   = _playerTeamNumber[i];
-        _gameInfo.debug.playerDefeatFlag[i]   = _playerDefeatFlag[i];
-        _gameInfo.debug.playerGameoverFlag[i] = _playerGameoverFlag[i];
-        _gameInfo.debug.playerWinnerFlag[i]   = _playerWinnerFlag[i];
+        _snapshot.debug.playerTeamNumber[i]   = _playerTeamNumber[i];
+        _snapshot.debug.playerDefeatFlag[i]   = _playerDefeatFlag[i];
+        _snapshot.debug.playerGameoverFlag[i] = _playerGameoverFlag[i];
+        _snapshot.debug.playerWinnerFlag[i]   = _playerWinnerFlag[i];
     }
 }
 
+/**
+ * Report every tick whose fetch allocated, after the first warmupTicks. Needs a build
+ * counting allocations, see AllocCounter.
+ */
+inline void Game::checkAllocations(int warmupTicks) {
+    if (!AllocCounter::available()) {
+        std::cerr << "Allocations are not counted, define RA2OB_COUNT_ALLOCATIONS.\n";
+        return;
+    }
+
+    _allocWarmup = warmupTicks;
+}
+
+/**
+ * Time and reads of every tick and of each of its steps so far, times in ns: the whole
+ * tick, each refresh stage, structBuild, publish (conversion, history, delay line and
+ * recorder) and initAddrs. Safe to call while the fetch thread ticks.
+ */
+inline std::vector<tagStageStats> Game::profile() {
+    std::vector<tagStageStats> ret;
+
+    ret.push_back(_tickProfile.stats());
+    ret.push_back(_captureProfile.stats());
+    for (size_t i = 0; i < _stages.size(); i++) {
+        ret.push_back(_stages.profile(i).stats());
+    }
+    ret.push_back(_structBuildProfile.stats());
+    ret.push_back(_publishProfile.stats());
+    ret.push_back(_initAddrsProfile.stats());
+
+    return ret;
+}
+
+/**
+ * The wall time in ns that p percent of a step's runs stayed within, 0 for an unknown step.
+ */
+inline uint64_t Game::percentile(const std::string& stage, double p) {
+    if (stage == _tickProfile.getName()) {
+        return _tickProfile.percentile(p);
+    } else if (stage == _captureProfile.getName()) {
+        return _captureProfile.percentile(p);
+    } else if (stage == _initAddrsProfile.getName()) {
+        return _initAddrsProfile.percentile(p);
+    } else if (stage == _structBuildProfile.getName()) {
+        return _structBuildProfile.percentile(p);
+    } else if (stage == _publishProfile.getName()) {
+        return _publishProfile.percentile(p);
+    }
+
+    for (size_t i = 0; i < _stages.size(); i++) {
+        if (stage == _stages.profile(i).getName()) {
+            return _stages.profile(i).percentile(p);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Start the profile over, from the fetch thread or while it does not tick.
+ */
+inline void Game::resetProfile() {
+    _tickProfile.reset();
+    _captureProfile.reset();
+    _initAddrsProfile.reset();
+    _structBuildProfile.reset();
+    _publishProfile.reset();
+
+    _stages.resetProfiles();
+}
+
+/**
+ * Record every fetched frame into a timeline file, see Timeline.hpp.
+ */
+inline bool Game::startRecording(std::string filePath, int keyInterval) {
+    std::unique_ptr<TimelineWriter> writer(new TimelineWriter(filePath, keyInterval));
+
+    if (!writer->isOpen()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_recorderMutex);
+    _recorder = std::move(writer);
+
+    return true;
+}
+
+inline void Game::stopRecording() {
+    std::lock_guard<std::mutex> lock(_recorderMutex);
+    _recorder.reset();
+}
+
+inline void Game::record() {
+    std::lock_guard<std::mutex> lock(_recorderMutex);
+
+    if (_recorder == nullptr || !_gameInfo.valid) {
+        return;
+    }
+
+    if (!_recorder->append(_gameInfo)) {
+        std::cerr << "Timeline: frame went backwards, recording stopped.\n";
+        _recorder.reset();
+    }
+}
+
+/**
+ * Write every read of the ticks to a read log, from the next tick on, see ReadLog.hpp.
+ * Replay it with attachReplay() or ra2ob_replay.
+ */
+inline bool Game::startReadLog(std::string filePath) {
+    std::unique_ptr<ReadRecorder> log(new ReadRecorder(filePath));
+
+    if (!log->isOpen()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_readLogMutex);
+    _pendingReadLog = std::move(log);
+    _readLogPending = true;
+
+    return true;
+}
+
+/**
+ * Close the read log at the next tick.
+ */
+inline void Game::stopReadLog() {
+    std::lock_guard<std::mutex> lock(_readLogMutex);
+    _pendingReadLog.reset();
+    _readLogPending = true;
+}
+
+/**
+ * Swap in the read log asked for and mark the reads of a new tick. A new log starts with
+ * what replaying needs: the version, map and globals, then the reads resolving the players
+ * from scratch, before its first mark. Its first tick discovers the catalog from the game,
+ * not from the cache, as the replay will.
+ */
+inline void Game::applyReadLog() {
+    bool started = false;
+
+    {
+        std::lock_guard<std::mutex> lock(_readLogMutex);
+
+        if (_readLogPending) {
+            _readLog        = std::move(_pendingReadLog);
+            _readLogPending = false;
+            started         = _readLog != nullptr;
+        }
+    }
+
+    r.setListener(_readLog.get());
+
+    if (started) {
+        json globals = json::object();
+
+        for (auto& f : _globals.fields()) {
+            globals[f.first] = *f.second;
+        }
+
+        _readLog->writeMeta(
+            {{"version", static_cast<int>(version)}, {"map", mapNameUtf}, {"globals", globals}});
+
+        _catalogPending = true;
+        _catalogRead    = true;
+        _addrsResolved  = false;
+        initAddrs();
+    }
+
+    r.mark();
+}
+
+/**
+ * One fetch: refresh, publish to the history, delay line and recorder, then re-resolve.
+ * Only the publishing allocates in steady state.
+ */
+inline void Game::tick() {
+    ProfileScope scope(&_tickProfile, true);
+
+    {
+        TraceScope trace(TraceKind::Stage, "applyConfig");
+        applyConfig();
+    }
+
+    applyReadLog();
+
+    if (_catalogPending && std::find(_players.begin(), _players.end(), true) != _players.end()) {
+        TraceScope trace(TraceKind::Stage, "refreshCatalog");
+        refreshCatalog();
+    }
+
+    if (_unitPlanPending) {
+        TraceScope trace(TraceKind::Stage, "mergeCatalog");
+        mergeCatalog();
+    }
+
+    uint64_t allocs = _allocs.count();
+    {
+        AllocScope scope(&_allocs);
+        capture();
+        structBuild();
+    }
+    _fetchAllocs = _allocs.count() - allocs;
+
+    if (_allocWarmup > 0) {
+        _allocWarmup--;
+    } else if (_allocWarmup == 0 && _fetchAllocs != 0) {
+        std::cerr << "Fetch allocated " << _fetchAllocs << " times after warm-up.\n";
+    }
+
+    {
+        ProfileScope publishScope(&_publishProfile);
+
+        _snapshot.stamp.published = steadyNs();
+        toGameInfo(_snapshot, &_gameInfo);
+
+        if (_gameInfo.valid) {
+            _latency.published(_gameInfo.stamp);
+        }
+
+        _history.append(_gameInfo);
+        if (_delayLine.enabled()) {
+            _delayLine.push(_gameInfo);
+        }
+        record();
+    }
+
+    initAddrs();
+}
+
 inline void Game::restart(bool valid) {
     if (!valid) {
         return;
@@ -868,15 +1985,23 @@ inline void Game::restart(bool valid) {
     if (r.getHandle() != nullptr) {
         CloseHandle(r.getHandle());
     }
+    r = Reader(nullptr);
+
+    // The fetch thread may still be syncing or reading through the cache, it resets it.
+    _pageCacheStale.store(true);
 
     std::cout << "Handle Closed.\n";
 
+    _delayLine.finish();
+
     initStrTypes();
     initArrays();
     initGameInfo();
 }
 
 inline void Game::startLoop() {
+    watchConfig();
+
     std::thread d_thread(std::bind(&Game::detectTask, this, T_DETECTTIME));
 
     std::thread f_thread(std::bind(&Game::fetchTask, this, T_FETCHTIME));
@@ -885,27 +2010,52 @@ inline void Game::startLoop() {
     f_thread.detach();
 }
 
+/**
+ * Look for a game every interval while none is attached, then sleep until it exits.
+ */
 inline void Game::detectTask(int interval) {
+    Tracer::nameThread("detect");
+
     while (true) {
-        getHandle();
-        if (r.getHandle() != nullptr) {
-            _gameInfo.valid = true;
-            initAddrs();
-        } else {
-            restart(_gameInfo.valid);
-            _gameInfo.valid = false;
+        {
+            TraceScope trace(TraceKind::Stage, "getHandle");
+            getHandle();
         }
 
-        Sleep(interval);
+        if (r.getHandle() == nullptr) {
+            Sleep(interval);
+            continue;
+        }
+
+        _gameInfo.valid = true;
+        initAddrs();
+        _attached.store(true);
+
+        waitForExit(r.getHandle(), INFINITE);
+
+        _attached.store(false);
+        _gameInfo.valid = false;
+
+        TraceScope trace(TraceKind::Stage, "restart");
+        restart(true);
     }
 }
 
 inline void Game::fetchTask(int interval) {
+    Tracer::nameThread("fetch");
+
     while (true) {
         if (_gameInfo.valid) {
-            refreshInfo();
-            structBuild();
-            initAddrs();
+            tick();
+        } else {
+            TraceScope trace(TraceKind::Stage, "idle");
+            applyConfig();
+            _delayLine.poll();
+
+            // A game attached while still loading has no players yet, nor after a tick.
+            if (_attached.load()) {
+                revalidate();
+            }
         }
 
         Sleep(interval);
@@ -0,0 +1,349 @@
+#ifndef RA2OB_SRC_HISTORY_HPP_
+#define RA2OB_SRC_HISTORY_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "./Datatypes.hpp"
+
+namespace Ra2ob {
+
+enum class HistoryField : int {
+    Balance     = 0,
+    CreditSpent = 1,
+    PowerOutput = 2,
+    PowerDrain  = 3,
+    Kills       = 4,
+    Lost        = 5,
+    Built       = 6,
+    Alive       = 7,
+    UnitCount   = 8,
+    Count       = 9,
+};
+
+struct tagHistoryStats {
+    int samples = 0;
+    int first   = 0;
+    int last    = 0;
+    int min     = 0;
+    int max     = 0;
+    double avg  = 0;
+    double rate = 0;  // Per second of game time.
+};
+
+/**
+ * Fixed-memory ring of the latest per-player numbers, one column per field and player.
+ *
+ * One writer (the fetch thread) appends, any number of readers query without locks: a
+ * reader validates after the fact that the writer has not lapped the slots it read, and
+ * retries if it has.
+ */
+class HistoryRing {
+public:
+    explicit HistoryRing(size_t capacity = 0);
+
+    HistoryRing(const HistoryRing&)    = delete;
+    void operator=(const HistoryRing&) = delete;
+
+    static size_t capacityFor(int minutes, int interval = T_FETCHTIME);
+
+    void reset(size_t capacity);
+    size_t capacity() const;
+    size_t memoryBytes() const;
+
+    void append(const tagGameInfo& gi);
+
+    int latestFrame() const;
+    bool query(int player, HistoryField field, int window, tagHistoryStats* stats) const;
+    size_t series(int player, HistoryField field, int window, std::vector<int>* values,
+                  std::vector<int>* frames = nullptr) const;
+
+private:
+    int fieldValue(const tagPlayer& p, HistoryField field) const;
+    size_t column(int player, HistoryField field) const;
+    bool findWindow(int window, uint64_t* begin, uint64_t* end) const;
+    bool stillValid(uint64_t begin) const;
+
+    size_t m_capacity = 0;
+    size_t m_mask     = 0;
+    std::unique_ptr<std::atomic<int32_t>[]> m_columns;
+    std::unique_ptr<std::atomic<int32_t>[]> m_frames;
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_writing{0};
+    std::atomic<uint64_t> m_matchStart{0};
+    int m_lastFrame = -1;
+};
+
+/**
+ * Source Code
+ */
+
+inline HistoryRing::HistoryRing(size_t capacity) {
+    reset(capacity == 0 ? capacityFor(HISTORYMINUTES) : capacity);
+}
+
+/**
+ * Samples needed to cover the given minutes of wall time at the given poll interval.
+ */
+inline size_t HistoryRing::capacityFor(int minutes, int interval) {
+    return static_cast<size_t>(minutes) * 60 * 1000 / std::max(1, interval);
+}
+
+/**
+ * Reallocate the ring, rounded up to a power of two. Not safe against concurrent readers,
+ * configure it before Game::startLoop().
+ */
+inline void HistoryRing::reset(size_t capacity) {
+    size_t cap = 2;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    size_t columns = MAXPLAYER * static_cast<size_t>(HistoryField::Count);
+
+    m_capacity = cap;
+    m_mask     = cap - 1;
+    m_columns.reset(new std::atomic<int32_t>[columns * cap]);
+    m_frames.reset(new std::atomic<int32_t>[cap]);
+    m_head.store(0);
+    m_writing.store(0);
+    m_matchStart.store(0);
+    m_lastFrame = -1;
+}
+
+inline size_t HistoryRing::capacity() const { return m_capacity; }
+
+inline size_t HistoryRing::memoryBytes() const {
+    size_t columns = MAXPLAYER * static_cast<size_t>(HistoryField::Count) + 1;
+    return columns * m_capacity * sizeof(int32_t);
+}
+
+inline void HistoryRing::append(const tagGameInfo& gi) {
+    if (!gi.valid || gi.currentFrame == m_lastFrame) {
+        return;
+    }
+
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+
+    // A new match, hide the old samples from readers.
+    if (gi.currentFrame < m_lastFrame) {
+        m_matchStart.store(head, std::memory_order_release);
+    }
+
+    // Announce the slot before overwriting it, see stillValid().
+    m_writing.store(head, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t slot = head & m_mask;
+
+    for (int i = 0; i < MAXPLAYER; i++) {
+        for (int f = 0; f < static_cast<int>(HistoryField::Count); f++) {
+            HistoryField field = static_cast<HistoryField>(f);
+            int value          = gi.players[i].valid ? fieldValue(gi.players[i], field) : 0;
+
+            m_columns[column(i, field) + slot].store(value, std::memory_order_relaxed);
+        }
+    }
+
+    m_frames[slot].store(gi.currentFrame, std::memory_order_relaxed);
+    m_head.store(head + 1, std::memory_order_release);
+
+    m_lastFrame = gi.currentFrame;
+}
+
+inline int HistoryRing::latestFrame() const {
+    uint64_t head = m_head.load(std::memory_order_acquire);
+
+    if (head == m_matchStart.load(std::memory_order_acquire)) {
+        return -1;
+    }
+
+    return m_frames[(head - 1) & m_mask].load(std::memory_order_relaxed);
+}
+
+/**
+ * Stats over the samples within `window` frames of the latest one.
+ */
+inline bool HistoryRing::query(int player, HistoryField field, int window,
+                               tagHistoryStats* stats) const {
+    if (player < 0 || player >= MAXPLAYER || field >= HistoryField::Count) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint64_t begin;
+        uint64_t end;
+
+        if (!findWindow(window, &begin, &end)) {
+            return false;
+        }
+
+        size_t col = column(player, field);
+
+        tagHistoryStats s;
+        int64_t sum = 0;
+
+        s.first = m_columns[col + (begin & m_mask)].load(std::memory_order_relaxed);
+        s.min   = s.first;
+        s.max   = s.first;
+
+        for (uint64_t i = begin; i < end; i++) {
+            int v = m_columns[col + (i & m_mask)].load(std::memory_order_relaxed);
+
+            s.min = std::min(s.min, v);
+            s.max = std::max(s.max, v);
+
+            sum += v;
+        }
+
+        s.last    = m_columns[col + ((end - 1) & m_mask)].load(std::memory_order_relaxed);
+        s.samples = static_cast<int>(end - begin);
+        s.avg     = static_cast<double>(sum) / s.samples;
+
+        int firstFrame = m_frames[begin & m_mask].load(std::memory_order_relaxed);
+        int lastFrame  = m_frames[(end - 1) & m_mask].load(std::memory_order_relaxed);
+
+        if (lastFrame > firstFrame) {
+            s.rate = static_cast<double>(s.last - s.first) * GAMESPEED / (lastFrame - firstFrame);
+        }
+
+        if (stillValid(begin)) {
+            *stats = s;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Copy the samples within `window` frames of the latest one, oldest first.
+ */
+inline size_t HistoryRing::series(int player, HistoryField field, int window,
+                                  std::vector<int>* values, std::vector<int>* frames) const {
+    if (player < 0 || player >= MAXPLAYER || field >= HistoryField::Count) {
+        return 0;
+    }
+
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint64_t begin;
+        uint64_t end;
+
+        values->clear();
+        if (frames != nullptr) {
+            frames->clear();
+        }
+
+        if (!findWindow(window, &begin, &end)) {
+            return 0;
+        }
+
+        size_t col = column(player, field);
+
+        for (uint64_t i = begin; i < end; i++) {
+            values->push_back(m_columns[col + (i & m_mask)].load(std::memory_order_relaxed));
+
+            if (frames != nullptr) {
+                frames->push_back(m_frames[i & m_mask].load(std::memory_order_relaxed));
+            }
+        }
+
+        if (stillValid(begin)) {
+            return values->size();
+        }
+    }
+
+    values->clear();
+    return 0;
+}
+
+inline int HistoryRing::fieldValue(const tagPlayer& p, HistoryField field) const {
+    switch (field) {
+        case HistoryField::Balance:
+            return p.panel.balance;
+        case HistoryField::CreditSpent:
+            return p.panel.creditSpent;
+        case HistoryField::PowerOutput:
+            return p.panel.powerOutput;
+        case HistoryField::PowerDrain:
+            return p.panel.powerDrain;
+        case HistoryField::Kills:
+            return p.score.kills;
+        case HistoryField::Lost:
+            return p.score.lost;
+        case HistoryField::Built:
+            return p.score.built;
+        case HistoryField::Alive:
+            return p.score.alive;
+        case HistoryField::UnitCount: {
+            int count = 0;
+            for (auto& u : p.units.units) {
+                count += u.num;
+            }
+            return count;
+        }
+        default:
+            return 0;
+    }
+}
+
+inline size_t HistoryRing::column(int player, HistoryField field) const {
+    return (static_cast<size_t>(player) * static_cast<size_t>(HistoryField::Count) +
+            static_cast<size_t>(field)) *
+           m_capacity;
+}
+
+/**
+ * Binary search the frame column for the oldest sample inside the window.
+ */
+inline bool HistoryRing::findWindow(int window, uint64_t* begin, uint64_t* end) const {
+    uint64_t head  = m_head.load(std::memory_order_acquire);
+    uint64_t start = m_matchStart.load(std::memory_order_acquire);
+
+    // Skip the slot the writer may be filling right now.
+    if (head + 1 > m_capacity && head + 1 - m_capacity > start) {
+        start = head + 1 - m_capacity;
+    }
+
+    if (head <= start) {
+        return false;
+    }
+
+    int from = m_frames[(head - 1) & m_mask].load(std::memory_order_relaxed) - window;
+
+    uint64_t lo = start;
+    uint64_t hi = head - 1;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+
+        if (m_frames[mid & m_mask].load(std::memory_order_relaxed) < from) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *begin = lo;
+    *end   = head;
+
+    return true;
+}
+
+/**
+ * True if none of the slots from `begin` on was overwritten while the reader looked at them.
+ */
+inline bool HistoryRing::stillValid(uint64_t begin) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    uint64_t writing = m_writing.load(std::memory_order_relaxed);
+
+    return begin + m_capacity > writing;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_HISTORY_HPP_
@@ -0,0 +1,152 @@
+#ifndef RA2OB_SRC_LATENCY_HPP_
+#define RA2OB_SRC_LATENCY_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>  // NOLINT
+
+#include "./Datatypes.hpp"
+#include "./Profile.hpp"
+
+namespace Ra2ob {
+
+/**
+ * How old published data is, from the stamps snapshots carry (see tagStamp), all in ns:
+ *
+ * - publishAge: from reading the frame to publishing it, what the fetch adds.
+ * - deliveryAge: from reading the frame to a consumer having it, as consumers report.
+ * - staleness: how old the previous snapshot had become when the next one was published,
+ *   the worst age a consumer polling at random sees.
+ * - skippedFrames: game frames between two published frames that nobody saw.
+ *
+ * The game reached a frame at most one poll interval before it was read, so the game's
+ * frame rate and the poll interval bound the rest.
+ */
+class LatencyTracker {
+public:
+    LatencyTracker() {}
+
+    LatencyTracker(const LatencyTracker&) = delete;
+    void operator=(const LatencyTracker&) = delete;
+
+    void published(const tagStamp& stamp);
+    void delivered(const tagStamp& stamp, int64_t at = 0);
+    void reset();
+
+    const LatencyHistogram& publishAge() const;
+    const LatencyHistogram& deliveryAge() const;
+    const LatencyHistogram& staleness() const;
+    const LatencyHistogram& skippedFrames() const;
+    uint64_t skippedTotal() const;
+
+private:
+    LatencyHistogram m_publishAge;
+    LatencyHistogram m_deliveryAge;
+    LatencyHistogram m_staleness;
+    LatencyHistogram m_skippedFrames;
+    std::atomic<uint64_t> m_skippedTotal{0};
+
+    int32_t m_lastFrame    = -1;
+    int64_t m_lastCaptured = 0;
+
+    std::mutex m_deliveryMutex;  // Consumers may report from several threads.
+};
+
+void printLatency(const LatencyTracker& latency);
+
+/**
+ * Source Code
+ */
+
+/**
+ * A snapshot went out, from the thread that ticks.
+ */
+inline void LatencyTracker::published(const tagStamp& stamp) {
+    if (stamp.captured == 0) {
+        return;
+    }
+
+    int64_t age = stamp.published - stamp.captured;
+    m_publishAge.record(age > 0 ? age : 0);
+
+    if (m_lastCaptured != 0) {
+        int64_t stale = stamp.published - m_lastCaptured;
+        m_staleness.record(stale > 0 ? stale : 0);
+    }
+
+    // A frame counter going back is a new match, not a gap.
+    if (m_lastFrame >= 0 && stamp.frame > m_lastFrame) {
+        uint64_t skipped = static_cast<uint64_t>(stamp.frame - m_lastFrame - 1);
+
+        m_skippedFrames.record(skipped);
+        m_skippedTotal.store(m_skippedTotal.load(std::memory_order_relaxed) + skipped,
+                             std::memory_order_relaxed);
+    }
+
+    m_lastFrame    = stamp.frame;
+    m_lastCaptured = stamp.captured;
+}
+
+/**
+ * A consumer has the snapshot with this stamp, at steadyNs() at or now. Any thread.
+ */
+inline void LatencyTracker::delivered(const tagStamp& stamp, int64_t at) {
+    if (stamp.captured == 0) {
+        return;
+    }
+
+    int64_t age = (at == 0 ? steadyNs() : at) - stamp.captured;
+
+    std::lock_guard<std::mutex> lock(m_deliveryMutex);
+    m_deliveryAge.record(age > 0 ? age : 0);
+}
+
+/**
+ * Start over, from the thread that ticks while no consumer reports.
+ */
+inline void LatencyTracker::reset() {
+    m_publishAge.reset();
+    m_deliveryAge.reset();
+    m_staleness.reset();
+    m_skippedFrames.reset();
+    m_skippedTotal.store(0, std::memory_order_relaxed);
+
+    m_lastFrame    = -1;
+    m_lastCaptured = 0;
+}
+
+inline const LatencyHistogram& LatencyTracker::publishAge() const { return m_publishAge; }
+
+inline const LatencyHistogram& LatencyTracker::deliveryAge() const { return m_deliveryAge; }
+
+inline const LatencyHistogram& LatencyTracker::staleness() const { return m_staleness; }
+
+inline const LatencyHistogram& LatencyTracker::skippedFrames() const { return m_skippedFrames; }
+
+inline uint64_t LatencyTracker::skippedTotal() const {
+    return m_skippedTotal.load(std::memory_order_relaxed);
+}
+
+/**
+ * One line per measure, ages in ms.
+ */
+inline void printLatency(const LatencyTracker& latency) {
+    auto line = [](const char* name, const LatencyHistogram& h, double unit) {
+        std::printf("%-14s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name,
+                    static_cast<unsigned long long>(h.count()), h.mean() / unit,
+                    h.percentile(50) / unit, h.percentile(90) / unit, h.percentile(99) / unit,
+                    h.max() / unit);
+    };
+
+    std::printf("%-14s %9s %9s %9s %9s %9s %9s\n", "latency", "samples", "mean", "p50", "p90",
+                "p99", "max");
+    line("publish ms", latency.publishAge(), 1e6);
+    line("delivery ms", latency.deliveryAge(), 1e6);
+    line("staleness ms", latency.staleness(), 1e6);
+    line("skipped", latency.skippedFrames(), 1);
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_LATENCY_HPP_
@@ -0,0 +1,459 @@
+#ifndef RA2OB_SRC_PAGECACHE_HPP_
+#define RA2OB_SRC_PAGECACHE_HPP_
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Reader.hpp"
+
+namespace Ra2ob {
+
+// Bits of a /proc/pid/pagemap entry.
+constexpr uint64_t PAGEMAPPRESENT   = 1ull << 63;
+constexpr uint64_t PAGEMAPSWAPPED   = 1ull << 62;
+constexpr uint64_t PAGEMAPSOFTDIRTY = 1ull << 55;
+
+struct tagPageCacheStats {
+    uint64_t syncs  = 0;  // sync() calls that kept track of the pages.
+    uint64_t pages  = 0;  // Cached now.
+    uint64_t clean  = 0;  // Pages reused without reading, over all syncs.
+    uint64_t loaded = 0;  // Pages read, over all syncs.
+};
+
+/**
+ * The pages of the target that ticks read, read again only once the target wrote them.
+ *
+ * On Linux the kernel marks the pages a process writes soft-dirty. sync() reads the marks of
+ * the cached pages from /proc/pid/pagemap, clears them through /proc/pid/clear_refs and reads
+ * the marked pages again in one readBatch(). Until the next sync() reads are answered from
+ * the copies; a read of a page not cached goes to the target, and its page is cached by the
+ * next sync(). Pages not read for PAGECACHEIDLE syncs are dropped. A MemorySource keeps the
+ * marks itself, see takeDirtyPages().
+ *
+ * A write between reading the marks and clearing them goes unseen, and the page stays stale
+ * without the capture noticing, so every page is read again every PAGECACHEREFRESH syncs
+ * regardless. Clearing goes for the whole process: every page the game writes afterwards
+ * takes a write fault, each tick. PAGEMAP_SCAN with PM_SCAN_WP_MATCHING reads and clears in
+ * one step, but only for memory the target registered with userfaultfd itself, which the
+ * game does not.
+ *
+ * Without soft-dirty pages (Windows, a kernel without CONFIG_MEM_SOFT_DIRTY, no permission
+ * for clear_refs) sync() returns false and everything is read from the target.
+ */
+class PageCache : public ReadCache {
+public:
+    PageCache() {}
+    ~PageCache();
+
+    PageCache(const PageCache&)      = delete;
+    void operator=(const PageCache&) = delete;
+
+    bool sync(Reader& r);
+    void reset();
+    bool lookup(uint32_t addr, void* value, uint32_t size) override;
+    tagPageCacheStats stats();
+
+    static bool softDirtySupported();
+
+private:
+    void attach(Reader& r);
+    void update();
+    bool takeDirty();
+
+    HANDLE m_handle        = nullptr;
+    MemorySource* m_source = nullptr;
+    bool m_attached        = false;
+    bool m_available       = false;
+    int m_pagemap          = -1;
+    int m_clearRefs        = -1;
+    uint32_t m_epoch       = 0;  // Syncs since attach().
+
+    // By page number, PAGECACHESIZE bytes of m_data each. Only sync() changes them.
+    std::vector<uint32_t> m_pages;
+    std::vector<uint8_t> m_data;
+    std::vector<uint8_t> m_valid;
+    std::vector<uint8_t> m_dirty;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_used;  // Epoch of the last lookup().
+
+    std::vector<uint64_t> m_entries;  // Read from pagemap.
+    std::vector<tagReadRequest> m_batch;
+    std::vector<uint32_t> m_adding;
+
+    std::mutex m_wantedMutex;
+    std::vector<uint32_t> m_wanted;  // Pages lookup() missed.
+
+    std::atomic<uint64_t> m_syncs{0};
+    std::atomic<uint64_t> m_clean{0};
+    std::atomic<uint64_t> m_loaded{0};
+    std::atomic<uint64_t> m_cached{0};
+};
+
+/**
+ * Source Code
+ */
+
+inline PageCache::~PageCache() { reset(); }
+
+/**
+ * Bring the copies up to date with the target of r before a tick reads through them, from
+ * the thread that ticks while r has no cache set. False if pages are not tracked, then r
+ * should read without the cache.
+ */
+inline bool PageCache::sync(Reader& r) {
+    TraceScope trace(TraceKind::Stage, "syncPages");
+
+    if (!m_attached || r.getHandle() != m_handle || r.getSource() != m_source) {
+        attach(r);
+    }
+
+    if (!m_available) {
+        return false;
+    }
+
+    m_epoch++;
+    update();
+
+    if (!takeDirty()) {
+        std::cerr << "PageCache: dirty pages are not tracked, reading every page.\n";
+        m_available = false;
+        return false;
+    }
+
+    bool refresh = m_epoch % PAGECACHEREFRESH == 0;
+
+    m_batch.clear();
+    for (size_t i = 0; i < m_pages.size(); i++) {
+        if (refresh || !m_valid[i] || m_dirty[i]) {
+            m_batch.push_back({m_pages[i] << PAGECACHESHIFT, &m_data[i << PAGECACHESHIFT],
+                               PAGECACHESIZE, false});
+        }
+    }
+
+    r.readBatch(m_batch.data(), m_batch.size());
+
+    for (const tagReadRequest& req : m_batch) {
+        size_t i = (static_cast<uint8_t*>(req.buf) - m_data.data()) >> PAGECACHESHIFT;
+
+        m_valid[i] = req.ok;
+    }
+
+    auto bump = [](std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    };
+
+    bump(m_syncs, 1);
+    bump(m_clean, m_pages.size() - m_batch.size());
+    bump(m_loaded, m_batch.size());
+    m_cached.store(m_pages.size(), std::memory_order_relaxed);
+
+    return true;
+}
+
+/**
+ * Drop every page, the next sync() starts over with its reader's target.
+ */
+inline void PageCache::reset() {
+#ifndef _WIN32
+    if (m_pagemap >= 0) {
+        close(m_pagemap);
+    }
+    if (m_clearRefs >= 0) {
+        close(m_clearRefs);
+    }
+#endif
+
+    m_handle    = nullptr;
+    m_source    = nullptr;
+    m_attached  = false;
+    m_available = false;
+    m_pagemap   = -1;
+    m_clearRefs = -1;
+    m_epoch     = 0;
+
+    m_pages.clear();
+    m_data.clear();
+    m_valid.clear();
+    m_dirty.clear();
+    m_used.reset();
+    m_entries.clear();
+
+    std::lock_guard<std::mutex> lock(m_wantedMutex);
+    m_wanted.clear();
+    m_cached.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Copy the size bytes at addr if all their pages are cached, any thread. Missing pages are
+ * noted for the next sync().
+ */
+inline bool PageCache::lookup(uint32_t addr, void* value, uint32_t size) {
+    uint8_t* out = static_cast<uint8_t*>(value);
+    uint64_t end = static_cast<uint64_t>(addr) + size;
+    bool ret     = true;
+
+    for (uint64_t at = addr; at < end;) {
+        uint32_t page = static_cast<uint32_t>(at >> PAGECACHESHIFT);
+        uint64_t next = std::min(end, static_cast<uint64_t>(page + 1ull) << PAGECACHESHIFT);
+        auto it       = std::lower_bound(m_pages.begin(), m_pages.end(), page);
+
+        if (it == m_pages.end() || *it != page) {
+            std::lock_guard<std::mutex> lock(m_wantedMutex);
+            m_wanted.push_back(page);
+            ret = false;
+        } else {
+            size_t i = it - m_pages.begin();
+
+            if (m_used[i].load(std::memory_order_relaxed) != m_epoch) {
+                m_used[i].store(m_epoch, std::memory_order_relaxed);
+            }
+
+            if (!m_valid[i]) {
+                ret = false;
+            } else if (ret) {
+                std::memcpy(out + (at - addr),
+                            &m_data[(i << PAGECACHESHIFT) + (at & (PAGECACHESIZE - 1))],
+                            next - at);
+            }
+        }
+
+        at = next;
+    }
+
+    return ret;
+}
+
+/**
+ * Totals since the cache was made, safe while the fetch thread ticks.
+ */
+inline tagPageCacheStats PageCache::stats() {
+    tagPageCacheStats ret;
+
+    ret.syncs  = m_syncs.load(std::memory_order_relaxed);
+    ret.pages  = m_cached.load(std::memory_order_relaxed);
+    ret.clean  = m_clean.load(std::memory_order_relaxed);
+    ret.loaded = m_loaded.load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+/**
+ * Whether the kernel marks written pages soft-dirty, tried once on a page of our own.
+ */
+inline bool PageCache::softDirtySupported() {
+#ifdef _WIN32
+    return false;
+#else
+    static const bool ret = [] {
+        if (sysconf(_SC_PAGESIZE) != PAGECACHESIZE) {
+            return false;
+        }
+
+        void* p = mmap(nullptr, PAGECACHESIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+
+        int pagemap   = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+        int clearRefs = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+
+        volatile uint8_t* byte = static_cast<volatile uint8_t*>(p);
+        uint64_t cleared       = 0;
+        uint64_t written       = 0;
+
+        off_t offset = static_cast<off_t>(reinterpret_cast<uintptr_t>(p) / PAGECACHESIZE * 8);
+
+        *byte   = 1;
+        bool ok = pagemap >= 0 && clearRefs >= 0 && write(clearRefs, "4", 1) == 1 &&
+                  pread(pagemap, &cleared, 8, offset) == 8;
+        *byte   = 2;
+        ok      = ok && pread(pagemap, &written, 8, offset) == 8;
+
+        if (pagemap >= 0) {
+            close(pagemap);
+        }
+        if (clearRefs >= 0) {
+            close(clearRefs);
+        }
+        munmap(p, PAGECACHESIZE);
+
+        return ok && (cleared & PAGEMAPSOFTDIRTY) == 0 && (written & PAGEMAPSOFTDIRTY) != 0;
+    }();
+
+    return ret;
+#endif
+}
+
+/**
+ * Start over with the target of r, finding out whether its pages can be tracked.
+ */
+inline void PageCache::attach(Reader& r) {
+    reset();
+
+    m_handle   = r.getHandle();
+    m_source   = r.getSource();
+    m_attached = true;
+
+    if (m_source != nullptr) {
+        // Whether it keeps track shows at the first takeDirty().
+        m_available = true;
+        return;
+    }
+
+#ifndef _WIN32
+    if (m_handle == nullptr) {
+        return;
+    }
+
+    if (!softDirtySupported()) {
+        std::cerr << "PageCache: the kernel does not track soft-dirty pages, reading every "
+                     "page.\n";
+        return;
+    }
+
+    std::string dir = "/proc/" + std::to_string(reinterpret_cast<intptr_t>(m_handle)) + "/";
+
+    m_pagemap   = open((dir + "pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+    m_clearRefs = open((dir + "clear_refs").c_str(), O_WRONLY | O_CLOEXEC);
+
+    if (m_pagemap < 0 || m_clearRefs < 0) {
+        std::cerr << "PageCache: could not open " << dir << "pagemap and clear_refs, reading "
+                  << "every page.\n";
+        return;
+    }
+
+    m_available = true;
+#endif
+}
+
+/**
+ * Cache the pages lookup() missed and drop those it stopped asking for. Only allocates when
+ * the set of pages changes.
+ */
+inline void PageCache::update() {
+    {
+        std::lock_guard<std::mutex> lock(m_wantedMutex);
+        m_adding.swap(m_wanted);
+    }
+
+    std::sort(m_adding.begin(), m_adding.end());
+    m_adding.erase(std::unique(m_adding.begin(), m_adding.end()), m_adding.end());
+    m_adding.erase(std::remove_if(m_adding.begin(), m_adding.end(),
+                                  [this](uint32_t page) {
+                                      return std::binary_search(m_pages.begin(),
+                                                                m_pages.end(), page);
+                                  }),
+                   m_adding.end());
+
+    auto idle = [this](size_t i) {
+        return m_epoch - m_used[i].load(std::memory_order_relaxed) > PAGECACHEIDLE;
+    };
+
+    size_t dropped = 0;
+    for (size_t i = 0; i < m_pages.size(); i++) {
+        dropped += idle(i) ? 1 : 0;
+    }
+
+    if (m_adding.empty() && dropped == 0) {
+        return;
+    }
+
+    size_t n = m_pages.size() - dropped + m_adding.size();
+    std::vector<uint32_t> pages;
+    std::vector<uint8_t> data(n << PAGECACHESHIFT);
+    std::vector<uint8_t> valid;
+    std::unique_ptr<std::atomic<uint32_t>[]> used(new std::atomic<uint32_t>[n]);
+
+    pages.reserve(n);
+    valid.reserve(n);
+
+    size_t a = 0;
+
+    for (size_t i = 0; i <= m_pages.size(); i++) {
+        while (a < m_adding.size() && (i == m_pages.size() || m_adding[a] < m_pages[i])) {
+            used[pages.size()].store(m_epoch, std::memory_order_relaxed);
+            pages.push_back(m_adding[a++]);
+            valid.push_back(0);
+        }
+
+        if (i == m_pages.size() || idle(i)) {
+            continue;
+        }
+
+        std::memcpy(&data[pages.size() << PAGECACHESHIFT], &m_data[i << PAGECACHESHIFT],
+                    PAGECACHESIZE);
+        used[pages.size()].store(m_used[i].load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        pages.push_back(m_pages[i]);
+        valid.push_back(m_valid[i]);
+    }
+
+    m_pages.swap(pages);
+    m_data.swap(data);
+    m_valid.swap(valid);
+    m_used.swap(used);
+    m_dirty.assign(n, 0);
+    m_entries.assign(n, 0);
+    m_adding.clear();
+}
+
+/**
+ * Set m_dirty for the pages written since the last call.
+ */
+inline bool PageCache::takeDirty() {
+    if (m_source != nullptr) {
+        return m_source->takeDirtyPages(m_pages.data(), m_pages.size(), m_dirty.data());
+    }
+
+#ifdef _WIN32
+    return false;
+#else
+    // A pread() per run of consecutive pages, right before clearing to keep the gap short.
+    for (size_t i = 0; i < m_pages.size();) {
+        size_t j = i + 1;
+
+        while (j < m_pages.size() && m_pages[j] == m_pages[j - 1] + 1) {
+            j++;
+        }
+
+        ssize_t bytes = static_cast<ssize_t>((j - i) * sizeof(uint64_t));
+        off_t offset  = static_cast<off_t>(m_pages[i]) * sizeof(uint64_t);
+
+        if (pread(m_pagemap, &m_entries[i], bytes, offset) != bytes) {
+            return false;
+        }
+
+        i = j;
+    }
+
+    if (write(m_clearRefs, "4", 1) != 1) {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_pages.size(); i++) {
+        uint64_t e = m_entries[i];
+
+        m_dirty[i] = (e & PAGEMAPSOFTDIRTY) != 0 || (e & (PAGEMAPPRESENT | PAGEMAPSWAPPED)) == 0;
+    }
+
+    return true;
+#endif
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_PAGECACHE_HPP_
@@ -0,0 +1,289 @@
+#ifndef RA2OB_SRC_PATHPLAN_HPP_
+#define RA2OB_SRC_PATHPLAN_HPP_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Reader.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+/**
+ * Fields behind pointer paths from the player base, read together once per tick.
+ *
+ * A path [a, b, c] reads the pointer at base + a, then the pointer at that + b, then the
+ * field at that + c. The pointers of all paths form a tree, so a prefix shared by several
+ * fields is dereferenced once. The tree is read a level at a time, each level and then the
+ * fields as one batch of reads for all players.
+ */
+class PathPlan {
+public:
+    PathPlan();
+
+    bool addField(const char* name, const std::vector<uint32_t>& path, FieldType type, int size);
+    bool addField(const tagPathEntry& entry);
+    void clear();
+
+    size_t fieldCount() const;
+    size_t nodeCount() const;
+    int depth() const;
+    const char* getFieldName(size_t field) const;
+    FieldType getFieldType(size_t field) const;
+    int getFieldSize(size_t field) const;
+    uint64_t getRaw(size_t field, int index) const;
+    json getValue(size_t field, int index) const;
+
+    void fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets);
+
+    static json decode(uint64_t raw, FieldType type, int size);
+    static bool parseFieldType(const std::string& str, FieldType* type);
+    static const char* fieldTypeName(FieldType type);
+    static int defaultSize(FieldType type);
+    static bool validSize(FieldType type, int size);
+
+private:
+    // One dereference, parent -1 is the player base.
+    struct Node {
+        int parent;
+        uint32_t offset;
+        std::array<uint32_t, MAXPLAYER> addr;
+    };
+
+    struct Field {
+        const char* name;
+        int node;
+        uint32_t offset;
+        FieldType type;
+        int size;
+        std::array<uint64_t, MAXPLAYER> value;
+    };
+
+    uint32_t parentAddr(int parent, const std::array<uint32_t, MAXPLAYER>& baseOffsets,
+                        int index) const;
+
+    std::vector<Node> m_nodes;
+    std::vector<std::vector<int>> m_levels;
+    std::map<std::pair<int, uint32_t>, int> m_nodeIndex;
+    std::vector<Field> m_fields;
+    std::vector<tagReadRequest> m_batch;
+};
+
+/**
+ * Source Code
+ */
+
+inline PathPlan::PathPlan() {}
+
+/**
+ * Add a field, false if the path is empty, too deep, or the size does not fit the type.
+ */
+inline bool PathPlan::addField(const char* name, const std::vector<uint32_t>& path,
+                               FieldType type, int size) {
+    if (path.empty() || path.size() > PATHMAXDEPTH || !validSize(type, size)) {
+        return false;
+    }
+
+    int parent = -1;
+
+    for (size_t level = 0; level + 1 < path.size(); level++) {
+        std::pair<int, uint32_t> key(parent, path[level]);
+
+        auto it = m_nodeIndex.find(key);
+        if (it != m_nodeIndex.end()) {
+            parent = it->second;
+            continue;
+        }
+
+        int id = static_cast<int>(m_nodes.size());
+        m_nodes.push_back(Node{parent, path[level], {}});
+        m_nodeIndex[key] = id;
+
+        if (m_levels.size() <= level) {
+            m_levels.resize(level + 1);
+        }
+        m_levels[level].push_back(id);
+
+        parent = id;
+    }
+
+    m_fields.push_back(Field{name, parent, path.back(), type, size, {}});
+
+    return true;
+}
+
+inline bool PathPlan::addField(const tagPathEntry& entry) {
+    std::vector<uint32_t> path(entry.path, entry.path + entry.depth);
+    return addField(entry.name, path, entry.type, entry.size);
+}
+
+inline void PathPlan::clear() {
+    m_nodes.clear();
+    m_levels.clear();
+    m_nodeIndex.clear();
+    m_fields.clear();
+}
+
+inline size_t PathPlan::fieldCount() const { return m_fields.size(); }
+
+/**
+ * Pointers dereferenced per player and tick.
+ */
+inline size_t PathPlan::nodeCount() const { return m_nodes.size(); }
+
+inline int PathPlan::depth() const { return static_cast<int>(m_levels.size()); }
+
+inline const char* PathPlan::getFieldName(size_t field) const { return m_fields[field].name; }
+
+inline FieldType PathPlan::getFieldType(size_t field) const { return m_fields[field].type; }
+
+inline int PathPlan::getFieldSize(size_t field) const { return m_fields[field].size; }
+
+/**
+ * The field's bytes for a player, 0 while any pointer on its path is null or unreadable.
+ */
+inline uint64_t PathPlan::getRaw(size_t field, int index) const {
+    return m_fields[field].value[index];
+}
+
+/**
+ * The field's value for a player as its declared type.
+ */
+inline json PathPlan::getValue(size_t field, int index) const {
+    const Field& f = m_fields[field];
+    return decode(f.value[index], f.type, f.size);
+}
+
+/**
+ * Raw field bytes as a value of the type.
+ */
+inline json PathPlan::decode(uint64_t raw, FieldType type, int size) {
+    switch (type) {
+        case FieldType::Int: {
+            int shift = 64 - size * 8;
+            return static_cast<int64_t>(raw << shift) >> shift;
+        }
+        case FieldType::Bool:
+            return raw != 0;
+        case FieldType::Float:
+            if (size == 4) {
+                float v;
+                uint32_t bits = static_cast<uint32_t>(raw);
+                std::memcpy(&v, &bits, 4);
+                return v;
+            } else {
+                double v;
+                std::memcpy(&v, &raw, 8);
+                return v;
+            }
+        default:
+            return raw;
+    }
+}
+
+inline uint32_t PathPlan::parentAddr(int parent, const std::array<uint32_t, MAXPLAYER>& baseOffsets,
+                                     int index) const {
+    return parent < 0 ? baseOffsets[index] : m_nodes[parent].addr[index];
+}
+
+inline void PathPlan::fetchData(Reader r, const std::array<uint32_t, MAXPLAYER>& baseOffsets) {
+    for (auto& level : m_levels) {
+        m_batch.clear();
+
+        for (int id : level) {
+            Node& node = m_nodes[id];
+
+            for (int i = 0; i < MAXPLAYER; i++) {
+                node.addr[i]  = 0;
+                uint32_t from = parentAddr(node.parent, baseOffsets, i);
+
+                if (from != 0) {
+                    m_batch.push_back(tagReadRequest{from + node.offset, &node.addr[i], 4, false});
+                }
+            }
+        }
+
+        r.readBatch(m_batch.data(), m_batch.size());
+
+        for (auto& req : m_batch) {
+            if (!req.ok) {
+                *static_cast<uint32_t*>(req.buf) = 0;
+            }
+        }
+    }
+
+    m_batch.clear();
+
+    for (auto& f : m_fields) {
+        for (int i = 0; i < MAXPLAYER; i++) {
+            f.value[i]    = 0;
+            uint32_t from = parentAddr(f.node, baseOffsets, i);
+
+            if (from != 0) {
+                m_batch.push_back(tagReadRequest{from + f.offset, &f.value[i],
+                                                 static_cast<uint32_t>(f.size), false});
+            }
+        }
+    }
+
+    r.readBatch(m_batch.data(), m_batch.size());
+
+    for (auto& req : m_batch) {
+        if (!req.ok) {
+            *static_cast<uint64_t*>(req.buf) = 0;
+        }
+    }
+}
+
+inline bool PathPlan::parseFieldType(const std::string& str, FieldType* type) {
+    static const std::map<std::string, FieldType> types = {
+        {"Int", FieldType::Int},
+        {"Uint", FieldType::Uint},
+        {"Bool", FieldType::Bool},
+        {"Float", FieldType::Float},
+    };
+
+    auto it = types.find(str);
+    if (it == types.end()) {
+        return false;
+    }
+
+    *type = it->second;
+    return true;
+}
+
+inline const char* PathPlan::fieldTypeName(FieldType type) {
+    switch (type) {
+        case FieldType::Uint:
+            return "Uint";
+        case FieldType::Bool:
+            return "Bool";
+        case FieldType::Float:
+            return "Float";
+        default:
+            return "Int";
+    }
+}
+
+inline int PathPlan::defaultSize(FieldType type) { return type == FieldType::Bool ? 1 : 4; }
+
+inline bool PathPlan::validSize(FieldType type, int size) {
+    switch (type) {
+        case FieldType::Float:
+            return size == 4 || size == 8;
+        case FieldType::Bool:
+            return size == 1 || size == 2 || size == 4;
+        default:
+            return size == 1 || size == 2 || size == 4 || size == 8;
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_PATHPLAN_HPP_
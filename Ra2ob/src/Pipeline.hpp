@@ -0,0 +1,404 @@
+#ifndef RA2OB_SRC_PIPELINE_HPP_
+#define RA2OB_SRC_PIPELINE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "./Alloc.hpp"
+#include "./Profile.hpp"
+
+namespace Ra2ob {
+
+constexpr int POOLQUEUESIZE = 256;
+
+class PoolTask {
+public:
+    virtual ~PoolTask() {}
+    virtual void execute() = 0;
+};
+
+/**
+ * Fixed set of workers with one task ring each. A worker pops its own newest task and
+ * steals the oldest task of the others when it runs dry; threads outside the pool can
+ * help through runOne() while they wait for their tasks.
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int workers = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    void operator=(const WorkStealingPool&)   = delete;
+
+    static WorkStealingPool& shared();
+
+    int size();
+    void submit(PoolTask* task);
+    bool runOne();
+
+private:
+    struct Slot {
+        WorkStealingPool* owner;
+        int index;
+    };
+
+    struct Ring {
+        std::mutex mutex;
+        PoolTask* tasks[POOLQUEUESIZE];
+        size_t head = 0;
+        size_t tail = 0;
+    };
+
+    static Slot& currentSlot();
+    int workerIndex();
+    bool pushBack(int index, PoolTask* task);
+    bool popBack(int index, PoolTask** task);
+    bool popFront(int index, PoolTask** task);
+    bool take(int self, PoolTask** task);
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::vector<std::thread> m_workers;
+    std::atomic<int> m_pending{0};
+    std::atomic<unsigned> m_next{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCv;
+    bool m_stop = false;
+};
+
+/**
+ * Stages with dependencies, built once and run any number of times. Stages must be added
+ * after the stages they depend on, so insertion order is also the serial order.
+ */
+class StageGraph {
+public:
+    StageGraph();
+
+    StageGraph(const StageGraph&)     = delete;
+    void operator=(const StageGraph&) = delete;
+
+    int addStage(const char* name, std::function<void()> fn, std::initializer_list<int> deps = {});
+    void clear();
+    size_t size();
+    const StageProfile& profile(size_t index);
+    void resetProfiles();
+
+    void run(WorkStealingPool* pool);
+    void runSerial();
+
+private:
+    struct Node : public PoolTask {
+        explicit Node(const char* stage);
+
+        StageGraph* graph;
+        const char* name;
+        std::function<void()> fn;
+        std::vector<int> dependents;
+        int depCount = 0;
+        std::atomic<int> pending{0};
+        StageProfile profile;  // Every run of the stage, whichever thread ran it.
+
+        void execute() override;
+    };
+
+    void finished(Node* node);
+
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    WorkStealingPool* m_pool = nullptr;
+    AllocCounter* m_allocs   = nullptr;  // The caller's, for stages run on workers.
+    std::atomic<int> m_remaining{0};
+    std::mutex m_doneMutex;
+    std::condition_variable m_doneCv;
+};
+
+/**
+ * Source Code
+ */
+
+inline WorkStealingPool::WorkStealingPool(int workers) {
+    if (workers <= 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < workers; i++) {
+        m_rings.push_back(std::unique_ptr<Ring>(new Ring()));
+    }
+
+    for (int i = 0; i < workers; i++) {
+        m_workers.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+inline WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+
+    m_sleepCv.notify_all();
+
+    for (auto& t : m_workers) {
+        t.join();
+    }
+}
+
+inline WorkStealingPool& WorkStealingPool::shared() {
+    static WorkStealingPool instance;
+    return instance;
+}
+
+inline int WorkStealingPool::size() { return static_cast<int>(m_rings.size()); }
+
+/**
+ * Queue a task, on the caller's own ring if the caller is one of our workers.
+ */
+inline void WorkStealingPool::submit(PoolTask* task) {
+    int index = workerIndex();
+
+    if (index < 0) {
+        index = m_next.fetch_add(1, std::memory_order_relaxed) % m_rings.size();
+    }
+
+    if (!pushBack(index, task)) {
+        task->execute();
+        return;
+    }
+
+    m_pending.fetch_add(1);
+
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_sleepCv.notify_one();
+}
+
+/**
+ * Run one queued task on the calling thread, false if there was none.
+ */
+inline bool WorkStealingPool::runOne() {
+    PoolTask* task;
+
+    if (!take(workerIndex(), &task)) {
+        return false;
+    }
+
+    m_pending.fetch_sub(1);
+    task->execute();
+
+    return true;
+}
+
+/**
+ * Which pool and ring the calling thread works for, if any.
+ */
+inline WorkStealingPool::Slot& WorkStealingPool::currentSlot() {
+    static thread_local Slot slot = {nullptr, -1};
+    return slot;
+}
+
+inline int WorkStealingPool::workerIndex() {
+    Slot& slot = currentSlot();
+    return slot.owner == this ? slot.index : -1;
+}
+
+inline bool WorkStealingPool::pushBack(int index, PoolTask* task) {
+    Ring& ring = *m_rings[index];
+    std::lock_guard<std::mutex> lock(ring.mutex);
+
+    if (ring.tail - ring.head == POOLQUEUESIZE) {
+        return false;
+    }
+
+    ring.tasks[ring.tail % POOLQUEUESIZE] = task;
+    ring.tail++;
+
+    return true;
+}
+
+inline bool WorkStealingPool::popBack(int index, PoolTask** task) {
+    Ring& ring = *m_rings[index];
+    std::lock_guard<std::mutex> lock(ring.mutex);
+
+    if (ring.tail == ring.head) {
+        return false;
+    }
+
+    ring.tail--;
+    *task = ring.tasks[ring.tail % POOLQUEUESIZE];
+
+    return true;
+}
+
+inline bool WorkStealingPool::popFront(int index, PoolTask** task) {
+    Ring& ring = *m_rings[index];
+    std::lock_guard<std::mutex> lock(ring.mutex);
+
+    if (ring.tail == ring.head) {
+        return false;
+    }
+
+    *task = ring.tasks[ring.head % POOLQUEUESIZE];
+    ring.head++;
+
+    return true;
+}
+
+inline bool WorkStealingPool::take(int self, PoolTask** task) {
+    if (self >= 0 && popBack(self, task)) {
+        return true;
+    }
+
+    int n     = size();
+    int start = self >= 0 ? self + 1 : 0;
+
+    for (int i = 0; i < n; i++) {
+        int victim = (start + i) % n;
+
+        if (victim != self && popFront(victim, task)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void WorkStealingPool::workerLoop(int index) {
+    currentSlot() = Slot{this, index};
+    Tracer::nameThread("worker");
+
+    while (true) {
+        PoolTask* task;
+
+        if (take(index, &task)) {
+            m_pending.fetch_sub(1);
+            task->execute();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+inline StageGraph::StageGraph() {}
+
+inline int StageGraph::addStage(const char* name, std::function<void()> fn,
+                                std::initializer_list<int> deps) {
+    int id = static_cast<int>(m_nodes.size());
+
+    std::unique_ptr<Node> node(new Node(name));
+    node->graph    = this;
+    node->fn       = fn;
+    node->depCount = static_cast<int>(deps.size());
+
+    for (int d : deps) {
+        m_nodes[d]->dependents.push_back(id);
+    }
+
+    m_nodes.push_back(std::move(node));
+
+    return id;
+}
+
+inline void StageGraph::clear() { m_nodes.clear(); }
+
+inline size_t StageGraph::size() { return m_nodes.size(); }
+
+/**
+ * Time and reads of a stage, by the id addStage() returned. Cleared with the stages.
+ */
+inline const StageProfile& StageGraph::profile(size_t index) { return m_nodes[index]->profile; }
+
+/**
+ * Not while the stages run.
+ */
+inline void StageGraph::resetProfiles() {
+    for (auto& node : m_nodes) {
+        node->profile.reset();
+    }
+}
+
+/**
+ * Run every stage once on the pool, the caller helps until all of them finished. The
+ * stages' allocations count toward the caller's AllocScope, whichever thread runs them.
+ */
+inline void StageGraph::run(WorkStealingPool* pool) {
+    if (pool == nullptr || m_nodes.empty()) {
+        runSerial();
+        return;
+    }
+
+    m_pool   = pool;
+    m_allocs = AllocCounter::current();
+    m_remaining.store(static_cast<int>(m_nodes.size()));
+
+    for (auto& node : m_nodes) {
+        node->pending.store(node->depCount);
+    }
+
+    for (auto& node : m_nodes) {
+        if (node->depCount == 0) {
+            pool->submit(node.get());
+        }
+    }
+
+    while (m_remaining.load() > 0) {
+        if (pool->runOne()) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_doneMutex);
+        m_doneCv.wait_for(lock, std::chrono::microseconds(200),
+                          [this] { return m_remaining.load() == 0; });
+    }
+}
+
+/**
+ * Run every stage on the calling thread in insertion order, for deterministic runs.
+ */
+inline void StageGraph::runSerial() {
+    for (auto& node : m_nodes) {
+        ProfileScope scope(&node->profile);
+        node->fn();
+    }
+}
+
+inline StageGraph::Node::Node(const char* stage) : name(stage), profile(stage) {}
+
+inline void StageGraph::Node::execute() {
+    {
+        AllocScope scope(graph->m_allocs);
+        ProfileScope profileScope(&profile);
+        fn();
+    }
+    graph->finished(this);
+}
+
+inline void StageGraph::finished(Node* node) {
+    for (int d : node->dependents) {
+        if (m_nodes[d]->pending.fetch_sub(1) == 1) {
+            m_pool->submit(m_nodes[d].get());
+        }
+    }
+
+    if (m_remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(m_doneMutex);
+        m_doneCv.notify_all();
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_PIPELINE_HPP_
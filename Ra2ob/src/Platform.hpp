@@ -0,0 +1,79 @@
+#ifndef RA2OB_SRC_PLATFORM_HPP_
+#define RA2OB_SRC_PLATFORM_HPP_
+
+#ifdef _WIN32
+
+#include <Windows.h>
+
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <thread>  // NOLINT
+
+/**
+ * The part of Win32 the observer uses, for a game running under Wine. A process handle is
+ * the pid itself, memory is read with process_vm_readv(), which needs ptrace permission
+ * on the game process.
+ */
+using BOOL    = int;
+using DWORD   = uint32_t;
+using HANDLE  = void*;
+using LPCVOID = const void*;
+using LPVOID  = void*;
+using SIZE_T  = size_t;
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#define INFINITE             0xFFFFFFFF
+#define INVALID_HANDLE_VALUE (reinterpret_cast<HANDLE>(static_cast<intptr_t>(-1)))
+
+#define SYNCHRONIZE               0x00100000
+#define PROCESS_CREATE_THREAD     0x0002
+#define PROCESS_VM_OPERATION      0x0008
+#define PROCESS_VM_READ           0x0010
+#define PROCESS_QUERY_INFORMATION 0x0400
+
+inline void Sleep(DWORD ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+inline HANDLE OpenProcess(DWORD, BOOL, DWORD pid) {
+    if (pid == 0 || (kill(static_cast<pid_t>(pid), 0) != 0 && errno != EPERM)) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<HANDLE>(static_cast<intptr_t>(pid));
+}
+
+inline BOOL CloseHandle(HANDLE) { return TRUE; }
+
+inline BOOL ReadProcessMemory(HANDLE process, LPCVOID address, LPVOID buffer, SIZE_T size,
+                              SIZE_T* read) {
+    struct iovec local  = {buffer, size};
+    struct iovec remote = {const_cast<void*>(address), size};
+
+    pid_t pid = static_cast<pid_t>(reinterpret_cast<intptr_t>(process));
+    ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+
+    if (read != nullptr) {
+        *read = n < 0 ? 0 : static_cast<SIZE_T>(n);
+    }
+
+    return n == static_cast<ssize_t>(size);
+}
+
+#endif  // _WIN32
+
+#endif  // RA2OB_SRC_PLATFORM_HPP_
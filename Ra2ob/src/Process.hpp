@@ -0,0 +1,321 @@
+#ifndef RA2OB_SRC_PROCESS_HPP_
+#define RA2OB_SRC_PROCESS_HPP_
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Platform.hpp"
+#include "./Utils.hpp"
+#ifdef _WIN32
+// clang-format off
+#include <TlHelp32.h>
+#include <psapi.h> // NOLINT
+// clang-format on
+#endif
+
+namespace Ra2ob {
+
+/**
+ * Every running game process with at least one thread, in snapshot order.
+ */
+#ifdef _WIN32
+inline std::vector<DWORD> findGameProcesses() {
+    std::vector<DWORD> pids;
+
+    std::string name = F_GAMEEXE;
+    std::wstring w_name(name.begin(), name.end());
+
+    HANDLE hProcessSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+
+    if (hProcessSnap == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to create process snapshot\n";
+        return pids;
+    }
+
+    HANDLE hThreadSnap = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+
+    if (hThreadSnap == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to create thread snapshot\n";
+        CloseHandle(hProcessSnap);
+        return pids;
+    }
+
+    std::vector<DWORD> candidates;
+
+    PROCESSENTRY32 processInfo{};
+    processInfo.dwSize = sizeof(PROCESSENTRY32);
+
+    for (BOOL success = Process32First(hProcessSnap, &processInfo); success;
+         success      = Process32Next(hProcessSnap, &processInfo)) {
+#ifdef UNICODE
+        if (wcscmp(processInfo.szExeFile, w_name.c_str()) == 0) {
+            candidates.push_back(processInfo.th32ProcessID);
+        }
+#else
+        if (name == processInfo.szExeFile) {
+            candidates.push_back(processInfo.th32ProcessID);
+        }
+#endif
+    }
+
+    // A process without threads is still being torn down.
+    if (!candidates.empty()) {
+        THREADENTRY32 threadInfo{};
+        threadInfo.dwSize = sizeof(THREADENTRY32);
+
+        std::vector<bool> hasThread(candidates.size(), false);
+
+        for (BOOL success = Thread32First(hThreadSnap, &threadInfo); success;
+             success      = Thread32Next(hThreadSnap, &threadInfo)) {
+            for (size_t i = 0; i < candidates.size(); i++) {
+                if (threadInfo.th32OwnerProcessID == candidates[i]) {
+                    hasThread[i] = true;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (hasThread[i]) {
+                pids.push_back(candidates[i]);
+            }
+        }
+    }
+
+    CloseHandle(hThreadSnap);
+    CloseHandle(hProcessSnap);
+
+    return pids;
+}
+
+#else
+/**
+ * State letter from /proc/<pid>/stat, 0 if the process is gone.
+ */
+inline char processState(DWORD pid) {
+    std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat;
+
+    if (!std::getline(f, stat)) {
+        return 0;
+    }
+
+    // The command name may contain spaces and parentheses, the state follows the last ')'.
+    size_t pos = stat.rfind(')');
+    if (pos == std::string::npos || pos + 2 >= stat.size()) {
+        return 0;
+    }
+
+    return stat[pos + 2];
+}
+
+/**
+ * Every running game process that has not exited yet, in pid order. Under Wine the first
+ * argument is the Windows path of the executable.
+ */
+inline std::vector<DWORD> findGameProcesses() {
+    std::vector<DWORD> pids;
+
+    std::string name = F_GAMEEXE;
+    std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+    DIR* dir = opendir("/proc");
+
+    if (dir == nullptr) {
+        std::cerr << "Failed to open /proc\n";
+        return pids;
+    }
+
+    while (struct dirent* entry = readdir(dir)) {
+        if (!isdigit(static_cast<unsigned char>(entry->d_name[0]))) {
+            continue;
+        }
+
+        std::ifstream f(std::string("/proc/") + entry->d_name + "/cmdline");
+        std::string argv0;
+
+        if (!std::getline(f, argv0, '\0')) {
+            continue;
+        }
+
+        size_t slash = argv0.find_last_of("/\\");
+        std::string exe = slash == std::string::npos ? argv0 : argv0.substr(slash + 1);
+        std::transform(exe.begin(), exe.end(), exe.begin(), ::tolower);
+
+        DWORD pid = static_cast<DWORD>(std::stoul(entry->d_name));
+
+        // A zombie is still being torn down.
+        if (exe == name && processState(pid) != 'Z') {
+            pids.push_back(pid);
+        }
+    }
+
+    closedir(dir);
+
+    std::sort(pids.begin(), pids.end());
+
+    return pids;
+}
+#endif
+
+/**
+ * Path of the game executable, used to find the ini files next to it.
+ */
+inline std::string gameExePath(HANDLE handle, DWORD pid) {
+#ifdef _WIN32
+#ifdef UNICODE
+    wchar_t exePath[256];
+    GetModuleFileNameEx(handle, NULL, exePath, sizeof(exePath));
+    return utf16ToGbk(exePath);
+#else
+    char exePath[256];
+    GetModuleFileNameEx(handle, NULL, exePath, sizeof(exePath));
+    return exePath;
+#endif
+#else
+    (void)handle;
+
+    // /proc/<pid>/exe is the Wine loader, but the game runs from its own directory.
+    char cwd[4096];
+    ssize_t len = readlink(("/proc/" + std::to_string(pid) + "/cwd").c_str(), cwd, sizeof(cwd));
+
+    if (len <= 0 || len >= static_cast<ssize_t>(sizeof(cwd))) {
+        return F_GAMEEXE;
+    }
+
+    return std::string(cwd, len) + "/" + F_GAMEEXE;
+#endif
+}
+
+struct tagMemoryRegion {
+    uint32_t base;
+    uint32_t size;
+};
+
+/**
+ * Committed, writable memory of a game process below 4 GB, in address order.
+ */
+inline std::vector<tagMemoryRegion> writableRegions(HANDLE handle) {
+    std::vector<tagMemoryRegion> regions;
+
+#ifdef _WIN32
+    const DWORD writable =
+        PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+    MEMORY_BASIC_INFORMATION mbi;
+    uint64_t addr = 0;
+
+    while (addr < 0x100000000ull &&
+           VirtualQueryEx(handle, reinterpret_cast<LPCVOID>(static_cast<uintptr_t>(addr)), &mbi,
+                          sizeof(mbi)) == sizeof(mbi)) {
+        uint64_t base = reinterpret_cast<uintptr_t>(mbi.BaseAddress);
+        uint64_t end  = std::min<uint64_t>(base + mbi.RegionSize, 0x100000000ull);
+
+        if (mbi.State == MEM_COMMIT && (mbi.Protect & writable) != 0 &&
+            (mbi.Protect & PAGE_GUARD) == 0) {
+            regions.push_back({static_cast<uint32_t>(base), static_cast<uint32_t>(end - base)});
+        }
+
+        if (end <= addr) {
+            break;
+        }
+        addr = end;
+    }
+#else
+    pid_t pid = static_cast<pid_t>(reinterpret_cast<intptr_t>(handle));
+    std::ifstream f("/proc/" + std::to_string(pid) + "/maps");
+    std::string line;
+
+    // "start-end perms offset dev inode path", in hex and in address order.
+    while (std::getline(f, line)) {
+        unsigned long long start = 0;
+        unsigned long long end   = 0;
+        char perms[5]            = {};
+
+        if (sscanf(line.c_str(), "%llx-%llx %4s", &start, &end, perms) != 3) {
+            continue;
+        }
+
+        if (perms[0] != 'r' || perms[1] != 'w' || start >= 0x100000000ull) {
+            continue;
+        }
+
+        end = std::min(end, 0x100000000ull);
+        regions.push_back({static_cast<uint32_t>(start), static_cast<uint32_t>(end - start)});
+    }
+#endif
+
+    return regions;
+}
+
+/**
+ * Block until the process behind a handle opened by Game::attach() exits, at most
+ * `timeout` ms (INFINITE to wait for good). True if it is gone.
+ */
+inline bool waitForExit(HANDLE handle, DWORD timeout) {
+    if (handle == nullptr) {
+        return true;
+    }
+
+#ifdef _WIN32
+    return WaitForSingleObject(handle, timeout) != WAIT_TIMEOUT;
+#else
+    pid_t pid = static_cast<pid_t>(reinterpret_cast<intptr_t>(handle));
+
+#ifdef SYS_pidfd_open
+    int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+
+    if (fd >= 0) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int ret;
+
+        do {
+            ret = poll(&pfd, 1, timeout == INFINITE ? -1 : static_cast<int>(timeout));
+        } while (ret < 0 && errno == EINTR);
+
+        close(fd);
+
+        return ret != 0;
+    }
+
+    if (errno == ESRCH) {
+        return true;
+    }
+#endif
+
+    // No pidfd before Linux 5.3, look at the process state instead.
+    for (DWORD waited = 0;; waited += 100) {
+        char state = processState(pid);
+
+        if (state == 0 || state == 'Z') {
+            return true;
+        }
+
+        if (timeout != INFINITE && waited >= timeout) {
+            return false;
+        }
+
+        Sleep(timeout == INFINITE ? 100 : std::min<DWORD>(100, timeout - waited));
+    }
+#endif
+}
+
+/**
+ * Whether the process behind a handle opened by Game::attach() is still running.
+ */
+inline bool isProcessAlive(HANDLE handle) { return !waitForExit(handle, 0); }
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_PROCESS_HPP_
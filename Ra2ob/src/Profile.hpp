@@ -0,0 +1,356 @@
+#ifndef RA2OB_SRC_PROFILE_HPP_
+#define RA2OB_SRC_PROFILE_HPP_
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Reader.hpp"
+#include "./Trace.hpp"
+
+namespace Ra2ob {
+
+constexpr int PROFILEBUCKETS = (PROFILEMAXBITS - PROFILESUBBITS + 1) << PROFILESUBBITS;
+
+/**
+ * Counts of durations in log-linear buckets, HdrHistogram style: values below
+ * 2^PROFILESUBBITS ns are exact, every power of two above is split into 2^PROFILESUBBITS
+ * buckets. Recording is a few loads and stores; one thread records at a time, any thread
+ * may query.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    void operator=(const LatencyHistogram&)   = delete;
+
+    void record(uint64_t ns);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t percentile(double p) const;
+    double fractionWithin(uint64_t value) const;
+    uint64_t max() const;
+    double mean() const;
+
+    static int bucket(uint64_t ns);
+    static uint64_t bucketHigh(int bucket);
+
+private:
+    static void bump(std::atomic<uint64_t>& counter, uint64_t by);
+
+    std::array<std::atomic<uint64_t>, PROFILEBUCKETS> m_buckets;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+struct tagStageStats {
+    const char* name;
+    uint64_t runs;
+    double mean;  // ns, like the percentiles.
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t max;
+    uint64_t reads;  // Totals over all runs.
+    uint64_t bytes;
+    uint64_t failed;
+};
+
+/**
+ * Wall time and reads of one stage of a tick, see ProfileScope.
+ */
+class StageProfile {
+public:
+    explicit StageProfile(const char* name = "");
+
+    StageProfile(const StageProfile&)   = delete;
+    void operator=(const StageProfile&) = delete;
+
+    const char* getName() const;
+    const LatencyHistogram& getTime() const;
+    uint64_t percentile(double p) const;
+    tagStageStats stats() const;
+
+    void add(uint64_t ns, const tagReadStats& reads);
+    void reset();
+
+private:
+    const char* m_name;
+    LatencyHistogram m_time;
+    std::atomic<uint64_t> m_reads{0};
+    std::atomic<uint64_t> m_bytes{0};
+    std::atomic<uint64_t> m_failed{0};
+};
+
+/**
+ * Adds the time and the calling thread's reads while in scope to a profile, nullptr for
+ * none. A scope that waits for work on other threads counts every thread's reads instead.
+ * While tracing, the scope is also a trace event named after the profile.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(StageProfile* profile, bool allThreads = false);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&)   = delete;
+    void operator=(const ProfileScope&) = delete;
+
+private:
+    StageProfile* m_profile;
+    bool m_allThreads;
+    tagReadStats m_reads;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+void printProfile(const std::vector<tagStageStats>& stats);
+
+/**
+ * Source Code
+ */
+
+inline int highestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+        return static_cast<int>(index) + 32;
+    }
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+inline LatencyHistogram::LatencyHistogram() { reset(); }
+
+inline void LatencyHistogram::record(uint64_t ns) {
+    bump(m_buckets[bucket(ns)], 1);
+    bump(m_count, 1);
+    bump(m_sum, ns);
+
+    if (ns > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(ns, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Not safe against a concurrent record().
+ */
+inline void LatencyHistogram::reset() {
+    for (auto& b : m_buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::count() const { return m_count.load(std::memory_order_relaxed); }
+
+/**
+ * The value p percent of the recorded ones are at or below, as the upper end of its bucket
+ * and never above max(). 0 while empty.
+ */
+inline uint64_t LatencyHistogram::percentile(double p) const {
+    uint64_t total = count();
+
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(p / 100 * total + 0.5);
+    rank          = rank < 1 ? 1 : (rank > total ? total : rank);
+
+    uint64_t seen = 0;
+
+    for (int b = 0; b < PROFILEBUCKETS; b++) {
+        seen += m_buckets[b].load(std::memory_order_relaxed);
+
+        if (seen >= rank) {
+            uint64_t high = bucketHigh(b);
+            return high < max() ? high : max();
+        }
+    }
+
+    return max();
+}
+
+/**
+ * Share of the recorded values at or below value, to a bucket's precision. Against a
+ * latency target, the share of samples that met it.
+ */
+inline double LatencyHistogram::fractionWithin(uint64_t value) const {
+    uint64_t total = count();
+
+    if (total == 0) {
+        return 1;
+    }
+
+    uint64_t seen = 0;
+    int last      = bucket(value);
+
+    for (int b = 0; b <= last; b++) {
+        seen += m_buckets[b].load(std::memory_order_relaxed);
+    }
+
+    return static_cast<double>(seen) / total;
+}
+
+inline uint64_t LatencyHistogram::max() const { return m_max.load(std::memory_order_relaxed); }
+
+inline double LatencyHistogram::mean() const {
+    uint64_t total = count();
+    return total == 0 ? 0 : static_cast<double>(m_sum.load(std::memory_order_relaxed)) / total;
+}
+
+inline int LatencyHistogram::bucket(uint64_t ns) {
+    constexpr uint64_t sub = 1ull << PROFILESUBBITS;
+
+    if (ns < sub) {
+        return static_cast<int>(ns);
+    }
+
+    int top = highestBit(ns);
+
+    if (top >= PROFILEMAXBITS) {
+        return PROFILEBUCKETS - 1;
+    }
+
+    int shift         = top - PROFILESUBBITS;
+    uint64_t mantissa = (ns >> shift) & (sub - 1);
+
+    return static_cast<int>(((shift + 1) << PROFILESUBBITS) + mantissa);
+}
+
+/**
+ * The largest value counted in a bucket.
+ */
+inline uint64_t LatencyHistogram::bucketHigh(int bucket) {
+    constexpr uint64_t sub = 1ull << PROFILESUBBITS;
+
+    if (static_cast<uint64_t>(bucket) < sub) {
+        return bucket;
+    }
+
+    int shift         = (bucket >> PROFILESUBBITS) - 1;
+    uint64_t mantissa = bucket & (sub - 1);
+
+    return ((sub + mantissa + 1) << shift) - 1;
+}
+
+/**
+ * One writer at a time, so no read-modify-write is needed.
+ */
+inline void LatencyHistogram::bump(std::atomic<uint64_t>& counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+inline StageProfile::StageProfile(const char* name) : m_name(name) {}
+
+inline const char* StageProfile::getName() const { return m_name; }
+
+inline const LatencyHistogram& StageProfile::getTime() const { return m_time; }
+
+/**
+ * Wall time in ns p percent of the runs took at most.
+ */
+inline uint64_t StageProfile::percentile(double p) const { return m_time.percentile(p); }
+
+inline tagStageStats StageProfile::stats() const {
+    tagStageStats ret;
+
+    ret.name   = m_name;
+    ret.runs   = m_time.count();
+    ret.mean   = m_time.mean();
+    ret.p50    = m_time.percentile(50);
+    ret.p90    = m_time.percentile(90);
+    ret.p99    = m_time.percentile(99);
+    ret.max    = m_time.max();
+    ret.reads  = m_reads.load(std::memory_order_relaxed);
+    ret.bytes  = m_bytes.load(std::memory_order_relaxed);
+    ret.failed = m_failed.load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+inline void StageProfile::add(uint64_t ns, const tagReadStats& reads) {
+    auto bump = [](std::atomic<uint64_t>& counter, uint64_t by) {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    };
+
+    m_time.record(ns);
+    bump(m_reads, reads.reads);
+    bump(m_bytes, reads.bytes);
+    bump(m_failed, reads.failed);
+}
+
+inline void StageProfile::reset() {
+    m_time.reset();
+    m_reads.store(0, std::memory_order_relaxed);
+    m_bytes.store(0, std::memory_order_relaxed);
+    m_failed.store(0, std::memory_order_relaxed);
+}
+
+inline ProfileScope::ProfileScope(StageProfile* profile, bool allThreads)
+    : m_profile(profile), m_allThreads(allThreads) {
+    if (m_profile != nullptr) {
+        m_reads = m_allThreads ? Reader::stats() : Reader::threadStats();
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+inline ProfileScope::~ProfileScope() {
+    if (m_profile == nullptr) {
+        return;
+    }
+
+    auto end   = std::chrono::steady_clock::now();
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count();
+
+    tagReadStats reads = m_allThreads ? Reader::stats() : Reader::threadStats();
+
+    reads.reads -= m_reads.reads;
+    reads.bytes -= m_reads.bytes;
+    reads.failed -= m_reads.failed;
+
+    m_profile->add(static_cast<uint64_t>(ns), reads);
+
+    if (Tracer::enabled(TraceKind::Stage)) {
+        int64_t begin = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            m_start.time_since_epoch())
+                            .count();
+        Tracer::record(TraceKind::Stage, m_profile->getName(), begin, begin + ns);
+    }
+}
+
+/**
+ * One line per stage, times in µs and reads per run.
+ */
+inline void printProfile(const std::vector<tagStageStats>& stats) {
+    std::printf("%-14s %9s %9s %9s %9s %9s %9s %9s\n", "stage", "runs", "mean us", "p50 us",
+                "p90 us", "p99 us", "max us", "reads");
+
+    for (const tagStageStats& s : stats) {
+        double runs = s.runs == 0 ? 1 : static_cast<double>(s.runs);
+
+        std::printf("%-14s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", s.name,
+                    static_cast<unsigned long long>(s.runs), s.mean / 1000, s.p50 / 1000.0,
+                    s.p90 / 1000.0, s.p99 / 1000.0, s.max / 1000.0, s.reads / runs);
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_PROFILE_HPP_
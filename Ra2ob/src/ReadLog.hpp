@@ -0,0 +1,543 @@
+#ifndef RA2OB_SRC_READLOG_HPP_
+#define RA2OB_SRC_READLOG_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>  // NOLINT
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Reader.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+/**
+ * Read log file layout:
+ *
+ *   header  magic[8]
+ *   record  kind:u8 ...                              (repeated)
+ *
+ *   Meta    size:varint json[size]                   what the reader was attached to
+ *   Mark    -                                        Reader::mark()
+ *   Read    addr:svarint size:varint bytes[size]     a read and what it returned
+ *   Same    addr:svarint size:varint                 returned what the last read of it did
+ *   Failed  addr:svarint size:varint
+ *
+ * Varints are LEB128, addr is the zigzag difference to the address of the previous read.
+ * A log cut short, by a crash or a kill, replays up to its last mark.
+ */
+
+enum class ReadLogKind : uint8_t { Meta = 0, Mark = 1, Read = 2, Same = 3, Failed = 4 };
+
+enum class ReplayMode : uint8_t {
+    Ordered = 0,  // The recorded reads one after another, by address where they differ.
+    Lookup  = 1,  // By address within each mark, for readers on several threads.
+};
+
+struct tagReadLogStats {
+    uint64_t reads  = 0;
+    uint64_t same   = 0;  // Written as Same.
+    uint64_t failed = 0;
+    uint64_t marks  = 0;
+    uint64_t bytes  = 0;  // Of the log so far.
+};
+
+struct tagReplayStats {
+    uint64_t served    = 0;  // Reads answered from the log.
+    uint64_t reordered = 0;  // Of them, not the next one recorded in Ordered mode.
+    uint64_t missed    = 0;  // Reads the log does not have between the marks.
+};
+
+/**
+ * Writes every read of a Reader into a read log, as its listener.
+ */
+class ReadRecorder : public ReadListener {
+public:
+    explicit ReadRecorder(const std::string& filePath);
+    ~ReadRecorder();
+
+    ReadRecorder(const ReadRecorder&)   = delete;
+    void operator=(const ReadRecorder&) = delete;
+
+    bool isOpen();
+    void writeMeta(const json& meta);
+    void onRead(uint32_t addr, const void* value, uint32_t size, bool ok) override;
+    void onMark() override;
+    void close();
+    tagReadLogStats stats();
+
+private:
+    void putVarint(uint64_t value);
+    void putAddr(uint32_t addr, uint32_t size);
+    void flush();
+
+    std::mutex m_mutex;
+    std::ofstream m_file;
+    std::vector<uint8_t> m_buffer;
+    std::unordered_map<uint64_t, std::vector<uint8_t>> m_last;  // By addr and size.
+    uint32_t m_addr = 0;
+    tagReadLogStats m_stats;
+};
+
+/**
+ * Answers reads from a read log instead of a process, see Game::attachReplay().
+ *
+ * Each mark of the reader moves on to the reads recorded after the next mark, so a tick
+ * replays the tick recorded. Within it, reads of an address and size get what the recorded
+ * ones got in their order; past those they keep getting the last.
+ */
+class ReadReplay : public MemorySource {
+public:
+    ReadReplay() {}
+
+    ReadReplay(const ReadReplay&)     = delete;
+    void operator=(const ReadReplay&) = delete;
+
+    bool open(const std::string& filePath, ReplayMode mode = ReplayMode::Lookup);
+    const json& meta() const;
+    size_t records() const;
+    size_t segments() const;
+    size_t segment();
+    bool finished();
+    void rewind();
+    tagReplayStats stats();
+
+    bool read(uint32_t addr, void* value, uint32_t size) override;
+    void mark() override;
+
+private:
+    struct Record {
+        uint32_t addr;
+        uint32_t size;
+        const uint8_t* bytes;  // Into m_file, nullptr if the read failed.
+    };
+
+    static uint64_t key(uint32_t addr, uint32_t size);
+    void enter(size_t segment);
+    bool serve(size_t index, void* value);
+
+    MappedFile m_file;
+    ReplayMode m_mode = ReplayMode::Lookup;
+    json m_meta;
+
+    std::vector<Record> m_records;
+    std::vector<size_t> m_segments;  // Where each stretch between marks begins, and the end.
+
+    // Per segment, (key, record) sorted, and at a key's first entry how many were served.
+    std::vector<std::pair<uint64_t, uint32_t>> m_sorted;
+    std::vector<uint32_t> m_taken;
+
+    std::mutex m_mutex;
+    size_t m_segment = 0;
+    size_t m_next    = 0;  // The next record in Ordered mode.
+    tagReplayStats m_stats;
+};
+
+/**
+ * Source Code
+ */
+
+inline ReadRecorder::ReadRecorder(const std::string& filePath) {
+    m_file.open(filePath, std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open()) {
+        std::cerr << "ReadLog: could not open " << filePath << " for writing.\n";
+        return;
+    }
+
+    m_file.write(RL_MAGIC, 8);
+    m_stats.bytes = 8;
+}
+
+inline ReadRecorder::~ReadRecorder() { close(); }
+
+inline bool ReadRecorder::isOpen() { return m_file.is_open(); }
+
+/**
+ * What replaying needs besides the reads, such as Game's version and globals.
+ */
+inline void ReadRecorder::writeMeta(const json& meta) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    std::string text = meta.dump();
+
+    m_buffer.push_back(static_cast<uint8_t>(ReadLogKind::Meta));
+    putVarint(text.size());
+    m_buffer.insert(m_buffer.end(), text.begin(), text.end());
+}
+
+inline void ReadRecorder::onRead(uint32_t addr, const void* value, uint32_t size, bool ok) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    m_stats.reads++;
+
+    if (!ok) {
+        m_stats.failed++;
+        m_buffer.push_back(static_cast<uint8_t>(ReadLogKind::Failed));
+        putAddr(addr, size);
+        return;
+    }
+
+    std::vector<uint8_t>& last = m_last[static_cast<uint64_t>(addr) << 32 | size];
+
+    if (last.size() == size && std::memcmp(last.data(), bytes, size) == 0) {
+        m_stats.same++;
+        m_buffer.push_back(static_cast<uint8_t>(ReadLogKind::Same));
+        putAddr(addr, size);
+        return;
+    }
+
+    last.assign(bytes, bytes + size);
+
+    m_buffer.push_back(static_cast<uint8_t>(ReadLogKind::Read));
+    putAddr(addr, size);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+/**
+ * Written out every RL_FLUSHSIZE bytes or so, at a mark, so a log cut short ends at one.
+ */
+inline void ReadRecorder::onMark() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    m_stats.marks++;
+    m_buffer.push_back(static_cast<uint8_t>(ReadLogKind::Mark));
+
+    if (m_buffer.size() >= RL_FLUSHSIZE) {
+        flush();
+    }
+}
+
+inline void ReadRecorder::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_file.is_open()) {
+        flush();
+        m_file.close();
+    }
+}
+
+inline tagReadLogStats ReadRecorder::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    tagReadLogStats ret = m_stats;
+
+    ret.bytes += m_buffer.size();
+
+    return ret;
+}
+
+inline void ReadRecorder::putVarint(uint64_t value) {
+    while (value >= 0x80) {
+        m_buffer.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    m_buffer.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * Reads mostly walk through memory, so the difference to the last address is short.
+ */
+inline void ReadRecorder::putAddr(uint32_t addr, uint32_t size) {
+    int64_t delta = static_cast<int64_t>(addr) - m_addr;
+
+    putVarint(static_cast<uint64_t>(delta < 0 ? ~(delta << 1) : delta << 1));
+    putVarint(size);
+    m_addr = addr;
+}
+
+inline void ReadRecorder::flush() {
+    if (!m_file.is_open() || m_buffer.empty()) {
+        return;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+    m_file.flush();
+
+    if (!m_file) {
+        // Such as a full disk. What was written replays up to its last whole mark.
+        std::cerr << "ReadLog: could not write the log, recording stopped.\n";
+        m_file.close();
+        m_buffer.clear();
+        return;
+    }
+
+    m_stats.bytes += m_buffer.size();
+    m_buffer.clear();
+}
+
+/**
+ * Map a read log and index each stretch between marks. The reads before the first mark
+ * are the first segment, the reader's first mark moves on to the second.
+ */
+inline bool ReadReplay::open(const std::string& filePath, ReplayMode mode) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_mode = mode;
+    m_meta = json::object();
+    m_records.clear();
+    m_segments.assign(1, 0);
+
+    if (!m_file.open(filePath)) {
+        std::cerr << "ReadLog: could not map " << filePath << ".\n";
+        return false;
+    }
+
+    const uint8_t* data = m_file.data();
+    size_t size         = m_file.size();
+
+    if (size < 8 || std::memcmp(data, RL_MAGIC, 8) != 0) {
+        std::cerr << "ReadLog: " << filePath << " is not a read log.\n";
+        m_file.close();
+        return false;
+    }
+
+    auto varint = [&](size_t* pos, uint64_t* value) {
+        *value = 0;
+        for (int shift = 0; *pos < size && shift < 64; shift += 7) {
+            uint8_t b = data[(*pos)++];
+
+            *value |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::unordered_map<uint64_t, const uint8_t*> last;
+    size_t pos    = 8;
+    uint32_t addr = 0;
+    bool whole    = true;
+
+    while (pos < size && whole) {
+        ReadLogKind kind = static_cast<ReadLogKind>(data[pos++]);
+        uint64_t delta   = 0;
+        uint64_t length  = 0;
+
+        if (kind == ReadLogKind::Mark) {
+            m_segments.push_back(m_records.size());
+            continue;
+        }
+
+        if (kind == ReadLogKind::Meta) {
+            whole = varint(&pos, &length) && length <= size - pos;
+            if (whole) {
+                m_meta = json::parse(data + pos, data + pos + length, nullptr, false);
+                pos += length;
+            }
+            if (whole && !m_meta.is_object()) {
+                std::cerr << "ReadLog: " << filePath << " has a bad meta record.\n";
+                m_file.close();
+                return false;
+            }
+            continue;
+        }
+
+        if (kind != ReadLogKind::Read && kind != ReadLogKind::Same &&
+            kind != ReadLogKind::Failed) {
+            whole = false;
+            break;
+        }
+
+        whole = varint(&pos, &delta) && varint(&pos, &length) && length <= UINT32_MAX;
+        if (!whole) {
+            break;
+        }
+
+        addr += static_cast<uint32_t>((delta & 1) != 0 ? ~(delta >> 1) : delta >> 1);
+
+        Record rec{addr, static_cast<uint32_t>(length), nullptr};
+
+        if (kind == ReadLogKind::Read) {
+            whole = length <= size - pos;
+            if (!whole) {
+                break;
+            }
+            rec.bytes = data + pos;
+            pos += length;
+            last[key(rec.addr, rec.size)] = rec.bytes;
+        } else if (kind == ReadLogKind::Same) {
+            auto it = last.find(key(rec.addr, rec.size));
+
+            whole = it != last.end();
+            if (!whole) {
+                break;
+            }
+            rec.bytes = it->second;
+        }
+
+        m_records.push_back(rec);
+    }
+
+    if (whole) {
+        m_segments.push_back(m_records.size());
+    } else {
+        // The tick cut short is not replayed.
+        m_records.resize(m_segments.back());
+        std::cerr << "ReadLog: " << filePath << " ends early, replaying " << m_records.size()
+                  << " reads up to its last mark.\n";
+    }
+
+    m_sorted.resize(m_records.size());
+    m_taken.assign(m_records.size(), 0);
+
+    for (size_t s = 0; s + 1 < m_segments.size(); s++) {
+        for (size_t i = m_segments[s]; i < m_segments[s + 1]; i++) {
+            m_sorted[i] = {key(m_records[i].addr, m_records[i].size), static_cast<uint32_t>(i)};
+        }
+        std::sort(m_sorted.begin() + m_segments[s], m_sorted.begin() + m_segments[s + 1]);
+    }
+
+    m_stats = tagReplayStats();
+    enter(0);
+
+    return true;
+}
+
+/**
+ * What the recorder wrote with writeMeta(), an empty object without it.
+ */
+inline const json& ReadReplay::meta() const { return m_meta; }
+
+inline size_t ReadReplay::records() const { return m_records.size(); }
+
+/**
+ * Stretches between marks, one more than the marks recorded.
+ */
+inline size_t ReadReplay::segments() const { return m_segments.size() - 1; }
+
+inline size_t ReadReplay::segment() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_segment;
+}
+
+/**
+ * Whether the reads after the last mark are being replayed, so the next mark has none.
+ */
+inline bool ReadReplay::finished() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_segment + 1 >= segments();
+}
+
+/**
+ * Back to the reads before the first mark.
+ */
+inline void ReadReplay::rewind() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    enter(0);
+}
+
+inline tagReplayStats ReadReplay::stats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+inline bool ReadReplay::read(uint32_t addr, void* value, uint32_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_segment >= segments()) {
+        m_stats.missed++;
+        return false;
+    }
+
+    size_t end = m_segments[m_segment + 1];
+
+    if (m_mode == ReplayMode::Ordered && m_next < end && m_records[m_next].addr == addr &&
+        m_records[m_next].size == size) {
+        size_t index = m_next++;
+
+        // Keep the lookup in step, for reads of it that come out of order later.
+        auto first = std::lower_bound(m_sorted.begin() + m_segments[m_segment],
+                                      m_sorted.begin() + end,
+                                      std::make_pair(key(addr, size), uint32_t(0)));
+        m_taken[first - m_sorted.begin()]++;
+
+        return serve(index, value);
+    }
+
+    uint64_t k = key(addr, size);
+    auto range = std::equal_range(
+        m_sorted.begin() + m_segments[m_segment], m_sorted.begin() + end,
+        std::make_pair(k, uint32_t(0)),
+        [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+            return a.first < b.first;
+        });
+
+    if (range.first == range.second) {
+        m_stats.missed++;
+        return false;
+    }
+
+    uint32_t& taken = m_taken[range.first - m_sorted.begin()];
+    size_t count    = range.second - range.first;
+    size_t index    = (range.first + std::min<size_t>(taken, count - 1))->second;
+
+    taken++;
+    if (m_mode == ReplayMode::Ordered) {
+        m_stats.reordered++;
+    }
+
+    return serve(index, value);
+}
+
+/**
+ * The reader moved on, so does the replay.
+ */
+inline void ReadReplay::mark() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_segment < segments()) {
+        enter(m_segment + 1);
+    }
+}
+
+inline uint64_t ReadReplay::key(uint32_t addr, uint32_t size) {
+    return static_cast<uint64_t>(addr) << 32 | size;
+}
+
+inline void ReadReplay::enter(size_t segment) {
+    m_segment = segment;
+    m_next    = segment < segments() ? m_segments[segment] : m_records.size();
+
+    if (segment < segments()) {
+        std::fill(m_taken.begin() + m_segments[segment], m_taken.begin() + m_segments[segment + 1],
+                  0);
+    }
+}
+
+inline bool ReadReplay::serve(size_t index, void* value) {
+    const Record& rec = m_records[index];
+
+    m_stats.served++;
+
+    if (rec.bytes == nullptr) {
+        return false;
+    }
+
+    std::memcpy(value, rec.bytes, rec.size);
+    return true;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_READLOG_HPP_
@@ -1,37 +1,375 @@
 #ifndef RA2OB_SRC_READER_HPP_
 #define RA2OB_SRC_READER_HPP_
 
-#include <Windows.h>
-
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <mutex>  // NOLINT
 #include <string>
+#include <vector>
 
 #include "./Constants.hpp"
+#include "./Platform.hpp"
+#include "./Trace.hpp"
 
 namespace Ra2ob {
 
+constexpr int READBATCHSIZE = 256;
+
+struct tagReadRequest {
+    uint32_t addr;
+    void* buf;
+    uint32_t size;
+    bool ok;
+};
+
+struct tagReadStats {
+    uint64_t reads  = 0;  // Native or MemorySource read calls.
+    uint64_t bytes  = 0;  // Bytes they returned.
+    uint64_t failed = 0;  // Requests that failed.
+};
+
+/**
+ * Memory a Reader reads instead of a process, such as GameEmulator.
+ */
+class MemorySource {
+public:
+    virtual ~MemorySource() {}
+
+    virtual bool read(uint32_t addr, void* value, uint32_t size) = 0;
+
+    /**
+     * Set dirty[i] for each of pages (addresses >> PAGECACHESHIFT) written since the last
+     * call, false if the source does not keep track, see PageCache.
+     */
+    virtual bool takeDirtyPages(const uint32_t* /*pages*/, size_t /*count*/,
+                                uint8_t* /*dirty*/) {
+        return false;
+    }
+
+    // What was read before is done with, see Reader::mark().
+    virtual void mark() {}
+};
+
+/**
+ * Copies of memory a Reader answers reads from before reading, such as PageCache.
+ */
+class ReadCache {
+public:
+    virtual ~ReadCache() {}
+
+    // Whether all of the size bytes at addr were cached.
+    virtual bool lookup(uint32_t addr, void* value, uint32_t size) = 0;
+};
+
+/**
+ * Told of every read a Reader answers and of its marks, such as ReadRecorder.
+ */
+class ReadListener {
+public:
+    virtual ~ReadListener() {}
+
+    // From any thread reading, value holds what the read returned if ok.
+    virtual void onRead(uint32_t addr, const void* value, uint32_t size, bool ok) = 0;
+    virtual void onMark()                                                         = 0;
+};
+
 class Reader {
 public:
-    explicit Reader(HANDLE handle = nullptr);
+    explicit Reader(HANDLE handle = nullptr, MemorySource* source = nullptr);
 
     HANDLE getHandle();
+    MemorySource* getSource();
+    void setCache(ReadCache* cache);
+    void setListener(ReadListener* listener);
+    void mark();
+    bool attached();
     bool readMemory(uint32_t addr, void* value, uint32_t size);
+    bool readBatch(tagReadRequest* requests, size_t count);
     uint32_t getAddr(uint32_t offset);
     int getInt(uint32_t offset);
     bool getBool(uint32_t offset);
     std::string getString(uint32_t offset);
     uint32_t getColor(uint32_t offset);
 
+    static tagReadStats stats();
+    static tagReadStats threadStats();
+
 protected:
+    // Written by one thread only, read by stats() from any.
+    struct Counters {
+        std::atomic<uint64_t> reads{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> failed{0};
+    };
+
+    // A thread's counters, folded into the retired ones when the thread exits.
+    struct ThreadCounters {
+        ThreadCounters();
+        ~ThreadCounters();
+
+        Counters* counters;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<Counters*> live;
+        tagReadStats retired;
+    };
+
+    static Registry& registry();
+    static Counters& threadCounters();
+    static void countReads(uint64_t reads, uint64_t bytes, uint64_t failed);
+
+    bool readUntraced(uint32_t addr, void* value, uint32_t size);
+
     HANDLE m_handle;
+    MemorySource* m_source;  // Not owned, read instead of m_handle when set.
+    ReadCache* m_cache;        // Not owned, asked first when set.
+    ReadListener* m_listener;  // Not owned, told of every read when set.
 };
 
-inline Reader::Reader(HANDLE handle) { m_handle = handle; }
+inline Reader::Reader(HANDLE handle, MemorySource* source) {
+    m_handle   = handle;
+    m_source   = source;
+    m_cache    = nullptr;
+    m_listener = nullptr;
+}
 
 inline HANDLE Reader::getHandle() { return m_handle; }
 
+inline MemorySource* Reader::getSource() { return m_source; }
+
+/**
+ * Answer reads from cache where it can, nullptr to read everything. Set it while no reads
+ * are in flight.
+ */
+inline void Reader::setCache(ReadCache* cache) { m_cache = cache; }
+
+/**
+ * Tell listener of every read, nullptr to stop. Set it while no reads are in flight.
+ */
+inline void Reader::setListener(ReadListener* listener) { m_listener = listener; }
+
+/**
+ * Separate the reads before from those after, for the listener and the source: a ReadLog
+ * replays the reads of each stretch between marks by address. Game marks every tick.
+ */
+inline void Reader::mark() {
+    if (m_listener != nullptr) {
+        m_listener->onMark();
+    }
+
+    if (m_source != nullptr) {
+        m_source->mark();
+    }
+}
+
+/**
+ * Whether there is a process or a source to read.
+ */
+inline bool Reader::attached() { return m_handle != nullptr || m_source != nullptr; }
+
 inline bool Reader::readMemory(uint32_t addr, void* value, uint32_t size) {
-    return ReadProcessMemory(m_handle, (const void*)addr, value, size, nullptr);
+    bool ok;
+
+    if (Tracer::enabled(TraceKind::Read)) {
+        int64_t begin = steadyNs();
+        ok            = readUntraced(addr, value, size);
+
+        Tracer::record(TraceKind::Read, "read", begin, steadyNs(), addr);
+    } else {
+        ok = readUntraced(addr, value, size);
+    }
+
+    if (m_listener != nullptr) {
+        m_listener->onRead(addr, value, size, ok);
+    }
+
+    return ok;
+}
+
+inline bool Reader::readUntraced(uint32_t addr, void* value, uint32_t size) {
+    if (m_cache != nullptr && m_cache->lookup(addr, value, size)) {
+        return true;
+    }
+
+    LPCVOID remote = reinterpret_cast<LPCVOID>(static_cast<uintptr_t>(addr));
+    bool ok        = m_source != nullptr
+                         ? m_source->read(addr, value, size)
+                         : ReadProcessMemory(m_handle, remote, value, size, nullptr);
+
+    countReads(1, ok ? size : 0, ok ? 0 : 1);
+
+    return ok;
+}
+
+/**
+ * Any number of scattered reads, each request's ok tells whether it succeeded. On Linux a
+ * batch of READBATCHSIZE requests costs one process_vm_readv() until one of them fails;
+ * requests the cache answers cost none.
+ */
+inline bool Reader::readBatch(tagReadRequest* requests, size_t count) {
+    TraceScope scope(TraceKind::Batch, "readBatch", static_cast<uint32_t>(count));
+
+    bool ret = true;
+
+    if (m_source != nullptr) {
+        bool single = Tracer::enabled(TraceKind::Read) || m_listener != nullptr;
+
+        for (size_t i = 0; i < count; i++) {
+            tagReadRequest& req = requests[i];
+
+            req.ok = single ? readMemory(req.addr, req.buf, req.size)
+                            : readUntraced(req.addr, req.buf, req.size);
+            ret    = ret && req.ok;
+        }
+        return ret;
+    }
+
+#ifdef _WIN32
+    for (size_t i = 0; i < count; i++) {
+        requests[i].ok = readMemory(requests[i].addr, requests[i].buf, requests[i].size);
+        ret            = ret && requests[i].ok;
+    }
+#else
+    struct iovec local[READBATCHSIZE];
+    struct iovec remote[READBATCHSIZE];
+    size_t index[READBATCHSIZE];  // Of the requests not answered from m_cache.
+
+    pid_t pid   = static_cast<pid_t>(reinterpret_cast<intptr_t>(m_handle));
+    size_t done = 0;
+
+    while (done < count) {
+        size_t n    = 0;
+        size_t next = done;
+
+        for (; next < count && n < READBATCHSIZE; next++) {
+            tagReadRequest& req = requests[next];
+
+            if (m_cache != nullptr && m_cache->lookup(req.addr, req.buf, req.size)) {
+                req.ok = true;
+                continue;
+            }
+
+            index[n]  = next;
+            local[n]  = {req.buf, req.size};
+            remote[n] = {reinterpret_cast<void*>(static_cast<uintptr_t>(req.addr)), req.size};
+            n++;
+        }
+
+        if (n == 0) {
+            done = next;
+            continue;
+        }
+
+        ssize_t got = process_vm_readv(pid, local, n, remote, n, 0);
+        size_t i    = 0;
+
+        countReads(1, got > 0 ? got : 0, 0);
+
+        // Transfers stop at the first request that fails, carry on after it.
+        for (; i < n; i++) {
+            tagReadRequest& req = requests[index[i]];
+
+            req.ok = got >= static_cast<ssize_t>(req.size);
+            if (!req.ok) {
+                countReads(0, 0, 1);
+                ret = false;
+                break;
+            }
+            got -= req.size;
+        }
+
+        done = i < n ? index[i] + 1 : next;
+    }
+
+    if (m_listener != nullptr) {
+        for (size_t i = 0; i < count; i++) {
+            m_listener->onRead(requests[i].addr, requests[i].buf, requests[i].size,
+                               requests[i].ok);
+        }
+    }
+#endif
+
+    return ret;
+}
+
+/**
+ * Totals over every Reader in the process since it started.
+ */
+inline tagReadStats Reader::stats() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    tagReadStats ret = reg.retired;
+
+    for (Counters* c : reg.live) {
+        ret.reads += c->reads.load(std::memory_order_relaxed);
+        ret.bytes += c->bytes.load(std::memory_order_relaxed);
+        ret.failed += c->failed.load(std::memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+/**
+ * The calling thread's reads, without any locking. The difference over a stretch of code
+ * is what that code read.
+ */
+inline tagReadStats Reader::threadStats() {
+    Counters& c = threadCounters();
+    tagReadStats ret;
+
+    ret.reads  = c.reads.load(std::memory_order_relaxed);
+    ret.bytes  = c.bytes.load(std::memory_order_relaxed);
+    ret.failed = c.failed.load(std::memory_order_relaxed);
+
+    return ret;
+}
+
+inline Reader::ThreadCounters::ThreadCounters() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    counters = new Counters();
+    reg.live.push_back(counters);
+}
+
+inline Reader::ThreadCounters::~ThreadCounters() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    reg.retired.reads += counters->reads.load(std::memory_order_relaxed);
+    reg.retired.bytes += counters->bytes.load(std::memory_order_relaxed);
+    reg.retired.failed += counters->failed.load(std::memory_order_relaxed);
+    reg.live.erase(std::find(reg.live.begin(), reg.live.end(), counters));
+
+    delete counters;
+}
+
+inline Reader::Registry& Reader::registry() {
+    static Registry ret;
+    return ret;
+}
+
+inline Reader::Counters& Reader::threadCounters() {
+    static thread_local ThreadCounters ret;
+    return *ret.counters;
+}
+
+/**
+ * Only this thread writes its counters, so plain loads and stores do.
+ */
+inline void Reader::countReads(uint64_t reads, uint64_t bytes, uint64_t failed) {
+    Counters& c = threadCounters();
+
+    c.reads.store(c.reads.load(std::memory_order_relaxed) + reads, std::memory_order_relaxed);
+    c.bytes.store(c.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    if (failed != 0) {
+        c.failed.store(c.failed.load(std::memory_order_relaxed) + failed,
+                       std::memory_order_relaxed);
+    }
 }
 
 inline uint32_t Reader::getAddr(uint32_t offset) {
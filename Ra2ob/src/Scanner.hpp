@@ -0,0 +1,605 @@
+#ifndef RA2OB_SRC_SCANNER_HPP_
+#define RA2OB_SRC_SCANNER_HPP_
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define RA2OB_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(RA2OB_SCANNER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RA2OB_TARGET(isa) __attribute__((target(isa)))
+#else
+#define RA2OB_TARGET(isa)
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Reader.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+constexpr size_t SCANNOTFOUND = static_cast<size_t>(-1);
+
+constexpr int SIGCONTEXT  = 2;   // Bytes learned before an operand, usually opcode and ModRM.
+constexpr int SIGMAXBYTES = 48;  // Longest pattern learn() tries before giving up.
+
+enum class ScanLevel : int { Scalar = 0, Sse2 = 1, Avx2 = 2 };
+
+/**
+ * A byte pattern like "8B 0D ?? ?? ?? ?? 85 C9", "??" matches any byte.
+ */
+struct tagPattern {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> solid;  // 1 where the byte must match.
+    int first = -1;              // First and last solid byte, the SIMD filters.
+    int last  = -1;
+};
+
+/**
+ * Finds patterns in a buffer. Candidates are filtered on the pattern's first and last
+ * solid byte, 32 or 16 positions per compare, and only those are matched in full. The
+ * widest instruction set the CPU has is picked at runtime.
+ */
+class PatternScanner {
+public:
+    static bool parse(const std::string& text, tagPattern* pattern);
+    static std::string format(const tagPattern& pattern);
+
+    static size_t find(const uint8_t* data, size_t size, const tagPattern& pattern,
+                       size_t from = 0);
+    static size_t count(const uint8_t* data, size_t size, const tagPattern& pattern,
+                        size_t limit);
+
+    static ScanLevel level();
+    static void setLevel(ScanLevel level);
+
+private:
+    static ScanLevel detect();
+    static ScanLevel& current();
+    static bool matchAt(const uint8_t* at, const tagPattern& pattern);
+
+    static size_t findScalar(const uint8_t* data, size_t size, const tagPattern& pattern,
+                             size_t from);
+    static size_t findSse2(const uint8_t* data, size_t size, const tagPattern& pattern,
+                           size_t from);
+    static size_t findAvx2(const uint8_t* data, size_t size, const tagPattern& pattern,
+                           size_t from);
+};
+
+/**
+ * The code sections of the game's executable, copied out of its memory once.
+ */
+class ProcessImage {
+public:
+    struct Section {
+        std::string name;
+        uint32_t va;
+        std::vector<uint8_t> data;
+    };
+
+    ProcessImage();
+
+    bool load(Reader r, uint32_t base = IMAGEBASE);
+    const std::vector<Section>& getSections() const;
+    size_t size() const;
+
+private:
+    std::vector<Section> m_sections;
+};
+
+/**
+ * A global resolved from the code that uses it: the 4 bytes at operand within the match
+ * are its address, or a displacement from the end of those bytes if relative.
+ */
+struct tagSignature {
+    std::string name;
+    tagPattern pattern;
+    int operand    = 0;
+    bool relative  = false;
+    int32_t adjust = 0;
+};
+
+class SignatureScanner {
+public:
+    static bool parse(const json& data, std::vector<tagSignature>* sigs, std::string* error);
+    static json toJson(const std::vector<tagSignature>& sigs);
+
+    static bool resolve(const ProcessImage& image, const tagSignature& sig, uint32_t* value);
+    static bool learn(const ProcessImage& image, const std::string& name, uint32_t address,
+                      tagSignature* sig);
+};
+
+/**
+ * Source Code
+ */
+
+inline bool PatternScanner::parse(const std::string& text, tagPattern* pattern) {
+    tagPattern ret;
+    std::istringstream ss(text);
+    std::string token;
+
+    while (ss >> token) {
+        if (token == "?" || token == "??") {
+            ret.bytes.push_back(0);
+            ret.solid.push_back(0);
+            continue;
+        }
+
+        uint32_t value;
+        if (token.size() != 2 || !parseHex(token, &value)) {
+            return false;
+        }
+
+        ret.bytes.push_back(static_cast<uint8_t>(value));
+        ret.solid.push_back(1);
+
+        if (ret.first < 0) {
+            ret.first = static_cast<int>(ret.bytes.size()) - 1;
+        }
+        ret.last = static_cast<int>(ret.bytes.size()) - 1;
+    }
+
+    if (ret.first < 0) {
+        return false;
+    }
+
+    *pattern = ret;
+    return true;
+}
+
+inline std::string PatternScanner::format(const tagPattern& pattern) {
+    std::ostringstream ss;
+    ss << std::uppercase << std::hex << std::setfill('0');
+
+    for (size_t i = 0; i < pattern.bytes.size(); i++) {
+        if (i != 0) {
+            ss << ' ';
+        }
+
+        if (pattern.solid[i]) {
+            ss << std::setw(2) << static_cast<int>(pattern.bytes[i]);
+        } else {
+            ss << "??";
+        }
+    }
+
+    return ss.str();
+}
+
+/**
+ * Offset of the first match at or after from, SCANNOTFOUND if none.
+ */
+inline size_t PatternScanner::find(const uint8_t* data, size_t size, const tagPattern& pattern,
+                                   size_t from) {
+    if (pattern.first < 0 || size < pattern.bytes.size() ||
+        from > size - pattern.bytes.size()) {
+        return SCANNOTFOUND;
+    }
+
+    switch (level()) {
+        case ScanLevel::Avx2:
+            return findAvx2(data, size, pattern, from);
+        case ScanLevel::Sse2:
+            return findSse2(data, size, pattern, from);
+        default:
+            return findScalar(data, size, pattern, from);
+    }
+}
+
+/**
+ * Number of matches, counting stops at limit.
+ */
+inline size_t PatternScanner::count(const uint8_t* data, size_t size, const tagPattern& pattern,
+                                    size_t limit) {
+    size_t ret = 0;
+    size_t at  = find(data, size, pattern);
+
+    while (at != SCANNOTFOUND && ret < limit) {
+        ret++;
+        at = find(data, size, pattern, at + 1);
+    }
+
+    return ret;
+}
+
+inline ScanLevel PatternScanner::level() { return current(); }
+
+/**
+ * Use at most the given level, for comparing the implementations.
+ */
+inline void PatternScanner::setLevel(ScanLevel level) {
+    ScanLevel best = detect();
+    current()      = static_cast<int>(level) < static_cast<int>(best) ? level : best;
+}
+
+inline ScanLevel& PatternScanner::current() {
+    static ScanLevel level = detect();
+    return level;
+}
+
+inline ScanLevel PatternScanner::detect() {
+#if defined(RA2OB_SCANNER_X86) && defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 1);
+    bool sse2    = (info[3] & (1 << 26)) != 0;
+    bool osAvx   = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    bool ymmSave = osAvx && (_xgetbv(0) & 6) == 6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = ymmSave && (info[1] & (1 << 5)) != 0;
+
+    return avx2 ? ScanLevel::Avx2 : (sse2 ? ScanLevel::Sse2 : ScanLevel::Scalar);
+#elif defined(RA2OB_SCANNER_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        return ScanLevel::Avx2;
+    }
+    return __builtin_cpu_supports("sse2") ? ScanLevel::Sse2 : ScanLevel::Scalar;
+#else
+    return ScanLevel::Scalar;
+#endif
+}
+
+inline bool PatternScanner::matchAt(const uint8_t* at, const tagPattern& pattern) {
+    for (size_t i = 0; i < pattern.bytes.size(); i++) {
+        if (pattern.solid[i] && at[i] != pattern.bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline size_t PatternScanner::findScalar(const uint8_t* data, size_t size,
+                                         const tagPattern& pattern, size_t from) {
+    size_t lastStart = size - pattern.bytes.size();
+    uint8_t first    = pattern.bytes[pattern.first];
+
+    while (from <= lastStart) {
+        const void* hit = memchr(data + from + pattern.first, first, lastStart - from + 1);
+
+        if (hit == nullptr) {
+            break;
+        }
+
+        size_t at = static_cast<const uint8_t*>(hit) - data - pattern.first;
+        if (matchAt(data + at, pattern)) {
+            return at;
+        }
+        from = at + 1;
+    }
+
+    return SCANNOTFOUND;
+}
+
+#ifdef RA2OB_SCANNER_X86
+inline int lowestBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+RA2OB_TARGET("sse2")
+inline size_t PatternScanner::findSse2(const uint8_t* data, size_t size,
+                                       const tagPattern& pattern, size_t from) {
+    size_t lastStart = size - pattern.bytes.size();
+    const __m128i f  = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.first]));
+    const __m128i l  = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.last]));
+
+    size_t i = from;
+
+    for (; i + 16 <= lastStart + 1; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.first));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.last));
+
+        uint32_t mask = static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, f), _mm_cmpeq_epi8(b, l))));
+
+        while (mask != 0) {
+            size_t at = i + lowestBit(mask);
+            if (matchAt(data + at, pattern)) {
+                return at;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return i <= lastStart ? findScalar(data, size, pattern, i) : SCANNOTFOUND;
+}
+
+RA2OB_TARGET("avx2")
+inline size_t PatternScanner::findAvx2(const uint8_t* data, size_t size,
+                                       const tagPattern& pattern, size_t from) {
+    size_t lastStart = size - pattern.bytes.size();
+    const __m256i f  = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.first]));
+    const __m256i l  = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.last]));
+
+    size_t i = from;
+
+    for (; i + 32 <= lastStart + 1; i += 32) {
+        __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.first));
+        __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.last));
+
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, f), _mm256_cmpeq_epi8(b, l))));
+
+        while (mask != 0) {
+            size_t at = i + lowestBit(mask);
+            if (matchAt(data + at, pattern)) {
+                return at;
+            }
+            mask &= mask - 1;
+        }
+    }
+
+    return i <= lastStart ? findSse2(data, size, pattern, i) : SCANNOTFOUND;
+}
+#else
+inline size_t PatternScanner::findSse2(const uint8_t* data, size_t size,
+                                       const tagPattern& pattern, size_t from) {
+    return findScalar(data, size, pattern, from);
+}
+
+inline size_t PatternScanner::findAvx2(const uint8_t* data, size_t size,
+                                       const tagPattern& pattern, size_t from) {
+    return findScalar(data, size, pattern, from);
+}
+#endif  // RA2OB_SCANNER_X86
+
+inline ProcessImage::ProcessImage() {}
+
+/**
+ * Copy the executable sections of the PE image mapped at base.
+ */
+inline bool ProcessImage::load(Reader r, uint32_t base) {
+    m_sections.clear();
+
+    uint8_t header[PEHEADERSIZE];
+    if (!r.readMemory(base, header, PEHEADERSIZE) || header[0] != 'M' || header[1] != 'Z') {
+        return false;
+    }
+
+    uint32_t nt;
+    std::memcpy(&nt, header + 0x3c, 4);
+
+    if (nt > PEHEADERSIZE - 0x18 || std::memcmp(header + nt, "PE\0\0", 4) != 0) {
+        return false;
+    }
+
+    uint16_t sections;
+    uint16_t optionalSize;
+    std::memcpy(&sections, header + nt + 0x6, 2);
+    std::memcpy(&optionalSize, header + nt + 0x14, 2);
+
+    uint32_t table = nt + 0x18 + optionalSize;
+
+    for (uint32_t i = 0; i < sections && table + (i + 1) * 0x28 <= PEHEADERSIZE; i++) {
+        const uint8_t* sh = header + table + i * 0x28;
+
+        uint32_t vsize, va, characteristics;
+        std::memcpy(&vsize, sh + 0x8, 4);
+        std::memcpy(&va, sh + 0xc, 4);
+        std::memcpy(&characteristics, sh + 0x24, 4);
+
+        if ((characteristics & PECODESECTION) == 0 || vsize == 0 || vsize > PEMAXSECTION) {
+            continue;
+        }
+
+        const char* name = reinterpret_cast<const char*>(sh);
+
+        Section s;
+        s.name = std::string(name, strnlen(name, 8));
+        s.va   = base + va;
+        s.data.resize(vsize);
+
+        if (r.readMemory(s.va, s.data.data(), vsize)) {
+            m_sections.push_back(std::move(s));
+        }
+    }
+
+    return !m_sections.empty();
+}
+
+inline const std::vector<ProcessImage::Section>& ProcessImage::getSections() const {
+    return m_sections;
+}
+
+inline size_t ProcessImage::size() const {
+    size_t ret = 0;
+
+    for (auto& s : m_sections) {
+        ret += s.data.size();
+    }
+
+    return ret;
+}
+
+/**
+ * Read signatures.json: `[{"Name", "Pattern", "Operand", "Relative", "Adjust"}]`, Operand
+ * is a byte index into the pattern and Adjust a hex string added to the result.
+ */
+inline bool SignatureScanner::parse(const json& data, std::vector<tagSignature>* sigs,
+                                    std::string* error) {
+    if (!data.is_array()) {
+        *error = "expected an array of signatures";
+        return false;
+    }
+
+    std::vector<tagSignature> ret;
+
+    for (auto& it : data) {
+        tagSignature sig;
+        uint32_t adjust = 0;
+
+        bool valid = it.is_object() && it.contains("Name") && it["Name"].is_string() &&
+                     it.contains("Pattern") && it["Pattern"].is_string() &&
+                     PatternScanner::parse(it["Pattern"].get<std::string>(), &sig.pattern);
+
+        if (valid && it.contains("Operand")) {
+            valid       = it["Operand"].is_number_integer();
+            sig.operand = valid ? it["Operand"].get<int>() : 0;
+        }
+
+        if (valid && it.contains("Relative")) {
+            valid        = it["Relative"].is_boolean();
+            sig.relative = valid && it["Relative"].get<bool>();
+        }
+
+        if (valid && it.contains("Adjust")) {
+            valid = it["Adjust"].is_string() &&
+                    parseHex(it["Adjust"].get<std::string>(), &adjust);
+            sig.adjust = static_cast<int32_t>(adjust);
+        }
+
+        if (!valid || sig.operand < 0 ||
+            sig.operand + 4 > static_cast<int>(sig.pattern.bytes.size())) {
+            *error = "invalid signature " + it.dump();
+            return false;
+        }
+
+        sig.name = it["Name"];
+        ret.push_back(sig);
+    }
+
+    *sigs = ret;
+    return true;
+}
+
+inline json SignatureScanner::toJson(const std::vector<tagSignature>& sigs) {
+    json ret = json::array();
+
+    for (auto& sig : sigs) {
+        json j;
+        j["Name"]    = sig.name;
+        j["Pattern"] = PatternScanner::format(sig.pattern);
+        j["Operand"] = sig.operand;
+
+        if (sig.relative) {
+            j["Relative"] = true;
+        }
+
+        if (sig.adjust != 0) {
+            std::ostringstream ss;
+            ss << "0x" << std::hex << static_cast<uint32_t>(sig.adjust);
+            j["Adjust"] = ss.str();
+        }
+
+        ret.push_back(j);
+    }
+
+    return ret;
+}
+
+/**
+ * The global a signature points at, false unless the pattern matches exactly once.
+ */
+inline bool SignatureScanner::resolve(const ProcessImage& image, const tagSignature& sig,
+                                      uint32_t* value) {
+    const ProcessImage::Section* hitSection = nullptr;
+    size_t hit                              = SCANNOTFOUND;
+
+    for (auto& s : image.getSections()) {
+        size_t at = PatternScanner::find(s.data.data(), s.data.size(), sig.pattern);
+
+        if (at == SCANNOTFOUND) {
+            continue;
+        }
+
+        if (hitSection != nullptr ||
+            PatternScanner::find(s.data.data(), s.data.size(), sig.pattern, at + 1) !=
+                SCANNOTFOUND) {
+            return false;
+        }
+
+        hitSection = &s;
+        hit        = at;
+    }
+
+    if (hitSection == nullptr) {
+        return false;
+    }
+
+    uint32_t operand;
+    std::memcpy(&operand, hitSection->data.data() + hit + sig.operand, 4);
+
+    if (sig.relative) {
+        operand += hitSection->va + static_cast<uint32_t>(hit + sig.operand + 4);
+    }
+
+    *value = operand + static_cast<uint32_t>(sig.adjust);
+
+    return true;
+}
+
+/**
+ * Derive a signature for a known address: the shortest run of code around one of its uses
+ * that is unique in the image, with the address itself as wildcards. Meant to be run
+ * against a build whose offsets are known good.
+ */
+inline bool SignatureScanner::learn(const ProcessImage& image, const std::string& name,
+                                    uint32_t address, tagSignature* sig) {
+    tagPattern use;
+    use.bytes = {static_cast<uint8_t>(address), static_cast<uint8_t>(address >> 8),
+                 static_cast<uint8_t>(address >> 16), static_cast<uint8_t>(address >> 24)};
+    use.solid = {1, 1, 1, 1};
+    use.first = 0;
+    use.last  = 3;
+
+    for (auto& s : image.getSections()) {
+        const uint8_t* data = s.data.data();
+        size_t size         = s.data.size();
+
+        size_t at = PatternScanner::find(data, size, use);
+
+        for (; at != SCANNOTFOUND; at = PatternScanner::find(data, size, use, at + 1)) {
+            if (at < SIGCONTEXT) {
+                continue;
+            }
+
+            size_t start = at - SIGCONTEXT;
+
+            for (size_t len = SIGCONTEXT + 8; len <= SIGMAXBYTES && start + len <= size; len++) {
+                tagSignature candidate;
+                candidate.name    = name;
+                candidate.operand = SIGCONTEXT;
+
+                tagPattern& p = candidate.pattern;
+                p.bytes.assign(data + start, data + start + len);
+                p.solid.assign(len, 1);
+                std::fill(p.solid.begin() + SIGCONTEXT, p.solid.begin() + SIGCONTEXT + 4, 0);
+                p.first = 0;
+                p.last  = static_cast<int>(len) - 1;
+
+                uint32_t value;
+                if (resolve(image, candidate, &value) && value == address) {
+                    *sig = candidate;
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_SCANNER_HPP_
@@ -0,0 +1,310 @@
+#ifndef RA2OB_SRC_SESSION_HPP_
+#define RA2OB_SRC_SESSION_HPP_
+
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <queue>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "./Game.hpp"
+
+namespace Ra2ob {
+
+/**
+ * One observed game process with its own Game and published snapshot.
+ */
+class GameSession {
+public:
+    explicit GameSession(DWORD pid);
+
+    GameSession(const GameSession&)    = delete;
+    void operator=(const GameSession&) = delete;
+
+    DWORD getPid();
+    bool isAttached();
+    bool tick();
+
+    std::shared_ptr<const tagGameInfo> snapshot();
+    Game& game();
+
+private:
+    void publish();
+
+    DWORD m_pid;
+    bool m_attached;
+    Game m_game;
+    std::shared_ptr<const tagGameInfo> m_snapshot;
+};
+
+/**
+ * Finds every game process and runs all sessions' refreshes on a shared set of workers.
+ *
+ * Jobs are served earliest deadline first, FIFO among equal deadlines, and a late job is
+ * rescheduled from now rather than from its missed deadline. Every session thus gets one
+ * tick per interval while the pool keeps up, and an even share of the workers once it
+ * doesn't. Discovery runs as one more job every detect interval.
+ */
+class SessionPool {
+public:
+    explicit SessionPool(int workers = 0, int interval = T_FETCHTIME,
+                         int detectInterval = T_DETECTTIME);
+    ~SessionPool();
+
+    SessionPool(const SessionPool&)    = delete;
+    void operator=(const SessionPool&) = delete;
+
+    void start();
+    void stop();
+    void discover();
+
+    std::vector<std::shared_ptr<GameSession>> getSessions();
+    std::shared_ptr<GameSession> getSession(DWORD pid);
+
+private:
+    struct Job {
+        int64_t due;
+        uint64_t seq;
+        std::shared_ptr<GameSession> session;  // nullptr - discovery.
+    };
+
+    struct JobLater {
+        bool operator()(const Job& a, const Job& b) const {
+            return a.due != b.due ? a.due > b.due : a.seq > b.seq;
+        }
+    };
+
+    static int64_t nowMs();
+    void schedule(std::shared_ptr<GameSession> session, int64_t due);
+    void workerLoop();
+
+    int m_workerCount;
+    int m_interval;
+    int m_detectInterval;
+    bool m_running = false;
+    uint64_t m_seq = 0;
+
+    std::mutex m_mutex;
+    std::mutex m_discoverMutex;
+    std::condition_variable m_cv;
+    std::priority_queue<Job, std::vector<Job>, JobLater> m_queue;
+    std::map<DWORD, std::shared_ptr<GameSession>> m_sessions;
+    std::vector<std::thread> m_workers;
+};
+
+/**
+ * Source Code
+ */
+
+inline GameSession::GameSession(DWORD pid) : m_pid(pid) {
+    m_attached = m_game.attach(pid);
+
+    if (m_attached) {
+        m_game._gameInfo.valid = true;
+        m_game.initAddrs();
+    }
+
+    publish();
+}
+
+inline DWORD GameSession::getPid() { return m_pid; }
+
+inline bool GameSession::isAttached() { return m_attached; }
+
+/**
+ * Refresh once and publish. Returns false once the process is gone. A game without players,
+ * such as one still loading, is looked at again each tick until it has some.
+ */
+inline bool GameSession::tick() {
+    if (m_attached && !isProcessAlive(m_game.r.getHandle())) {
+        m_attached = false;
+        m_game.restart(true);
+        publish();
+    }
+
+    if (!m_attached) {
+        return false;
+    }
+
+    if (!m_game.revalidate()) {
+        return true;
+    }
+
+    m_game.tick();
+    publish();
+
+    return true;
+}
+
+inline std::shared_ptr<const tagGameInfo> GameSession::snapshot() {
+    return std::atomic_load(&m_snapshot);
+}
+
+inline Game& GameSession::game() { return m_game; }
+
+inline void GameSession::publish() {
+    std::shared_ptr<const tagGameInfo> snap = std::make_shared<tagGameInfo>(m_game._gameInfo);
+    std::atomic_store(&m_snapshot, snap);
+}
+
+inline SessionPool::SessionPool(int workers, int interval, int detectInterval) {
+    if (workers <= 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workerCount    = workers;
+    m_interval       = interval;
+    m_detectInterval = detectInterval;
+}
+
+inline SessionPool::~SessionPool() { stop(); }
+
+inline void SessionPool::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_running) {
+        return;
+    }
+
+    m_running = true;
+    schedule(nullptr, nowMs());
+
+    for (auto& it : m_sessions) {
+        schedule(it.second, nowMs());
+    }
+
+    for (int i = 0; i < m_workerCount; i++) {
+        m_workers.push_back(std::thread(&SessionPool::workerLoop, this));
+    }
+}
+
+inline void SessionPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+        m_queue   = std::priority_queue<Job, std::vector<Job>, JobLater>();
+    }
+
+    m_cv.notify_all();
+
+    for (auto& t : m_workers) {
+        t.join();
+    }
+    m_workers.clear();
+}
+
+/**
+ * Attach a session to every game process that has none yet.
+ */
+inline void SessionPool::discover() {
+    std::lock_guard<std::mutex> discoverLock(m_discoverMutex);
+
+    for (DWORD pid : findGameProcesses()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_sessions.count(pid) != 0) {
+                continue;
+            }
+        }
+
+        std::shared_ptr<GameSession> session = std::make_shared<GameSession>(pid);
+
+        if (!session->isAttached()) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sessions[pid] = session;
+
+        if (m_running) {
+            schedule(session, nowMs());
+        }
+    }
+}
+
+inline std::vector<std::shared_ptr<GameSession>> SessionPool::getSessions() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::vector<std::shared_ptr<GameSession>> ret;
+    for (auto& it : m_sessions) {
+        ret.push_back(it.second);
+    }
+
+    return ret;
+}
+
+inline std::shared_ptr<GameSession> SessionPool::getSession(DWORD pid) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_sessions.find(pid);
+    if (it == m_sessions.end()) {
+        return nullptr;
+    }
+
+    return it->second;
+}
+
+inline int64_t SessionPool::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+inline void SessionPool::schedule(std::shared_ptr<GameSession> session, int64_t due) {
+    m_queue.push(Job{due, m_seq++, session});
+    m_cv.notify_one();
+}
+
+inline void SessionPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (m_running) {
+        if (m_queue.empty()) {
+            m_cv.wait(lock);
+            continue;
+        }
+
+        int64_t now = nowMs();
+        Job job     = m_queue.top();
+
+        if (job.due > now) {
+            m_cv.wait_for(lock, std::chrono::milliseconds(job.due - now));
+            continue;
+        }
+
+        m_queue.pop();
+        lock.unlock();
+
+        bool keep = true;
+        if (job.session == nullptr) {
+            discover();
+        } else {
+            keep = job.session->tick();
+        }
+
+        lock.lock();
+
+        if (!m_running) {
+            break;
+        }
+
+        int interval = job.session == nullptr ? m_detectInterval : m_interval;
+
+        if (keep) {
+            schedule(job.session, std::max(job.due + interval, nowMs()));
+        } else {
+            auto it = m_sessions.find(job.session->getPid());
+            if (it != m_sessions.end() && it->second == job.session) {
+                m_sessions.erase(it);
+            }
+        }
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_SESSION_HPP_
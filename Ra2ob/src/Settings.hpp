@@ -0,0 +1,252 @@
+#ifndef RA2OB_SRC_SETTINGS_HPP_
+#define RA2OB_SRC_SETTINGS_HPP_
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+constexpr size_t SETTINGSCACHESIZE = 64;
+
+// Keys are lower case, ini keys are case-insensitive to the game as well.
+using IniSection = std::map<std::string, std::string>;
+
+/**
+ * One section per ini file, parsed from a memory mapping and kept until the file changes.
+ *
+ * The scanner walks the mapped bytes and only copies the keys and values of the wanted
+ * section. A cached section is checked against the file's mtime and size, so loading an
+ * unchanged file costs one stat().
+ */
+class SettingsCache {
+public:
+    static SettingsCache& getInstance();
+
+    std::shared_ptr<const IniSection> load(const std::string& filePath,
+                                           const std::string& section);
+    void clear();
+    size_t size();
+
+    static IniSection parse(const char* data, size_t size, const std::string& section);
+
+private:
+    struct Entry {
+        int64_t mtime;
+        int64_t size;
+        std::shared_ptr<const IniSection> section;
+    };
+
+    std::mutex m_mutex;
+    std::map<std::string, Entry> m_entries;
+};
+
+class IniFile {
+public:
+    IniFile(std::string filePath, std::string seg);
+
+    bool isItemExist(std::string item);
+    std::string getItem(std::string item);
+    bool getItemBool(std::string item);
+    int getItemInt(std::string item);
+
+private:
+    std::shared_ptr<const IniSection> m_section;
+    std::string m_filePath;
+    std::string m_seg;
+};
+
+/**
+ * Source Code
+ */
+
+inline std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return str;
+}
+
+inline SettingsCache& SettingsCache::getInstance() {
+    static SettingsCache instance;
+    return instance;
+}
+
+/**
+ * The given section of a file, empty if the file or the section does not exist.
+ */
+inline std::shared_ptr<const IniSection> SettingsCache::load(const std::string& filePath,
+                                                             const std::string& section) {
+    std::string key = filePath + '\0' + toLower(section);
+
+    int64_t mtime = 0;
+    int64_t size  = 0;
+
+    if (!statFile(filePath, &mtime, &size)) {
+        return std::make_shared<IniSection>();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(key);
+        if (it != m_entries.end() && it->second.mtime == mtime && it->second.size == size) {
+            return it->second.section;
+        }
+    }
+
+    std::shared_ptr<IniSection> parsed = std::make_shared<IniSection>();
+
+    MappedFile file;
+    if (file.open(filePath)) {
+        *parsed = parse(reinterpret_cast<const char*>(file.data()), file.size(), section);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Only a game directory that keeps changing grows this, start over then.
+    if (m_entries.size() >= SETTINGSCACHESIZE && m_entries.count(key) == 0) {
+        m_entries.clear();
+    }
+
+    m_entries[key] = Entry{mtime, size, parsed};
+
+    return parsed;
+}
+
+inline void SettingsCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+}
+
+inline size_t SettingsCache::size() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+/**
+ * Collect `key=value` lines of every `[section]` block, matching the name case-insensitively.
+ * Keys and values are trimmed, lines starting with ';' are comments, a later key wins.
+ */
+inline IniSection SettingsCache::parse(const char* data, size_t size, const std::string& section) {
+    IniSection ret;
+
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+
+    const char* p   = data;
+    const char* end = data + size;
+    bool inSection  = false;
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (eol == nullptr) {
+            eol = end;
+        }
+
+        const char* b = p;
+        const char* e = eol;
+        p             = eol + 1;
+
+        while (b < e && isSpace(*b)) {
+            b++;
+        }
+        while (e > b && isSpace(e[-1])) {
+            e--;
+        }
+
+        if (b == e || *b == ';') {
+            continue;
+        }
+
+        if (*b == '[') {
+            const char* close = static_cast<const char*>(memchr(b, ']', e - b));
+
+            if (close != nullptr) {
+                size_t len = close - b - 1;
+                inSection  = len == section.size();
+
+                for (size_t i = 0; inSection && i < len; i++) {
+                    inSection = std::tolower(static_cast<unsigned char>(b[1 + i])) ==
+                                std::tolower(static_cast<unsigned char>(section[i]));
+                }
+            }
+            continue;
+        }
+
+        if (!inSection) {
+            continue;
+        }
+
+        const char* eq = static_cast<const char*>(memchr(b, '=', e - b));
+        if (eq == nullptr) {
+            continue;
+        }
+
+        const char* keyEnd   = eq;
+        const char* valueBeg = eq + 1;
+
+        while (keyEnd > b && isSpace(keyEnd[-1])) {
+            keyEnd--;
+        }
+        while (valueBeg < e && isSpace(*valueBeg)) {
+            valueBeg++;
+        }
+
+        ret[toLower(std::string(b, keyEnd))] = std::string(valueBeg, e);
+    }
+
+    return ret;
+}
+
+inline IniFile::IniFile(std::string filePath, std::string seg) {
+    m_filePath = filePath;
+    m_seg      = seg;
+    m_section  = SettingsCache::getInstance().load(m_filePath, m_seg);
+}
+
+inline bool IniFile::isItemExist(std::string item) {
+    return m_section->count(toLower(item)) != 0;
+}
+
+inline std::string IniFile::getItem(std::string item) {
+    auto it = m_section->find(toLower(item));
+
+    if (it == m_section->end()) {
+        return "";
+    }
+    return it->second;
+}
+
+inline bool IniFile::getItemBool(std::string item) {
+    std::string res = toLower(getItem(item));
+
+    if (res == "false" || res == "no" || res == "0" || res == "") {
+        return false;
+    }
+    return true;
+}
+
+inline int IniFile::getItemInt(std::string item) {
+    std::string res = getItem(item);
+
+    try {
+        int ret = std::stoi(res);
+        return ret;
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "stoi: Invalid Argument." << std::endl;
+    } catch (const std::out_of_range& e) {
+        std::cerr << "stoi: Out of Range." << std::endl;
+    }
+    return 0;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_SETTINGS_HPP_
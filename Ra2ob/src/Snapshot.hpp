@@ -0,0 +1,282 @@
+#ifndef RA2OB_SRC_SNAPSHOT_HPP_
+#define RA2OB_SRC_SNAPSHOT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Datatypes.hpp"
+#include "./PathPlan.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+/**
+ * tagGameInfo without a single allocation, so it copies with a memcpy and can be placed in
+ * shared memory. Strings are fixed arrays, or NamePool ids for names from a finite set,
+ * and every list is a bounded array with a count.
+ *
+ * Units and path fields are described once in the snapshot's own tables, players refer to
+ * them by position. A player only lists the units it has any of.
+ */
+
+struct tagSnapUnit {
+    uint32_t name;  // NamePool id.
+    int16_t index;
+    bool show;
+};
+
+struct tagSnapField {
+    uint32_t name;  // NamePool id.
+    FieldType type;
+    int32_t size;
+};
+
+struct tagSnapCount {
+    uint16_t unit;  // Into GameSnapshot::units.
+    int32_t num;
+};
+
+struct tagSnapBuilding {
+    uint16_t unit;  // Into GameSnapshot::units.
+    int32_t number;
+    int32_t progress;
+    int32_t status;
+};
+
+struct tagSnapSuper {
+    uint32_t name;  // NamePool id.
+    int32_t total;
+    int32_t left;
+    int32_t status;
+};
+
+struct tagSnapPanel {
+    char playerName[SNAPNAMESIZE];
+    char playerNameUtf[SNAPNAMESIZE];
+    int32_t balance;
+    int32_t creditSpent;
+    int32_t powerDrain;
+    int32_t powerOutput;
+    uint32_t color;  // 0xRRGGBB.
+    char country[SNAPCOUNTRYSIZE];
+    std::array<uint64_t, SNAPMAXFIELDS> fields;  // Raw, see GameSnapshot::fields.
+};
+
+struct tagSnapPlayer {
+    bool valid;
+    tagStatusInfo status;
+    tagSnapPanel panel;
+    int32_t unitCount;
+    std::array<tagSnapCount, SNAPMAXPLAYERUNITS> units;
+    int32_t unitsDropped;  // Types it has any of that did not fit units this tick.
+    int32_t buildingCount;
+    std::array<tagSnapBuilding, SNAPMAXBUILDINGS> building;
+    int32_t superCount;
+    std::array<tagSnapSuper, SNAPMAXSUPERS> superTimer;
+    tagScoreInfo score;
+};
+
+struct tagSnapDebug {
+    std::array<uint32_t, MAXPLAYER> playerBase;
+    std::array<uint32_t, MAXPLAYER> buildingBase;
+    std::array<uint32_t, MAXPLAYER> infantryBase;
+    std::array<uint32_t, MAXPLAYER> tankBase;
+    std::array<uint32_t, MAXPLAYER> aircraftBase;
+    std::array<uint32_t, MAXPLAYER> houseType;
+    std::array<uint32_t, MAXPLAYER> playerTeamNumber;
+    std::array<bool, MAXPLAYER> playerDefeatFlag;
+    std::array<bool, MAXPLAYER> playerGameoverFlag;
+    std::array<bool, MAXPLAYER> playerWinnerFlag;
+};
+
+struct GameSnapshot {
+    bool valid;
+    bool isObserver;
+    bool isGameOver;
+    bool isGamePaused;
+    int32_t allPlayers;
+    int32_t leftPlayers;
+    Version gameVersion;
+    int32_t currentFrame;
+    char mapName[SNAPMAPNAMESIZE];
+    char mapNameUtf[SNAPMAPNAMESIZE];
+    int32_t unitCount;
+    std::array<tagSnapUnit, SNAPMAXUNITS> units;
+    int32_t unitsDropped;  // Units of the plan past SNAPMAXUNITS, never listed.
+    int32_t fieldCount;
+    std::array<tagSnapField, SNAPMAXFIELDS> fields;
+    std::array<tagSnapPlayer, MAXPLAYER> players;
+    tagSnapDebug debug;
+    tagStamp stamp;
+};
+
+static_assert(std::is_trivially_copyable<GameSnapshot>::value, "GameSnapshot must memcpy");
+static_assert(std::is_standard_layout<GameSnapshot>::value, "GameSnapshot must memcpy");
+static_assert(SNAPMAXUNITS <= 0x10000, "tagSnapCount::unit holds a unit id");
+
+template <size_t N>
+void copyString(char (&dst)[N], const std::string& src);
+void toGameInfo(const GameSnapshot& snap, tagGameInfo* gi);
+
+/**
+ * Source Code
+ */
+
+/**
+ * Copy as much of src as fits, always terminated.
+ */
+template <size_t N>
+inline void copyString(char (&dst)[N], const std::string& src) {
+    size_t size = std::min(src.size(), N - 1);
+
+    std::memcpy(dst, src.data(), size);
+    dst[size] = '\0';
+}
+
+/**
+ * The legacy struct for a snapshot. Only debug.setting, which attach() fills, is left as
+ * it was. Strings and lists already in gi are reused, so converting into the same struct
+ * every tick mostly allocates when something grows.
+ */
+inline void toGameInfo(const GameSnapshot& snap, tagGameInfo* gi) {
+    gi->valid        = snap.valid;
+    gi->isObserver   = snap.isObserver;
+    gi->isGameOver   = snap.isGameOver;
+    gi->isGamePaused = snap.isGamePaused;
+    gi->allPlayers   = snap.allPlayers;
+    gi->leftPlayers  = snap.leftPlayers;
+    gi->gameVersion  = snap.gameVersion == Version::Yr ? "Yr" : "Ra2";
+    gi->currentFrame = snap.currentFrame;
+    gi->mapName      = snap.mapName;
+    gi->mapNameUtf   = snap.mapNameUtf;
+    gi->stamp        = snap.stamp;
+
+    static thread_local std::vector<const char*> unitNames;
+    static thread_local std::string key;
+
+    unitNames.clear();
+    for (int u = 0; u < snap.unitCount; u++) {
+        unitNames.push_back(NamePool::name(snap.units[u].name));
+    }
+
+    for (int i = 0; i < MAXPLAYER; i++) {
+        const tagSnapPlayer& sp = snap.players[i];
+        tagPlayer& p            = gi->players[i];
+
+        if (!sp.valid) {
+            if (p.valid) {
+                p = tagPlayer{};
+            }
+            continue;
+        }
+
+        const tagSnapPanel& spi = sp.panel;
+        tagPanelInfo& pi        = p.panel;
+
+        char color[9];
+        snprintf(color, sizeof(color), "%x", spi.color);
+
+        pi.playerName    = spi.playerName;
+        pi.playerNameUtf = spi.playerNameUtf;
+        pi.balance       = spi.balance;
+        pi.creditSpent   = spi.creditSpent;
+        pi.powerDrain    = spi.powerDrain;
+        pi.powerOutput   = spi.powerOutput;
+        pi.color         = color;
+        pi.country       = spi.country;
+
+        // Start over only if the fields are not the ones converted last time.
+        bool sameFields = pi.fields.size() == static_cast<size_t>(snap.fieldCount);
+        for (int f = 0; f < snap.fieldCount && sameFields; f++) {
+            key        = NamePool::name(snap.fields[f].name);
+            sameFields = pi.fields.contains(key);
+        }
+        if (!sameFields) {
+            pi.fields = json::object();
+        }
+
+        for (int f = 0; f < snap.fieldCount; f++) {
+            const tagSnapField& sf = snap.fields[f];
+            json value             = PathPlan::decode(spi.fields[f], sf.type, sf.size);
+
+            key = NamePool::name(sf.name);
+            pi.fields[key].swap(value);
+        }
+
+        // Every unit, with a count of 0 for those the player has none of.
+        std::vector<tagUnitSingle>& units = p.units.units;
+        units.resize(snap.unitCount);
+
+        for (int u = 0; u < snap.unitCount; u++) {
+            units[u].unitName = unitNames[u];
+            units[u].index    = snap.units[u].index;
+            units[u].num      = 0;
+            units[u].show     = snap.units[u].show;
+        }
+        for (int u = 0; u < sp.unitCount; u++) {
+            units[sp.units[u].unit].num = sp.units[u].num;
+        }
+
+        std::vector<tagBuildingNode>& building = p.building.list;
+        if (building.size() > static_cast<size_t>(sp.buildingCount)) {
+            building.erase(building.begin() + sp.buildingCount, building.end());
+        }
+
+        for (int b = 0; b < sp.buildingCount; b++) {
+            const tagSnapBuilding& sb = sp.building[b];
+
+            if (static_cast<size_t>(b) == building.size()) {
+                building.push_back(tagBuildingNode(unitNames[sb.unit]));
+            }
+
+            building[b].name     = unitNames[sb.unit];
+            building[b].number   = sb.number;
+            building[b].progress = sb.progress;
+            building[b].status   = sb.status;
+        }
+
+        std::vector<tagSuperNode>& supers = p.superTimer.list;
+        if (supers.size() > static_cast<size_t>(sp.superCount)) {
+            supers.erase(supers.begin() + sp.superCount, supers.end());
+        }
+
+        for (int s = 0; s < sp.superCount; s++) {
+            const tagSnapSuper& st = sp.superTimer[s];
+
+            if (static_cast<size_t>(s) == supers.size()) {
+                supers.push_back(tagSuperNode(NamePool::name(st.name), st.total));
+            }
+
+            supers[s].name   = NamePool::name(st.name);
+            supers[s].total  = st.total;
+            supers[s].left   = st.left;
+            supers[s].status = st.status;
+        }
+
+        p.valid  = true;
+        p.status = sp.status;
+        p.score  = sp.score;
+    }
+
+    gi->debug.playerBase         = snap.debug.playerBase;
+    gi->debug.buildingBase       = snap.debug.buildingBase;
+    gi->debug.infantryBase       = snap.debug.infantryBase;
+    gi->debug.tankBase           = snap.debug.tankBase;
+    gi->debug.aircraftBase       = snap.debug.aircraftBase;
+    gi->debug.houseType          = snap.debug.houseType;
+    gi->debug.playerTeamNumber   = snap.debug.playerTeamNumber;
+    gi->debug.playerDefeatFlag   = snap.debug.playerDefeatFlag;
+    gi->debug.playerGameoverFlag = snap.debug.playerGameoverFlag;
+    gi->debug.playerWinnerFlag   = snap.debug.playerWinnerFlag;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_SNAPSHOT_HPP_
@@ -0,0 +1,401 @@
+#ifndef RA2OB_SRC_TIMELINE_HPP_
+#define RA2OB_SRC_TIMELINE_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./Datatypes.hpp"
+
+namespace Ra2ob {
+
+/**
+ * Timeline file layout (little endian):
+ *
+ *   header   magic[8] keyInterval:u32 reserved:u32
+ *   record   frame:u32 kind:u8 pad[3] size:u32 payload[size]   (repeated)
+ *   index    frame:u32 reserved:u32 offset:u64                  (one per keyframe)
+ *   trailer  indexOffset:u64 keyCount:u32 lastFrame:u32 magic[8]
+ *
+ * Keyframes carry the whole tagGameInfo as msgpack, deltas carry a msgpack json patch
+ * against the previous record. A keyframe is written every keyInterval records, so a
+ * seek replays at most keyInterval - 1 deltas.
+ */
+
+constexpr int TL_HEADERSIZE  = 16;
+constexpr int TL_RECORDSIZE  = 12;
+constexpr int TL_INDEXSIZE   = 16;
+constexpr int TL_TRAILERSIZE = 24;
+
+enum class RecordKind : uint8_t { Key = 0, Delta = 1 };
+
+class TimelineWriter {
+public:
+    explicit TimelineWriter(std::string filePath, int keyInterval = TL_KEYINTERVAL);
+    ~TimelineWriter();
+
+    TimelineWriter(const TimelineWriter&) = delete;
+    void operator=(const TimelineWriter&) = delete;
+
+    bool isOpen();
+    bool append(const tagGameInfo& gi);
+    void close();
+
+private:
+    void writeRecord(uint32_t frame, RecordKind kind, const std::vector<uint8_t>& payload);
+
+    template <typename T>
+    void writePod(const T& value);
+
+    std::ofstream m_file;
+    json m_last;
+    int m_keyInterval;
+    int m_sinceKey    = 0;
+    int m_lastFrame   = -1;
+    uint64_t m_offset = 0;
+    std::vector<std::pair<uint32_t, uint64_t>> m_index;
+};
+
+class Timeline {
+public:
+    Timeline();
+    explicit Timeline(const std::string& filePath);
+
+    bool open(const std::string& filePath);
+    bool isOpen();
+    size_t keyCount();
+    int firstFrame();
+    int lastFrame();
+
+    bool seek(int frame, tagGameInfo* gi);
+
+private:
+    struct Record {
+        uint32_t frame;
+        RecordKind kind;
+        uint32_t size;
+        const uint8_t* payload;
+        uint64_t next;
+    };
+
+    bool loadIndex();
+    bool rebuildIndex();
+    bool readRecord(uint64_t offset, Record* rec);
+    uint32_t keyFrameAt(size_t i);
+    uint64_t keyOffsetAt(size_t i);
+
+    template <typename T>
+    T readPod(uint64_t offset);
+
+    MappedFile m_file;
+    const uint8_t* m_index = nullptr;
+    size_t m_keyCount      = 0;
+    uint64_t m_end         = 0;
+    int m_lastFrame        = 0;
+    std::vector<uint8_t> m_rebuilt;
+};
+
+/**
+ * Source Code
+ */
+
+inline TimelineWriter::TimelineWriter(std::string filePath, int keyInterval) {
+    m_keyInterval = std::max(1, keyInterval);
+    m_file.open(filePath, std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open()) {
+        std::cerr << "Timeline: could not open " << filePath << " for writing.\n";
+        return;
+    }
+
+    m_file.write(TL_MAGIC, 8);
+    writePod(static_cast<uint32_t>(m_keyInterval));
+    writePod(static_cast<uint32_t>(0));
+    m_offset = TL_HEADERSIZE;
+}
+
+inline TimelineWriter::~TimelineWriter() { close(); }
+
+inline bool TimelineWriter::isOpen() { return m_file.is_open(); }
+
+/**
+ * Append a captured frame. Frames must not go backwards, a new match needs a new file.
+ */
+inline bool TimelineWriter::append(const tagGameInfo& gi) {
+    if (!m_file.is_open() || gi.currentFrame < m_lastFrame) {
+        return false;
+    }
+
+    json cur = gi;
+
+    if (m_sinceKey == 0 || m_sinceKey >= m_keyInterval) {
+        m_index.push_back({static_cast<uint32_t>(gi.currentFrame), m_offset});
+        writeRecord(gi.currentFrame, RecordKind::Key, json::to_msgpack(cur));
+        m_sinceKey = 1;
+    } else {
+        json patch = json::diff(m_last, cur);
+
+        if (patch.empty()) {
+            return true;
+        }
+
+        writeRecord(gi.currentFrame, RecordKind::Delta, json::to_msgpack(patch));
+        m_sinceKey++;
+    }
+
+    m_last      = std::move(cur);
+    m_lastFrame = gi.currentFrame;
+
+    return true;
+}
+
+inline void TimelineWriter::close() {
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    uint64_t indexOffset = m_offset;
+
+    for (auto& it : m_index) {
+        writePod(it.first);
+        writePod(static_cast<uint32_t>(0));
+        writePod(it.second);
+    }
+
+    writePod(indexOffset);
+    writePod(static_cast<uint32_t>(m_index.size()));
+    writePod(static_cast<uint32_t>(std::max(0, m_lastFrame)));
+    m_file.write(TL_INDEXMAGIC, 8);
+
+    m_file.close();
+}
+
+inline void TimelineWriter::writeRecord(uint32_t frame, RecordKind kind,
+                                        const std::vector<uint8_t>& payload) {
+    uint8_t pad[3] = {0, 0, 0};
+
+    uint64_t recordOffset = m_offset;
+
+    writePod(frame);
+    writePod(static_cast<uint8_t>(kind));
+    m_file.write(reinterpret_cast<const char*>(pad), sizeof(pad));
+    writePod(static_cast<uint32_t>(payload.size()));
+    m_file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+    m_offset = recordOffset + TL_RECORDSIZE + payload.size();
+}
+
+template <typename T>
+inline void TimelineWriter::writePod(const T& value) {
+    m_file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+inline Timeline::Timeline() {}
+
+inline Timeline::Timeline(const std::string& filePath) { open(filePath); }
+
+inline bool Timeline::open(const std::string& filePath) {
+    m_index    = nullptr;
+    m_keyCount = 0;
+    m_rebuilt.clear();
+
+    if (!m_file.open(filePath)) {
+        std::cerr << "Timeline: could not map " << filePath << ".\n";
+        return false;
+    }
+
+    if (m_file.size() < TL_HEADERSIZE || std::memcmp(m_file.data(), TL_MAGIC, 8) != 0) {
+        std::cerr << "Timeline: " << filePath << " is not a timeline file.\n";
+        m_file.close();
+        return false;
+    }
+
+    if (!loadIndex() && !rebuildIndex()) {
+        std::cerr << "Timeline: " << filePath << " holds no keyframe.\n";
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+inline bool Timeline::isOpen() { return m_file.isOpen(); }
+
+inline size_t Timeline::keyCount() { return m_keyCount; }
+
+inline int Timeline::firstFrame() { return m_keyCount == 0 ? 0 : keyFrameAt(0); }
+
+inline int Timeline::lastFrame() { return m_lastFrame; }
+
+/**
+ * Reconstruct the state at the given frame: binary search over the keyframe index,
+ * then replay the deltas that follow it up to the frame.
+ */
+inline bool Timeline::seek(int frame, tagGameInfo* gi) {
+    if (m_keyCount == 0 || frame < firstFrame()) {
+        return false;
+    }
+
+    size_t lo = 0;
+    size_t hi = m_keyCount;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (static_cast<int>(keyFrameAt(mid)) <= frame) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    Record rec;
+    if (!readRecord(keyOffsetAt(lo), &rec) || rec.kind != RecordKind::Key) {
+        return false;
+    }
+
+    json state = json::from_msgpack(rec.payload, rec.payload + rec.size, true, false);
+    if (state.is_discarded()) {
+        return false;
+    }
+
+    uint64_t offset = rec.next;
+
+    while (offset < m_end && readRecord(offset, &rec)) {
+        if (rec.kind == RecordKind::Key || static_cast<int>(rec.frame) > frame) {
+            break;
+        }
+
+        json patch = json::from_msgpack(rec.payload, rec.payload + rec.size, true, false);
+        if (patch.is_discarded()) {
+            return false;
+        }
+
+        bool applied = false;
+        try {
+            applied = applyJsonPatch(&state, patch);
+        } catch (const json::exception&) {
+            // Malformed, which fails the same as one that does not apply.
+        }
+
+        if (!applied) {
+            std::cerr << "Timeline: bad delta at frame " << rec.frame << ".\n";
+            return false;
+        }
+
+        offset = rec.next;
+    }
+
+    try {
+        *gi = state.get<tagGameInfo>();
+    } catch (const json::exception& e) {
+        std::cerr << "Timeline: bad keyframe at frame " << keyFrameAt(lo) << ".\n";
+        return false;
+    }
+
+    return true;
+}
+
+inline bool Timeline::loadIndex() {
+    size_t size = m_file.size();
+
+    if (size < TL_HEADERSIZE + TL_TRAILERSIZE) {
+        return false;
+    }
+
+    uint64_t trailer = size - TL_TRAILERSIZE;
+
+    if (std::memcmp(m_file.data() + trailer + 16, TL_INDEXMAGIC, 8) != 0) {
+        return false;
+    }
+
+    uint64_t indexOffset = readPod<uint64_t>(trailer);
+    uint32_t keyCount    = readPod<uint32_t>(trailer + 8);
+
+    // A recording closed before its first frame has an empty index, which is still one.
+    if (indexOffset < TL_HEADERSIZE ||
+        indexOffset + static_cast<uint64_t>(keyCount) * TL_INDEXSIZE != trailer) {
+        return false;
+    }
+
+    m_index     = m_file.data() + indexOffset;
+    m_keyCount  = keyCount;
+    m_end       = indexOffset;
+    m_lastFrame = readPod<uint32_t>(trailer + 12);
+
+    return true;
+}
+
+/**
+ * An unfinished recording has no index, walk the records once to build it in memory.
+ */
+inline bool Timeline::rebuildIndex() {
+    m_end = m_file.size();
+
+    uint64_t offset = TL_HEADERSIZE;
+    Record rec;
+
+    while (offset < m_end && readRecord(offset, &rec)) {
+        if (rec.kind == RecordKind::Key) {
+            uint8_t entry[TL_INDEXSIZE] = {};
+            std::memcpy(entry, &rec.frame, 4);
+            std::memcpy(entry + 8, &offset, 8);
+            m_rebuilt.insert(m_rebuilt.end(), entry, entry + TL_INDEXSIZE);
+        }
+
+        m_lastFrame = rec.frame;
+        offset      = rec.next;
+    }
+
+    m_end      = offset;
+    m_index    = m_rebuilt.data();
+    m_keyCount = m_rebuilt.size() / TL_INDEXSIZE;
+
+    return m_keyCount != 0;
+}
+
+inline bool Timeline::readRecord(uint64_t offset, Record* rec) {
+    if (offset + TL_RECORDSIZE > m_end) {
+        return false;
+    }
+
+    rec->frame = readPod<uint32_t>(offset);
+    rec->kind  = static_cast<RecordKind>(readPod<uint8_t>(offset + 4));
+    rec->size  = readPod<uint32_t>(offset + 8);
+
+    if (offset + TL_RECORDSIZE + rec->size > m_end) {
+        return false;
+    }
+
+    rec->payload = m_file.data() + offset + TL_RECORDSIZE;
+    rec->next    = offset + TL_RECORDSIZE + rec->size;
+
+    return true;
+}
+
+inline uint32_t Timeline::keyFrameAt(size_t i) {
+    uint32_t frame;
+    std::memcpy(&frame, m_index + i * TL_INDEXSIZE, 4);
+    return frame;
+}
+
+inline uint64_t Timeline::keyOffsetAt(size_t i) {
+    uint64_t offset;
+    std::memcpy(&offset, m_index + i * TL_INDEXSIZE + 8, 8);
+    return offset;
+}
+
+template <typename T>
+inline T Timeline::readPod(uint64_t offset) {
+    T value;
+    std::memcpy(&value, m_file.data() + offset, sizeof(T));
+    return value;
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_TIMELINE_HPP_
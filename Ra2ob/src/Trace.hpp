@@ -0,0 +1,345 @@
+#ifndef RA2OB_SRC_TRACE_HPP_
+#define RA2OB_SRC_TRACE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+enum class TraceKind : uint8_t {
+    Stage = 0,  // Steps of detectTask() and fetchTask().
+    Batch = 1,  // Reader::readBatch() calls.
+    Read  = 2,  // Every single read, only when asked for.
+};
+
+struct tagTraceEvent {
+    const char* name;  // The site's literal.
+    int64_t begin;     // steadyNs().
+    int64_t end;
+    uint32_t arg;  // Requests of a batch, address of a read.
+    TraceKind kind;
+};
+
+/**
+ * Records what the fetch does as Chrome trace events, off until started.
+ *
+ * Every thread appends to a buffer of its own, preallocated by start(), without locks or
+ * allocations; save() writes them all as one trace for chrome://tracing or
+ * ui.perfetto.dev. A thread whose buffer is full, or that found none left, drops its
+ * events, see dropped(). While stopped, a site costs a load and a branch.
+ */
+class Tracer {
+public:
+    static bool start(bool reads = false, int eventsPerThread = TRACEEVENTS, int threads = 0);
+    static void stop();
+    static bool save(const std::string& filePath = F_TRACE);
+    static bool enabled(TraceKind kind);
+    static uint64_t dropped();
+
+    static void nameThread(const char* name);
+    static void record(TraceKind kind, const char* name, int64_t begin, int64_t end,
+                       uint32_t arg = 0);
+
+private:
+    // Written by the thread that claimed it, read by save().
+    struct Buffer {
+        std::unique_ptr<tagTraceEvent[]> events;
+        int capacity       = 0;
+        const char* thread = nullptr;
+        std::atomic<int> count{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    struct State {
+        std::mutex mutex;  // start(), stop() and save().
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        std::atomic<int> available{0};
+        std::atomic<int> claimed{0};
+        std::atomic<uint32_t> generation{0};
+        std::atomic<uint64_t> unbuffered{0};  // Events of threads that found no buffer.
+        int64_t started = 0;
+    };
+
+    // The calling thread's buffer, claimed again after every start().
+    struct ThreadSlot {
+        uint32_t generation = 0;
+        Buffer* buffer      = nullptr;
+        const char* name    = nullptr;
+    };
+
+    static std::atomic<uint32_t>& mask();
+    static State& state();
+    static ThreadSlot& slot();
+    static Buffer* threadBuffer();
+};
+
+/**
+ * One trace event for the time in scope, if its kind is being traced.
+ */
+class TraceScope {
+public:
+    TraceScope(TraceKind kind, const char* name, uint32_t arg = 0);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&)     = delete;
+    void operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;  // nullptr while not tracing.
+    int64_t m_begin;
+    uint32_t m_arg;
+    TraceKind m_kind;
+};
+
+/**
+ * Source Code
+ */
+
+/**
+ * Trace stages and batches, and every read if reads is set, into eventsPerThread events
+ * for each of threads threads (default one per core plus TRACESPARETHREADS). Buffers are
+ * kept and reused by the next start(), so the allocation happens here only.
+ */
+inline bool Tracer::start(bool reads, int eventsPerThread, int threads) {
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency()) + TRACESPARETHREADS;
+    }
+
+    if (eventsPerThread <= 0) {
+        std::cerr << "Tracer: no room for events.\n";
+        return false;
+    }
+
+    mask().store(0, std::memory_order_relaxed);
+
+    while (static_cast<int>(st.buffers.size()) < threads) {
+        st.buffers.push_back(std::unique_ptr<Buffer>(new Buffer()));
+    }
+
+    for (auto& b : st.buffers) {
+        if (b->capacity < eventsPerThread) {
+            b->events.reset(new tagTraceEvent[eventsPerThread]);
+            b->capacity = eventsPerThread;
+        }
+
+        b->thread = nullptr;
+        b->count.store(0, std::memory_order_relaxed);
+        b->dropped.store(0, std::memory_order_relaxed);
+    }
+
+    st.available.store(threads, std::memory_order_relaxed);
+    st.claimed.store(0, std::memory_order_relaxed);
+    st.unbuffered.store(0, std::memory_order_relaxed);
+    st.started = steadyNs();
+    st.generation.fetch_add(1, std::memory_order_release);
+
+    uint32_t kinds = 1u << static_cast<int>(TraceKind::Stage) |
+                     1u << static_cast<int>(TraceKind::Batch);
+    if (reads) {
+        kinds |= 1u << static_cast<int>(TraceKind::Read);
+    }
+
+    mask().store(kinds, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * Stop recording, what was recorded stays for save().
+ */
+inline void Tracer::stop() {
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+
+    mask().store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Write what was recorded since start() in Chrome's trace event format, one track per
+ * thread, times in µs from start(). Names are the sites' literals and are not escaped.
+ */
+inline bool Tracer::save(const std::string& filePath) {
+    static const char* kinds[] = {"stage", "batch", "read"};
+
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    std::ofstream f(filePath);
+
+    if (!f.is_open()) {
+        std::cerr << "Tracer: could not write " << filePath << ".\n";
+        return false;
+    }
+
+    int buffers = std::min(st.claimed.load(), st.available.load());
+    char line[256];
+    bool first = true;
+
+    f << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for (int t = 0; t < buffers; t++) {
+        Buffer& b = *st.buffers[t];
+        int count = b.count.load(std::memory_order_acquire);
+
+        std::snprintf(line, sizeof(line),
+                      "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                      "\"args\":{\"name\":\"%s\"}}",
+                      first ? "" : ",", t, b.thread != nullptr ? b.thread : "thread");
+        f << line;
+        first = false;
+
+        for (int i = 0; i < count; i++) {
+            const tagTraceEvent& e = b.events[i];
+            int kind               = static_cast<int>(e.kind);
+
+            int n = std::snprintf(line, sizeof(line),
+                                  ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                                  "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                                  e.name, kinds[kind], t, (e.begin - st.started) / 1000.0,
+                                  (e.end - e.begin) / 1000.0);
+
+            if (e.kind == TraceKind::Batch) {
+                std::snprintf(line + n, sizeof(line) - n, ",\"args\":{\"requests\":%u}}",
+                              e.arg);
+            } else if (e.kind == TraceKind::Read) {
+                std::snprintf(line + n, sizeof(line) - n, ",\"args\":{\"addr\":\"0x%x\"}}",
+                              e.arg);
+            } else {
+                std::snprintf(line + n, sizeof(line) - n, "}");
+            }
+
+            f << line;
+        }
+    }
+
+    f << "\n]}\n";
+
+    if (!f) {
+        std::cerr << "Tracer: could not write " << filePath << ".\n";
+        return false;
+    }
+
+    return true;
+}
+
+inline bool Tracer::enabled(TraceKind kind) {
+    return (mask().load(std::memory_order_relaxed) & (1u << static_cast<int>(kind))) != 0;
+}
+
+/**
+ * Events lost to full buffers or to threads beyond the buffers since start().
+ */
+inline uint64_t Tracer::dropped() {
+    State& st = state();
+    std::lock_guard<std::mutex> lock(st.mutex);
+    uint64_t ret = st.unbuffered.load(std::memory_order_relaxed);
+
+    for (auto& b : st.buffers) {
+        ret += b->dropped.load(std::memory_order_relaxed);
+    }
+
+    return ret;
+}
+
+/**
+ * Name the calling thread's track, with a literal. Can be called before start().
+ */
+inline void Tracer::nameThread(const char* name) {
+    ThreadSlot& s = slot();
+
+    s.name = name;
+    if (s.buffer != nullptr &&
+        s.generation == state().generation.load(std::memory_order_acquire)) {
+        s.buffer->thread = name;
+    }
+}
+
+inline void Tracer::record(TraceKind kind, const char* name, int64_t begin, int64_t end,
+                           uint32_t arg) {
+    Buffer* b = threadBuffer();
+
+    if (b == nullptr) {
+        state().unbuffered.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    int n = b->count.load(std::memory_order_relaxed);
+
+    if (n >= b->capacity) {
+        b->dropped.store(b->dropped.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+        return;
+    }
+
+    b->events[n] = {name, begin, end, arg, kind};
+    b->count.store(n + 1, std::memory_order_release);
+}
+
+/**
+ * Constant-initialized, so checking it needs no guard.
+ */
+inline std::atomic<uint32_t>& Tracer::mask() {
+    static std::atomic<uint32_t> ret{0};
+    return ret;
+}
+
+inline Tracer::State& Tracer::state() {
+    static State ret;
+    return ret;
+}
+
+inline Tracer::ThreadSlot& Tracer::slot() {
+    static thread_local ThreadSlot ret;
+    return ret;
+}
+
+inline Tracer::Buffer* Tracer::threadBuffer() {
+    ThreadSlot& s  = slot();
+    State& st      = state();
+    uint32_t start = st.generation.load(std::memory_order_acquire);
+
+    if (s.generation != start) {
+        int index = st.claimed.fetch_add(1, std::memory_order_relaxed);
+
+        s.generation = start;
+        s.buffer = index < st.available.load(std::memory_order_relaxed) ? st.buffers[index].get()
+                                                                          : nullptr;
+        if (s.buffer != nullptr) {
+            s.buffer->thread = s.name;
+        }
+    }
+
+    return s.buffer;
+}
+
+inline TraceScope::TraceScope(TraceKind kind, const char* name, uint32_t arg)
+    : m_name(nullptr), m_begin(0), m_arg(arg), m_kind(kind) {
+    if (Tracer::enabled(kind)) {
+        m_name  = name;
+        m_begin = steadyNs();
+    }
+}
+
+inline TraceScope::~TraceScope() {
+    if (m_name != nullptr) {
+        Tracer::record(m_kind, m_name, m_begin, steadyNs(), m_arg);
+    }
+}
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_TRACE_HPP_
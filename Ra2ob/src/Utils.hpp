@@ -1,20 +1,58 @@
 #ifndef RA2OB_SRC_UTILS_HPP_
 #define RA2OB_SRC_UTILS_HPP_
 
-#include <Windows.h>
-
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <iconv.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>  // NOLINT
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
-#include "./third_party/inicpp.hpp"
+#include "./Constants.hpp"
+#include "./Platform.hpp"
 #include "./third_party/json.hpp"
 
 using json = nlohmann::json;
 
 namespace Ra2ob {
 
+// One UTF-16 code unit, as the game stores strings.
+#ifdef _WIN32
+using utf16char = wchar_t;
+#else
+using utf16char = char16_t;
+#endif
+using utf16string = std::basic_string<utf16char>;
+
+/**
+ * Monotonic time in ns, what snapshots are stamped with.
+ */
+inline int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 inline json readJsonFromFile(std::string filePath) {
     std::ifstream f(filePath);
     json j;
@@ -29,55 +67,377 @@ inline json readJsonFromFile(std::string filePath) {
     return j;
 }
 
-class IniFile {
+/**
+ * Modification time and size of a file, false if it does not exist.
+ */
+inline bool statFile(const std::string& filePath, int64_t* mtime, int64_t* size) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(filePath.c_str(), &st) != 0) {
+        return false;
+    }
+
+    *mtime = static_cast<int64_t>(st.st_mtime);
+#else
+    struct stat st;
+    if (stat(filePath.c_str(), &st) != 0) {
+        return false;
+    }
+
+    *mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+
+    *size = static_cast<int64_t>(st.st_size);
+
+    return true;
+}
+
+/**
+ * 64-bit FNV-1a, chain calls by passing the previous hash.
+ */
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/**
+ * File in F_CACHEDIR for something derived from the content with this hash.
+ */
+inline std::string cachePath(const std::string& kind, uint64_t hash) {
+    std::ostringstream ss;
+    ss << F_CACHEDIR << "/" << kind << "_" << std::hex << std::setw(16) << std::setfill('0')
+       << hash << ".json";
+    return ss.str();
+}
+
+/**
+ * Create a directory, true if it exists afterwards.
+ */
+inline bool makeDir(const std::string& path) {
+#ifdef _WIN32
+    int ret = _mkdir(path.c_str());
+#else
+    int ret = mkdir(path.c_str(), 0755);
+#endif
+
+    return ret == 0 || errno == EEXIST;
+}
+
+/**
+ * A whole string as a 32-bit hex number, with or without "0x".
+ */
+inline bool parseHex(const std::string& str, uint32_t* value) {
+    if (str.empty() || str[0] == '-' || str[0] == '+') {
+        return false;
+    }
+
+    try {
+        size_t pos           = 0;
+        unsigned long long v = std::stoull(str, &pos, 16);
+
+        if (pos != str.size() || v > 0xFFFFFFFFull) {
+            return false;
+        }
+        *value = static_cast<uint32_t>(v);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Apply a json patch of add, remove and replace operations, all that json::diff() makes.
+ * json::patch_inplace() does the same, but the json.hpp shipped here warns wherever a
+ * json_pointer indexes a value (-Wdeprecated-declarations), so the path is walked one key
+ * at a time. False on an operation that does not apply, json::exception on a malformed one.
+ */
+inline bool applyJsonPatch(json* doc, const json& patch) {
+    auto parseIndex = [](const std::string& key, size_t* index) {
+        if (key.empty() || key.size() > 9 || key.find_first_not_of("0123456789") != key.npos) {
+            return false;
+        }
+        *index = std::stoul(key);
+        return true;
+    };
+
+    if (!patch.is_array()) {
+        return false;
+    }
+
+    for (const json& op : patch) {
+        std::string path = op.at("path").get<std::string>();
+        std::string kind = op.at("op").get<std::string>();
+        std::vector<std::string> keys;
+
+        if (kind != "add" && kind != "remove" && kind != "replace") {
+            return false;
+        }
+
+        // "/a/0/b", with "~1" for '/' and "~0" for '~' within keys.
+        for (size_t at = 0; at < path.size();) {
+            size_t next = std::min(path.find('/', at + 1), path.size());
+
+            if (path[at] != '/') {
+                return false;
+            }
+
+            keys.emplace_back();
+            for (size_t c = at + 1; c < next; c++) {
+                bool escaped = path[c] == '~' && c + 1 < next;
+                keys.back() += escaped ? (path[++c] == '1' ? '/' : '~') : path[c];
+            }
+            at = next;
+        }
+
+        if (keys.empty()) {
+            if (kind == "remove") {
+                return false;
+            }
+            *doc = op.at("value");
+            continue;
+        }
+
+        json* parent = doc;
+        size_t index = 0;
+
+        for (size_t k = 0; k + 1 < keys.size(); k++) {
+            bool item = parent->is_array() && parseIndex(keys[k], &index);
+            parent    = item ? &parent->at(index) : &parent->at(keys[k]);
+        }
+
+        const std::string& last = keys.back();
+
+        if (parent->is_array()) {
+            if (kind == "add" && last == "-") {
+                index = parent->size();
+            } else if (!parseIndex(last, &index)) {
+                return false;
+            }
+
+            if (index > parent->size() || (kind != "add" && index == parent->size())) {
+                return false;
+            }
+
+            auto it = parent->begin() + static_cast<std::ptrdiff_t>(index);
+
+            if (kind == "add") {
+                parent->insert(it, op.at("value"));
+            } else if (kind == "remove") {
+                parent->erase(it);
+            } else {
+                *it = op.at("value");
+            }
+        } else if (!parent->is_object()) {
+            return false;
+        } else if (kind == "remove") {
+            if (parent->erase(last) == 0) {
+                return false;
+            }
+        } else {
+            (*parent)[last] = op.at("value");
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Process-wide storage for names loaded at runtime, so objects can hold a plain pointer
+ * like they do for the compiled-in tables. Each distinct name is stored once, for good,
+ * and its id stays valid where a pointer cannot go, see Snapshot.hpp.
+ */
+class NamePool {
 public:
-    IniFile(std::string filePath, std::string seg);
+    static const char* intern(const std::string& name);
+    static uint32_t id(const std::string& name);
+    static const char* name(uint32_t id);
 
-    bool isItemExist(std::string item);
-    std::string getItem(std::string item);
-    bool getItemBool(std::string item);
-    int getItemInt(std::string item);
+private:
+    static NamePool& instance();
+    uint32_t add(const std::string& name);
+
+    std::mutex m_mutex;
+    std::deque<std::string> m_names;
+    std::unordered_map<std::string, uint32_t> m_index;
+};
+
+/**
+ * Read-only memory mapping of a whole file, pages are only touched when accessed.
+ */
+class MappedFile {
+public:
+    MappedFile();
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)     = delete;
+    void operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filePath);
+    void close();
+    bool isOpen() const;
+    const uint8_t* data() const;
+    size_t size() const;
 
 private:
-    inicpp::IniManager* im;
-    std::string m_filePath;
-    std::string m_seg;
+    const uint8_t* m_data = nullptr;
+    size_t m_size         = 0;
+#ifdef _WIN32
+    HANDLE m_file    = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
 };
 
-inline IniFile::IniFile(std::string filePath, std::string seg) {
-    m_filePath = filePath;
-    m_seg      = seg;
-    im         = new inicpp::IniManager(m_filePath);
-}
+inline MappedFile::MappedFile() {}
+
+inline MappedFile::MappedFile(const std::string& filePath) { open(filePath); }
 
-inline bool IniFile::isItemExist(std::string item) { return ((*im)[m_seg].isKeyExist(item)); }
+inline MappedFile::~MappedFile() { close(); }
 
-inline std::string IniFile::getItem(std::string item) { return ((*im)[m_seg][item]); }
+inline bool MappedFile::open(const std::string& filePath) {
+    close();
 
-inline bool IniFile::getItemBool(std::string item) {
-    std::string res = (*im)[m_seg][item];
+#ifdef _WIN32
+    m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+        close();
+        return false;
+    }
 
-    if (res == "False" || res == "0" || res == "") {
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        close();
         return false;
     }
+
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (addr != MAP_FAILED) {
+        m_data = static_cast<const uint8_t*>(addr);
+        m_size = static_cast<size_t>(st.st_size);
+    }
+#endif
+
+    if (m_data == nullptr) {
+        close();
+        return false;
+    }
+
     return true;
 }
 
-inline int IniFile::getItemInt(std::string item) {
-    std::string res = (*im)[m_seg][item];
+inline void MappedFile::close() {
+#ifdef _WIN32
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping != nullptr) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+    m_mapping = nullptr;
+    m_file    = INVALID_HANDLE_VALUE;
+#else
+    if (m_data != nullptr) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+/**
+ * fnv1a() of a whole file, 0 if it cannot be read.
+ */
+inline uint64_t hashFile(const std::string& filePath) {
+    MappedFile file;
 
-    try {
-        int ret = std::stoi(res);
-        return ret;
-    } catch (const std::invalid_argument& e) {
-        std::cerr << "stoi: Invalid Argument." << std::endl;
-    } catch (const std::out_of_range& e) {
-        std::cerr << "stoi: Out of Range." << std::endl;
+    if (!file.open(filePath)) {
+        return 0;
     }
-    return 0;
+
+    return fnv1a(file.data(), file.size());
 }
 
-inline std::string utf16ToGbk(const wchar_t* src_wstr) {
+inline const char* NamePool::intern(const std::string& name) {
+    NamePool& pool = instance();
+    std::lock_guard<std::mutex> lock(pool.m_mutex);
+
+    return pool.m_names[pool.add(name)].c_str();
+}
+
+inline uint32_t NamePool::id(const std::string& name) {
+    NamePool& pool = instance();
+    std::lock_guard<std::mutex> lock(pool.m_mutex);
+
+    return pool.add(name);
+}
+
+/**
+ * The name with this id, "" for an id never handed out.
+ */
+inline const char* NamePool::name(uint32_t id) {
+    NamePool& pool = instance();
+    std::lock_guard<std::mutex> lock(pool.m_mutex);
+
+    return id < pool.m_names.size() ? pool.m_names[id].c_str() : "";
+}
+
+inline NamePool& NamePool::instance() {
+    static NamePool pool;
+    return pool;
+}
+
+inline uint32_t NamePool::add(const std::string& name) {
+    auto it = m_index.find(name);
+    if (it != m_index.end()) {
+        return it->second;
+    }
+
+    uint32_t ret = static_cast<uint32_t>(m_names.size());
+    m_names.push_back(name);
+    m_index[name] = ret;
+
+    return ret;
+}
+
+inline bool MappedFile::isOpen() const { return m_data != nullptr; }
+
+inline const uint8_t* MappedFile::data() const { return m_data; }
+
+inline size_t MappedFile::size() const { return m_size; }
+
+#ifdef _WIN32
+inline std::string utf16ToGbk(const utf16char* src_wstr) {
     int len = WideCharToMultiByte(CP_ACP, 0, src_wstr, -1, nullptr, 0, nullptr, nullptr);
 
     std::vector<char> str(len);
@@ -87,7 +447,7 @@ inline std::string utf16ToGbk(const wchar_t* src_wstr) {
     return std::string(str.begin(), str.end() - 1);
 }
 
-inline std::string utf16ToUtf8(const wchar_t* src_wstr) {
+inline std::string utf16ToUtf8(const utf16char* src_wstr) {
     int len = WideCharToMultiByte(CP_UTF8, 0, src_wstr, -1, nullptr, 0, nullptr, nullptr);
 
     std::vector<char> str(len);
@@ -97,15 +457,60 @@ inline std::string utf16ToUtf8(const wchar_t* src_wstr) {
     return std::string(str.begin(), str.end() - 1);
 }
 
-inline std::wstring gbkToUtf16(const char* src_str) {
+inline utf16string gbkToUtf16(const char* src_str) {
     int len = MultiByteToWideChar(CP_ACP, 0, src_str, -1, nullptr, 0);
 
     std::vector<wchar_t> wstr(len);
 
     MultiByteToWideChar(CP_ACP, 0, src_str, -1, &wstr[0], len);
 
-    return std::wstring(wstr.begin(), wstr.end() - 1);
+    return utf16string(wstr.begin(), wstr.end() - 1);
+}
+#else
+/**
+ * Convert with iconv, up to the first sequence that does not convert.
+ */
+inline std::string iconvString(const char* to, const char* from, const char* src, size_t size) {
+    iconv_t cd = iconv_open(to, from);
+
+    if (cd == reinterpret_cast<iconv_t>(-1)) {
+        return "";
+    }
+
+    std::string str(size * 2 + 4, '\0');
+
+    char* in       = const_cast<char*>(src);
+    char* out      = &str[0];
+    size_t inLeft  = size;
+    size_t outLeft = str.size();
+
+    iconv(cd, &in, &inLeft, &out, &outLeft);
+    iconv_close(cd);
+
+    str.resize(str.size() - outLeft);
+
+    return str;
+}
+
+inline std::string utf16ToGbk(const utf16char* src_wstr) {
+    size_t len = std::char_traits<utf16char>::length(src_wstr);
+    return iconvString("GBK", "UTF-16LE", reinterpret_cast<const char*>(src_wstr), len * 2);
+}
+
+inline std::string utf16ToUtf8(const utf16char* src_wstr) {
+    size_t len = std::char_traits<utf16char>::length(src_wstr);
+    return iconvString("UTF-8", "UTF-16LE", reinterpret_cast<const char*>(src_wstr), len * 2);
+}
+
+inline utf16string gbkToUtf16(const char* src_str) {
+    std::string bytes = iconvString("UTF-16LE", "GBK", src_str, strlen(src_str));
+
+    utf16string wstr(bytes.size() / 2, 0);
+    memcpy(&wstr[0], bytes.data(), wstr.size() * 2);
+
+    return wstr;
 }
+#endif
 
 inline std::string convertFrameToTimeString(int frame, int framePerSecond) {
     int totalSeconds = frame / framePerSecond;
@@ -0,0 +1,584 @@
+#ifndef RA2OB_SRC_VALUESEARCH_HPP_
+#define RA2OB_SRC_VALUESEARCH_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./Constants.hpp"
+#include "./PathPlan.hpp"
+#include "./Process.hpp"
+#include "./Reader.hpp"
+#include "./Scanner.hpp"
+#include "./Utils.hpp"
+
+namespace Ra2ob {
+
+enum class SearchOp { Equal, Changed, Unchanged, Increased, Decreased, ChangedBy };
+
+/**
+ * Finds where the game keeps a value, for adding it to panel_offsets.json.
+ *
+ * snapshot() copies all writable memory and makes every aligned slot a candidate. Each
+ * filter() takes a new snapshot and keeps the candidates whose value passes the test,
+ * against the operand or against their value in the snapshot before. Candidates are a
+ * bitmap, one bit per slot; 4-byte values are tested 64 slots at a time with AVX2 or
+ * SSE2. Only pages that still have candidates are read again.
+ */
+class ValueSearch {
+public:
+    explicit ValueSearch(FieldType type = FieldType::Int, int size = 4);
+
+    bool snapshot(Reader r);
+    size_t filter(Reader r, SearchOp op, double operand = 0);
+    void clear();
+
+    size_t count() const;
+    size_t bytes() const;
+    std::vector<uint32_t> results(size_t limit = SEARCHMAXPRINT) const;
+    json getValue(uint32_t addr) const;
+    json toConfig(const std::array<uint32_t, MAXPLAYER>& playerBases,
+                  size_t limit = SEARCHMAXPRINT) const;
+
+    static bool parseOp(const std::string& str, SearchOp* op);
+
+private:
+    struct Region {
+        uint32_t base;
+        std::vector<uint8_t> prev;  // Newest snapshot.
+        std::vector<uint8_t> cur;
+        std::vector<uint64_t> bits;
+        size_t count;
+    };
+
+    enum class Compare { EqBits, NeBits, GtInt, GtFloat, NearFloat };
+
+    // A filter as one compare per slot: cur against (fromPrev ? prev : 0) + operand.
+    struct Kernel {
+        Compare compare;
+        bool fromPrev;
+        bool swap;         // The other way around, for Decreased.
+        uint64_t operand;  // Raw bits, for the integer compares.
+        double value;      // For the float compares.
+        uint64_t bias;     // Sign bit of an unsigned type, so it compares as signed.
+    };
+
+    Kernel compile(SearchOp op, double operand) const;
+    bool refresh(Reader r, Region* region);
+    uint64_t matchWord(const uint8_t* cur, const uint8_t* prev, uint64_t bits,
+                       const Kernel& k) const;
+    bool matchSlot(const uint8_t* cur, const uint8_t* prev, const Kernel& k) const;
+    uint64_t raw(const uint8_t* at) const;
+    double real(const uint8_t* at) const;
+
+    static uint64_t matchSse2(const uint8_t* cur, const uint8_t* prev, const Kernel& k);
+    static uint64_t matchAvx2(const uint8_t* cur, const uint8_t* prev, const Kernel& k);
+
+    FieldType m_type;
+    int m_size;
+    std::vector<Region> m_regions;
+    std::vector<tagReadRequest> m_batch;
+};
+
+/**
+ * Source Code
+ */
+
+inline ValueSearch::ValueSearch(FieldType type, int size) : m_type(type), m_size(size) {}
+
+/**
+ * Start over from a copy of every writable region, all slots candidates.
+ */
+inline bool ValueSearch::snapshot(Reader r) {
+    if (!PathPlan::validSize(m_type, m_size)) {
+        std::cerr << "Invalid value size " << m_size << "\n";
+        clear();
+        return false;
+    }
+
+    // Faulting in fresh buffers costs more than reading into them, keep those that fit.
+    std::map<std::pair<uint32_t, size_t>, Region> spare;
+    for (auto& region : m_regions) {
+        spare[std::make_pair(region.base, region.prev.size())] = std::move(region);
+    }
+
+    m_regions.clear();
+
+    for (auto& mr : writableRegions(r.getHandle())) {
+        auto it = spare.find(std::make_pair(mr.base, static_cast<size_t>(mr.size)));
+
+        if (it != spare.end()) {
+            m_regions.push_back(std::move(it->second));
+        } else {
+            m_regions.push_back(Region{mr.base, std::vector<uint8_t>(mr.size), {}, {}, 0});
+        }
+    }
+
+    m_batch.clear();
+    for (auto& region : m_regions) {
+        m_batch.push_back(tagReadRequest{region.base, region.prev.data(),
+                                         static_cast<uint32_t>(region.prev.size()), false});
+    }
+
+    r.readBatch(m_batch.data(), m_batch.size());
+
+    for (size_t i = 0; i < m_regions.size(); i++) {
+        Region& region = m_regions[i];
+        size_t slots   = m_batch[i].ok ? region.prev.size() / m_size : 0;
+
+        region.bits.assign((slots + 63) / 64, ~0ull);
+        region.count = slots;
+
+        if (slots % 64 != 0) {
+            region.bits.back() = (1ull << (slots % 64)) - 1;
+        }
+    }
+
+    return count() != 0;
+}
+
+/**
+ * Take a new snapshot and keep the candidates that pass, the number left.
+ */
+inline size_t ValueSearch::filter(Reader r, SearchOp op, double operand) {
+    Kernel k  = compile(op, operand);
+    bool simd = m_size == 4 && PatternScanner::level() != ScanLevel::Scalar;
+    bool avx2 = PatternScanner::level() == ScanLevel::Avx2;
+
+    size_t wordBytes = 64 * static_cast<size_t>(m_size);
+
+    for (auto& region : m_regions) {
+        if (region.count == 0 || !refresh(r, &region)) {
+            continue;
+        }
+
+        region.count = 0;
+
+        for (size_t w = 0; w < region.bits.size(); w++) {
+            uint64_t& bits = region.bits[w];
+
+            if (bits == 0) {
+                continue;
+            }
+
+            const uint8_t* cur  = region.cur.data() + w * wordBytes;
+            const uint8_t* prev = region.prev.data() + w * wordBytes;
+            bool fullWord       = (w + 1) * wordBytes <= region.cur.size();
+
+            if (simd && fullWord) {
+                bits &= avx2 ? matchAvx2(cur, prev, k) : matchSse2(cur, prev, k);
+            } else {
+                bits = matchWord(cur, prev, bits, k);
+            }
+
+            region.count += std::bitset<64>(bits).count();
+        }
+
+        std::swap(region.prev, region.cur);
+    }
+
+    return count();
+}
+
+inline void ValueSearch::clear() { m_regions.clear(); }
+
+inline size_t ValueSearch::count() const {
+    size_t ret = 0;
+
+    for (auto& region : m_regions) {
+        ret += region.count;
+    }
+
+    return ret;
+}
+
+/**
+ * Memory the snapshots cover.
+ */
+inline size_t ValueSearch::bytes() const {
+    size_t ret = 0;
+
+    for (auto& region : m_regions) {
+        ret += region.prev.size();
+    }
+
+    return ret;
+}
+
+inline std::vector<uint32_t> ValueSearch::results(size_t limit) const {
+    std::vector<uint32_t> ret;
+
+    for (auto& region : m_regions) {
+        for (size_t w = 0; w < region.bits.size(); w++) {
+            for (uint64_t bits = region.bits[w]; bits != 0; bits &= bits - 1) {
+                if (ret.size() == limit) {
+                    return ret;
+                }
+
+                size_t slot = w * 64 + (std::bitset<64>((bits & (0 - bits)) - 1).count());
+                ret.push_back(region.base + static_cast<uint32_t>(slot * m_size));
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * The value at an address in the newest snapshot of it, null outside the snapshots.
+ */
+inline json ValueSearch::getValue(uint32_t addr) const {
+    for (auto& region : m_regions) {
+        if (addr < region.base || addr - region.base + m_size > region.prev.size()) {
+            continue;
+        }
+
+        const uint8_t* at = region.prev.data() + (addr - region.base);
+        int shift         = 64 - m_size * 8;
+
+        switch (m_type) {
+            case FieldType::Int:
+                return static_cast<int64_t>(raw(at) << shift) >> shift;
+            case FieldType::Bool:
+                return raw(at) != 0;
+            case FieldType::Float:
+                return real(at);
+            default:
+                return raw(at);
+        }
+    }
+
+    return nullptr;
+}
+
+/**
+ * The first candidates as panel_offsets.json path entries where they lie within a player,
+ * with the player and value for reference. Candidates elsewhere only get an address.
+ */
+inline json ValueSearch::toConfig(const std::array<uint32_t, MAXPLAYER>& playerBases,
+                                  size_t limit) const {
+    json ret = json::array();
+
+    for (uint32_t addr : results(limit)) {
+        int player      = -1;
+        uint32_t offset = 0;
+
+        for (int i = 0; i < MAXPLAYER; i++) {
+            uint32_t base = playerBases[i];
+
+            if (base != 0 && addr >= base && addr - base < SEARCHPLAYERSPAN &&
+                (player < 0 || addr - base < offset)) {
+                player = i;
+                offset = addr - base;
+            }
+        }
+
+        std::ostringstream hex;
+        hex << "0x" << std::hex << (player < 0 ? addr : offset);
+
+        json entry;
+
+        if (player < 0) {
+            entry["Name"]    = "Global " + hex.str();
+            entry["Address"] = hex.str();
+        } else {
+            entry["Name"]   = "Field " + hex.str();
+            entry["Path"]   = {hex.str()};
+            entry["Player"] = player;
+        }
+
+        entry["Type"]  = PathPlan::fieldTypeName(m_type);
+        entry["Size"]  = m_size;
+        entry["Value"] = getValue(addr);
+
+        ret.push_back(entry);
+    }
+
+    return ret;
+}
+
+/**
+ * Operators as typed in search mode: "=" value, "!" changed, "~" unchanged, "+" increased,
+ * "-" decreased, "d" changed by.
+ */
+inline bool ValueSearch::parseOp(const std::string& str, SearchOp* op) {
+    static const std::map<std::string, SearchOp> ops = {
+        {"=", SearchOp::Equal},     {"!", SearchOp::Changed},   {"~", SearchOp::Unchanged},
+        {"+", SearchOp::Increased}, {"-", SearchOp::Decreased}, {"d", SearchOp::ChangedBy},
+    };
+
+    auto it = ops.find(str);
+    if (it == ops.end()) {
+        return false;
+    }
+
+    *op = it->second;
+    return true;
+}
+
+inline ValueSearch::Kernel ValueSearch::compile(SearchOp op, double operand) const {
+    bool isFloat  = m_type == FieldType::Float;
+    uint64_t mask = m_size == 8 ? ~0ull : (1ull << (m_size * 8)) - 1;
+    uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(operand)) & mask;
+    uint64_t bias = m_type == FieldType::Uint ? 1ull << (m_size * 8 - 1) : 0;
+
+    switch (op) {
+        case SearchOp::Equal:
+            return isFloat ? Kernel{Compare::NearFloat, false, false, 0, operand, 0}
+                           : Kernel{Compare::EqBits, false, false, bits, 0, 0};
+        case SearchOp::Changed:
+            return Kernel{Compare::NeBits, true, false, 0, 0, 0};
+        case SearchOp::Unchanged:
+            return Kernel{Compare::EqBits, true, false, 0, 0, 0};
+        case SearchOp::Increased:
+        case SearchOp::Decreased: {
+            bool swap = op == SearchOp::Decreased;
+            return isFloat ? Kernel{Compare::GtFloat, true, swap, 0, 0, 0}
+                           : Kernel{Compare::GtInt, true, swap, 0, 0, bias};
+        }
+        default:
+            return isFloat ? Kernel{Compare::NearFloat, true, false, 0, operand, 0}
+                           : Kernel{Compare::EqBits, true, false, bits, 0, 0};
+    }
+}
+
+/**
+ * Read the pages of a region that still have candidates into cur. Candidates on pages that
+ * can no longer be read are dropped.
+ */
+inline bool ValueSearch::refresh(Reader r, Region* region) {
+    size_t pageWords = SEARCHPAGESIZE / (64 * m_size);
+    size_t pages     = region->prev.size() / SEARCHPAGESIZE;
+
+    region->cur.resize(region->prev.size());
+    m_batch.clear();
+
+    for (size_t p = 0; p < pages; p++) {
+        auto first = region->bits.begin() + p * pageWords;
+
+        if (std::all_of(first, first + pageWords, [](uint64_t w) { return w == 0; })) {
+            continue;
+        }
+
+        uint32_t offset = static_cast<uint32_t>(p * SEARCHPAGESIZE);
+
+        // Runs of pages as one read.
+        if (!m_batch.empty() &&
+            m_batch.back().addr + m_batch.back().size == region->base + offset) {
+            m_batch.back().size += SEARCHPAGESIZE;
+        } else {
+            m_batch.push_back(tagReadRequest{region->base + offset, region->cur.data() + offset,
+                                             SEARCHPAGESIZE, false});
+        }
+    }
+
+    r.readBatch(m_batch.data(), m_batch.size());
+
+    bool ret = false;
+
+    for (auto& req : m_batch) {
+        if (req.ok) {
+            ret = true;
+            continue;
+        }
+
+        size_t first = (req.addr - region->base) / (64 * m_size);
+        size_t last  = first + req.size / (64 * m_size);
+
+        std::fill(region->bits.begin() + first, region->bits.begin() + last, 0);
+    }
+
+    if (!ret) {
+        region->count = 0;
+    }
+
+    return ret;
+}
+
+inline uint64_t ValueSearch::matchWord(const uint8_t* cur, const uint8_t* prev, uint64_t bits,
+                                       const Kernel& k) const {
+    uint64_t ret = bits;
+
+    for (; bits != 0; bits &= bits - 1) {
+        uint64_t low = bits & (0 - bits);
+        size_t slot  = std::bitset<64>(low - 1).count();
+
+        if (!matchSlot(cur + slot * m_size, prev + slot * m_size, k)) {
+            ret &= ~low;
+        }
+    }
+
+    return ret;
+}
+
+inline bool ValueSearch::matchSlot(const uint8_t* cur, const uint8_t* prev, const Kernel& k) const {
+    int bitCount  = m_size * 8;
+    uint64_t mask = m_size == 8 ? ~0ull : (1ull << bitCount) - 1;
+
+    switch (k.compare) {
+        case Compare::EqBits:
+            return raw(cur) == (((k.fromPrev ? raw(prev) : 0) + k.operand) & mask);
+        case Compare::NeBits:
+            return raw(cur) != raw(prev);
+        case Compare::GtInt: {
+            int shift = 64 - bitCount;
+            int64_t x = static_cast<int64_t>((raw(cur) ^ k.bias) << shift) >> shift;
+            int64_t y = static_cast<int64_t>((raw(prev) ^ k.bias) << shift) >> shift;
+            return k.swap ? y > x : x > y;
+        }
+        case Compare::GtFloat:
+            return k.swap ? real(prev) > real(cur) : real(cur) > real(prev);
+        default:
+            if (m_size == 4) {
+                float b = (k.fromPrev ? static_cast<float>(real(prev)) : 0.0f) +
+                          static_cast<float>(k.value);
+                return std::fabs(static_cast<float>(real(cur)) - b) <=
+                       static_cast<float>(SEARCHFLOATEPS);
+            }
+            return std::fabs(real(cur) - ((k.fromPrev ? real(prev) : 0.0) + k.value)) <=
+                   SEARCHFLOATEPS;
+    }
+}
+
+inline uint64_t ValueSearch::raw(const uint8_t* at) const {
+    uint64_t ret = 0;
+    std::memcpy(&ret, at, m_size);
+    return ret;
+}
+
+inline double ValueSearch::real(const uint8_t* at) const {
+    if (m_size == 4) {
+        float v;
+        std::memcpy(&v, at, 4);
+        return v;
+    }
+
+    double v;
+    std::memcpy(&v, at, 8);
+    return v;
+}
+
+#ifdef RA2OB_SCANNER_X86
+/**
+ * 64 4-byte slots, 4 per compare.
+ */
+RA2OB_TARGET("sse2")
+inline uint64_t ValueSearch::matchSse2(const uint8_t* cur, const uint8_t* prev, const Kernel& k) {
+    const __m128i zero    = _mm_setzero_si128();
+    const __m128i ones    = _mm_set1_epi32(-1);
+    const __m128i operand = _mm_set1_epi32(static_cast<int>(k.operand));
+    const __m128i bias    = _mm_set1_epi32(static_cast<int>(k.bias));
+    const __m128 value    = _mm_set1_ps(static_cast<float>(k.value));
+    const __m128 eps      = _mm_set1_ps(static_cast<float>(SEARCHFLOATEPS));
+    const __m128 absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    uint64_t ret          = 0;
+
+    for (int i = 0; i < 16; i++) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur + i * 16));
+        __m128i p =
+            k.fromPrev ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i * 16)) : zero;
+        __m128 m;
+
+        switch (k.compare) {
+            case Compare::EqBits:
+                m = _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_add_epi32(p, operand)));
+                break;
+            case Compare::NeBits:
+                m = _mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(a, p), ones));
+                break;
+            case Compare::GtInt: {
+                __m128i x = _mm_xor_si128(a, bias);
+                __m128i y = _mm_xor_si128(p, bias);
+                m = _mm_castsi128_ps(k.swap ? _mm_cmpgt_epi32(y, x) : _mm_cmpgt_epi32(x, y));
+                break;
+            }
+            case Compare::GtFloat: {
+                __m128 x = _mm_castsi128_ps(a);
+                __m128 y = _mm_castsi128_ps(p);
+                m        = k.swap ? _mm_cmpgt_ps(y, x) : _mm_cmpgt_ps(x, y);
+                break;
+            }
+            default: {
+                __m128 b = _mm_add_ps(_mm_castsi128_ps(p), value);
+                __m128 d = _mm_and_ps(_mm_sub_ps(_mm_castsi128_ps(a), b), absMask);
+                m        = _mm_cmple_ps(d, eps);
+            }
+        }
+
+        ret |= static_cast<uint64_t>(_mm_movemask_ps(m)) << (i * 4);
+    }
+
+    return ret;
+}
+
+/**
+ * 64 4-byte slots, 8 per compare.
+ */
+RA2OB_TARGET("avx2")
+inline uint64_t ValueSearch::matchAvx2(const uint8_t* cur, const uint8_t* prev, const Kernel& k) {
+    const __m256i zero    = _mm256_setzero_si256();
+    const __m256i ones    = _mm256_set1_epi32(-1);
+    const __m256i operand = _mm256_set1_epi32(static_cast<int>(k.operand));
+    const __m256i bias    = _mm256_set1_epi32(static_cast<int>(k.bias));
+    const __m256 value    = _mm256_set1_ps(static_cast<float>(k.value));
+    const __m256 eps      = _mm256_set1_ps(static_cast<float>(SEARCHFLOATEPS));
+    const __m256 absMask  = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    uint64_t ret          = 0;
+
+    for (int i = 0; i < 8; i++) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur + i * 32));
+        __m256i p = k.fromPrev
+                        ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + i * 32))
+                        : zero;
+        __m256 m;
+
+        switch (k.compare) {
+            case Compare::EqBits:
+                m = _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, _mm256_add_epi32(p, operand)));
+                break;
+            case Compare::NeBits:
+                m = _mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(a, p), ones));
+                break;
+            case Compare::GtInt: {
+                __m256i x = _mm256_xor_si256(a, bias);
+                __m256i y = _mm256_xor_si256(p, bias);
+                m = _mm256_castsi256_ps(k.swap ? _mm256_cmpgt_epi32(y, x)
+                                               : _mm256_cmpgt_epi32(x, y));
+                break;
+            }
+            case Compare::GtFloat: {
+                __m256 x = _mm256_castsi256_ps(a);
+                __m256 y = _mm256_castsi256_ps(p);
+                m = k.swap ? _mm256_cmp_ps(y, x, _CMP_GT_OQ) : _mm256_cmp_ps(x, y, _CMP_GT_OQ);
+                break;
+            }
+            default: {
+                __m256 b = _mm256_add_ps(_mm256_castsi256_ps(p), value);
+                __m256 d = _mm256_and_ps(_mm256_sub_ps(_mm256_castsi256_ps(a), b), absMask);
+                m        = _mm256_cmp_ps(d, eps, _CMP_LE_OQ);
+            }
+        }
+
+        ret |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_ps(m))) << (i * 8);
+    }
+
+    return ret;
+}
+#else
+inline uint64_t ValueSearch::matchSse2(const uint8_t*, const uint8_t*, const Kernel&) { return 0; }
+
+inline uint64_t ValueSearch::matchAvx2(const uint8_t*, const uint8_t*, const Kernel&) { return 0; }
+#endif  // RA2OB_SCANNER_X86
+
+}  // end of namespace Ra2ob
+
+#endif  // RA2OB_SRC_VALUESEARCH_HPP_
@@ -62,6 +62,9 @@ inline json Viewer::exportJson(tagGameInfo gi, int mode) {
     j["game"]["version"]      = gi.gameVersion == "Yr" ? "Yr" : "Ra2";
     j["game"]["mapName"]      = gi.mapName;
     j["game"]["currentFrame"] = gi.currentFrame;
+    j["game"]["captured"]     = gi.stamp.captured;  // Echo both back to report delivery.
+    j["game"]["published"]    = gi.stamp.published;
+    j["game"]["consistent"]   = gi.stamp.frame == gi.stamp.frameEnd;  // One frame's data.
 
     for (auto& p : gi.players) {
         json jp;
@@ -77,6 +80,7 @@ inline json Viewer::exportJson(tagGameInfo gi, int mode) {
         jp["panel"]["powerOutput"] = p.panel.powerOutput;
         jp["panel"]["color"]       = "#" + p.panel.color;
         jp["panel"]["country"]     = p.panel.country;
+        jp["panel"]["fields"]      = p.panel.fields;
 
         jp["status"]["infantrySelfHeal"] = p.status.infantrySelfHeal;
         jp["status"]["unitSelfHeal"]     = p.status.unitSelfHeal;
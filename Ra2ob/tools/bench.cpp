@@ -0,0 +1,357 @@
+#define RA2OB_COUNT_ALLOCATIONS  // Allocations per tick, see AllocCounter.
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "Ra2ob/Ra2ob"
+
+/**
+ * Benchmark the fetch and export pipeline against an emulated game, see GameEmulator.
+ *
+ * ra2ob_bench [--out results.json] [--compare base.json] [--time ms] [--filter name]
+ *
+ * Every benchmark runs for 1, 2, 4 and 8 players and several unit type counts, and reports
+ * ns, reads, bytes read and heap allocations per tick. Pass the json of an earlier
+ * commit to --compare to see what changed.
+ *
+ * reader.* time Reader against the emulator, process.* the same reads natively, from a
+ * Reader attached to this process and memory it mapped at a 32-bit address.
+ */
+
+using Ra2ob::Game;
+using Ra2ob::GameEmulator;
+using Ra2ob::Reader;
+
+/**
+ * An emulated game of players with units types in all, each player owning some of most
+ * types, and Game attached to it with its catalog discovered.
+ */
+void setupGame(GameEmulator& emu, Game& g, int players, int units) {
+    static const char* countries[] = {"Americans", "Russians", "Confederation", "YuriCountry"};
+
+    std::vector<Ra2ob::tagEmuPlayer> houses(players);
+    int perKind = units / Ra2ob::CATALOGKINDS;
+
+    for (int i = 0; i < players; i++) {
+        houses[i].name    = "Player " + std::to_string(i + 1);
+        houses[i].country = countries[i % 4];
+        houses[i].color   = 0xe0d838 + i;
+        houses[i].team    = i;
+    }
+
+    emu.setup(houses, perKind);
+
+    for (int i = 0; i < players; i++) {
+        Ra2ob::tagEmuEvent e;
+
+        e.player = i;
+        e.action = Ra2ob::EmuAction::Build;
+
+        for (e.kind = 0; e.kind < Ra2ob::CATALOGKINDS; e.kind++) {
+            for (e.index = 0; e.index < perKind; e.index++) {
+                e.count = (e.index + i) % 3 == 0 ? 0 : e.index % 7 + 1;
+                emu.schedule(e);
+            }
+        }
+
+        e.action = Ra2ob::EmuAction::Charge;
+        e.index  = 0;
+        emu.schedule(e);
+    }
+
+    g.attachSource(&emu);
+    g._gameInfo.valid = true;
+    g.initAddrs();
+    g.tick();
+}
+
+constexpr uint32_t SELFBASE = 0x20000000;
+constexpr uint32_t SELFSIZE = 0x10000;
+
+/**
+ * Map SELFSIZE bytes of this process at SELFBASE and return a Reader attached to the process
+ * itself, with no handle if that address is taken.
+ */
+Reader mapSelf() {
+    void* want = reinterpret_cast<void*>(static_cast<uintptr_t>(SELFBASE));
+
+#ifdef _WIN32
+    void* got   = VirtualAlloc(want, SELFSIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    HANDLE self = GetCurrentProcess();
+#else
+    int flags   = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE;
+    void* got   = mmap(want, SELFSIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    HANDLE self = reinterpret_cast<HANDLE>(static_cast<intptr_t>(getpid()));
+#endif
+
+    if (got != want) {
+        std::cerr << "Could not map memory at " << std::hex << SELFBASE << std::dec
+                  << ", skipping process.*\n";
+        return Reader();
+    }
+
+    std::memset(got, 1, SELFSIZE);
+
+    return Reader(self);
+}
+
+/**
+ * The game moves on a frame. Every player keeps a vehicle in production.
+ */
+void step(GameEmulator& emu) {
+    emu.advance();
+
+    if (emu.frame() % (Ra2ob::EMUBUILDSTEPS + 1) != 1) {
+        return;
+    }
+
+    Ra2ob::tagEmuEvent e;
+
+    e.frame  = emu.clock();
+    e.action = Ra2ob::EmuAction::Produce;
+    e.kind   = 2;
+    e.index  = 1;
+
+    for (e.player = 0; e.player < emu.playerCount(); e.player++) {
+        emu.schedule(e);
+    }
+}
+
+/**
+ * Swallows Viewer::print().
+ */
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+struct BenchResult {
+    std::string name;
+    int players;
+    int units;
+    uint64_t iterations;
+    double ns;
+    double reads;
+    double bytes;
+    double allocs;
+};
+
+/**
+ * Run fn until minMs passed, after a few warm-up calls.
+ */
+BenchResult measure(const std::string& name, int players, int units, int minMs,
+                    const std::function<void()>& fn) {
+    for (int i = 0; i < 3; i++) {
+        fn();
+    }
+
+    Ra2ob::AllocCounter allocs;
+    Ra2ob::tagReadStats before = Reader::stats();
+    uint64_t iterations        = 0;
+
+    auto start    = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::milliseconds(minMs);
+
+    {
+        Ra2ob::AllocScope scope(&allocs);
+
+        do {
+            fn();
+            iterations++;
+        } while (std::chrono::steady_clock::now() < deadline);
+    }
+
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+                    .count();
+    Ra2ob::tagReadStats after = Reader::stats();
+
+    BenchResult ret;
+    ret.name       = name;
+    ret.players    = players;
+    ret.units      = units;
+    ret.iterations = iterations;
+    ret.ns         = ns / iterations;
+    ret.reads      = static_cast<double>(after.reads - before.reads) / iterations;
+    ret.bytes      = static_cast<double>(after.bytes - before.bytes) / iterations;
+    ret.allocs     = static_cast<double>(allocs.count()) / iterations;
+
+    return ret;
+}
+
+std::string resultKey(const std::string& name, int players, int units) {
+    return name + "/" + std::to_string(players) + "p/" + std::to_string(units) + "u";
+}
+
+int main(int argc, char* argv[]) {
+    std::string outPath;
+    std::string comparePath;
+    std::string filter;
+    int minMs  = 200;
+    bool usage = false;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            usage = true;
+        } else if (std::strcmp(argv[i], "--out") == 0) {
+            outPath = value;
+        } else if (std::strcmp(argv[i], "--compare") == 0) {
+            comparePath = value;
+        } else if (std::strcmp(argv[i], "--time") == 0) {
+            minMs = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            filter = value;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage) {
+        std::cerr << "Usage: ra2ob_bench [--out results.json] [--compare base.json] "
+                     "[--time ms] [--filter name]\n";
+        return 1;
+    }
+
+    std::map<std::string, double> base;
+
+    if (!comparePath.empty()) {
+        std::ifstream f(comparePath);
+
+        try {
+            json data = json::parse(f);
+
+            for (auto& r : data.at("results")) {
+                base[resultKey(r.at("name"), r.at("players"), r.at("units"))] = r.at("nsPerTick");
+            }
+        } catch (const json::exception& e) {
+            std::cerr << comparePath << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    NullBuffer nullBuffer;
+    std::vector<BenchResult> results;
+    Reader self = mapSelf();
+
+    std::vector<uint32_t> selfBufs(Ra2ob::READBATCHSIZE);
+    std::vector<Ra2ob::tagReadRequest> selfBatch;
+    for (int k = 0; k < Ra2ob::READBATCHSIZE; k++) {
+        selfBatch.push_back({SELFBASE + k * 64, &selfBufs[k], 4, false});
+    }
+
+    const int playerCounts[] = {1, 2, 4, 8};
+    const int unitCounts[]   = {64, 256, 512};
+
+    std::printf("%-16s %7s %5s %12s %9s %10s %9s %9s\n", "benchmark", "players", "units",
+                "ns/tick", "reads", "bytes", "allocs", "vs base");
+
+    for (int players : playerCounts) {
+        for (int units : unitCounts) {
+            GameEmulator emu;
+            Game g;
+            setupGame(emu, g, players, units);
+
+            uint32_t addr = Ra2ob::EMUHEAPBASE;
+            std::vector<uint32_t> batchBufs(Ra2ob::READBATCHSIZE);
+            std::vector<Ra2ob::tagReadRequest> batch;
+            for (int k = 0; k < Ra2ob::READBATCHSIZE; k++) {
+                batch.push_back({addr + k * 64, &batchBufs[k], 4, false});
+            }
+
+            std::vector<std::pair<std::string, std::function<void()>>> benches = {
+                {"reader.getInt", [&] { g.r.getInt(addr); }},
+                {"reader.batch", [&] { g.r.readBatch(batch.data(), batch.size()); }},
+                {"process.getInt", [&] { self.getInt(SELFBASE); }},
+                {"process.batch", [&] { self.readBatch(selfBatch.data(), selfBatch.size()); }},
+                {"refreshInfo",
+                 [&] {
+                     step(emu);
+                     g.refreshInfo();
+                 }},
+                {"refreshSerial",
+                 [&] {
+                     step(emu);
+                     g._serialRefresh = true;
+                     g.refreshInfo();
+                     g._serialRefresh = false;
+                 }},
+                {"structBuild", [&] { g.structBuild(); }},
+                {"toGameInfo", [&] { Ra2ob::toGameInfo(g._snapshot, &g._gameInfo); }},
+                {"tick",
+                 [&] {
+                     step(emu);
+                     g.tick();
+                 }},
+                {"exportJson", [&] { g.viewer.exportJson(g._gameInfo); }},
+                {"print",
+                 [&] {
+                     std::streambuf* old = std::cout.rdbuf(&nullBuffer);
+                     g.viewer.print(g._gameInfo);
+                     std::cout.rdbuf(old);
+                 }},
+            };
+
+            for (auto& b : benches) {
+                if (!filter.empty() && b.first.find(filter) == std::string::npos) {
+                    continue;
+                }
+
+                if (b.first.compare(0, 8, "process.") == 0 && !self.attached()) {
+                    continue;
+                }
+
+                BenchResult res = measure(b.first, players, units, minMs, b.second);
+                results.push_back(res);
+
+                auto it = base.find(resultKey(res.name, players, units));
+                std::string vs =
+                    it == base.end()
+                        ? ""
+                        : std::to_string(static_cast<int>((res.ns / it->second - 1) * 100)) + "%";
+
+                std::printf("%-16s %7d %5d %12.0f %9.1f %10.0f %9.1f %9s\n", res.name.c_str(),
+                            players, units, res.ns, res.reads, res.bytes, res.allocs, vs.c_str());
+            }
+        }
+    }
+
+    if (!outPath.empty()) {
+        json out;
+        out["results"] = json::array();
+
+        for (auto& res : results) {
+            out["results"].push_back({{"name", res.name},
+                                      {"players", res.players},
+                                      {"units", res.units},
+                                      {"iterations", res.iterations},
+                                      {"nsPerTick", res.ns},
+                                      {"readsPerTick", res.reads},
+                                      {"bytesPerTick", res.bytes},
+                                      {"allocsPerTick", res.allocs}});
+        }
+
+        std::ofstream f(outPath);
+        f << out.dump(1) << std::endl;
+
+        if (!f) {
+            std::cerr << "Could not write " << outPath << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
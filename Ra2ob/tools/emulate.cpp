@@ -0,0 +1,277 @@
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "Ra2ob/Ra2ob"
+
+/**
+ * Run Game against a scripted emulated game, checking every tick against the emulator.
+ *
+ * ra2ob_emulate [--script game.json | --players n --frames n --seed n] [--save game.json]
+ *               [--step frames] [--rate ticks] [--quiet 1] [--profile 1]
+ *               [--trace trace.json] [--traceReads 1] [--tear reads] [--retries n]
+ *               [--pages 1] [--readLog reads.rl]
+ *
+ * Without a script a random one of an hour is played, a script plays until its last event
+ * or for frames. Each tick advances the game by step frames (default 30) and ticks as fast
+ * as possible, or rate times a second. Exits non-zero if a tick read anything the emulator
+ * did not hold. --profile prints the time and reads of every stage and how old the data was
+ * when this tool, as the consumer, checked it. --trace writes what the ticks did as a Chrome
+ * trace, with every single read if --traceReads is set.
+ *
+ * --tear moves the game on a frame every that many reads, during ticks too, so captures can
+ * mix frames; --retries sets Game::_captureRetries. Only ticks whose capture held one frame
+ * that is still the emulator's are checked then.
+ *
+ * --pages reads unwritten pages from Game::_pageCache, with the emulator telling which
+ * pages it wrote, instead of everything every tick.
+ *
+ * --readLog writes every read of the ticks to a read log, to replay with ra2ob_replay.
+ */
+
+using Ra2ob::Game;
+using Ra2ob::GameEmulator;
+
+/**
+ * Mismatches between what the tick fetched and the emulator's state.
+ */
+int verify(Game& g, GameEmulator& emu) {
+    int ret = 0;
+
+    if (g._snapshot.currentFrame != emu.frame()) {
+        ret++;
+    }
+
+    for (int p = 0; p < emu.playerCount(); p++) {
+        if (!g._players[p] || g._playerDefeatFlag[p] != emu.isDefeated(p)) {
+            ret++;
+            continue;
+        }
+
+        for (size_t id = 0; id < g._unitPlan.size(); id++) {
+            Ra2ob::Unit& u = g._unitPlan.getUnit(id);
+            int kind       = 0;
+
+            while (kind < Ra2ob::CATALOGKINDS &&
+                   Ra2ob::CATALOGTYPES[kind] != u.getUnitType()) {
+                kind++;
+            }
+
+            int want = emu.getCount(p, kind, u.getOffset() / 4);
+
+            if (static_cast<int>(u.getValueByIndex(p)) != want) {
+                ret++;
+            }
+        }
+    }
+
+    return ret;
+}
+
+int main(int argc, char* argv[]) {
+    std::string scriptPath;
+    std::string savePath;
+    std::string tracePath;
+    std::string readLogPath;
+    int players     = 8;
+    int frames      = -1;
+    int seed        = 1;
+    int step        = 30;
+    int rate        = 0;
+    int tear        = 0;
+    int retries     = Ra2ob::CAPTURERETRIES;
+    bool quiet      = false;
+    bool profile    = false;
+    bool traceReads = false;
+    bool pages      = false;
+    bool usage      = false;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            usage = true;
+        } else if (std::strcmp(argv[i], "--script") == 0) {
+            scriptPath = value;
+        } else if (std::strcmp(argv[i], "--save") == 0) {
+            savePath = value;
+        } else if (std::strcmp(argv[i], "--players") == 0) {
+            players = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--frames") == 0) {
+            frames = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--step") == 0) {
+            step = std::max(1, std::atoi(value));
+        } else if (std::strcmp(argv[i], "--rate") == 0) {
+            rate = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            quiet = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            profile = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--tear") == 0) {
+            tear = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--retries") == 0) {
+            retries = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            tracePath = value;
+        } else if (std::strcmp(argv[i], "--traceReads") == 0) {
+            traceReads = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--pages") == 0) {
+            pages = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--readLog") == 0) {
+            readLogPath = value;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage) {
+        std::cerr << "Usage: ra2ob_emulate [--script game.json | --players n --frames n "
+                     "--seed n] [--save game.json] [--step frames] [--rate ticks] "
+                     "[--quiet 1] [--profile 1] [--trace trace.json] [--traceReads 1] "
+                     "[--tear reads] [--retries n] [--pages 1] [--readLog reads.rl]\n";
+        return 1;
+    }
+
+    json script;
+
+    if (scriptPath.empty()) {
+        frames = frames < 0 ? 60 * 60 * Ra2ob::GAMESPEED : frames;
+        script = GameEmulator::randomScript(players, frames, seed);
+    } else {
+        std::ifstream f(scriptPath);
+
+        try {
+            script = json::parse(f);
+        } catch (const json::exception& e) {
+            std::cerr << scriptPath << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (!savePath.empty()) {
+        std::ofstream f(savePath);
+        f << script.dump(1) << std::endl;
+    }
+
+    GameEmulator emu;
+    std::string error;
+
+    if (!emu.loadScript(script, &error)) {
+        std::cerr << "Script: " << error << "\n";
+        return 1;
+    }
+
+    Game g;
+    g.attachSource(&emu);
+    g._gameInfo.valid  = true;
+    g._captureRetries  = retries;
+    g._trackDirtyPages = pages;
+    g.initAddrs();
+    emu.advanceDuringReads(tear);
+
+    if (!readLogPath.empty() && !g.startReadLog(readLogPath)) {
+        return 1;
+    }
+
+    if (!tracePath.empty()) {
+        Ra2ob::Tracer::nameThread("main");
+        Ra2ob::Tracer::start(traceReads);
+    }
+
+    auto interval = std::chrono::microseconds(rate > 0 ? 1000000 / rate : 0);
+    auto start    = std::chrono::steady_clock::now();
+    auto next     = start;
+
+    Ra2ob::tagReadStats reads = Ra2ob::Reader::stats();
+    int64_t tickUs            = 0;
+    int ticks                 = 0;
+    int mismatches            = 0;
+    int unchecked             = 0;
+
+    while (emu.pending() != 0 || emu.clock() < frames) {
+        emu.advance(step);
+
+        auto tickStart = std::chrono::steady_clock::now();
+        g.tick();
+        tickUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - tickStart)
+                      .count();
+        ticks++;
+
+        g._latency.delivered(g._gameInfo.stamp);
+
+        const Ra2ob::tagStamp& stamp = g._gameInfo.stamp;
+        bool checkable               = stamp.frame == stamp.frameEnd && stamp.frame == emu.frame();
+
+        int bad = checkable ? verify(g, emu) : 0;
+        mismatches += bad;
+        unchecked += checkable ? 0 : 1;
+
+        if (bad != 0 && !quiet) {
+            std::cerr << "Tick " << ticks << " at frame " << emu.frame() << ": " << bad
+                      << " mismatches.\n";
+        }
+
+        if (rate > 0) {
+            next += interval;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                         .count();
+    Ra2ob::tagReadStats total = Ra2ob::Reader::stats();
+    uint64_t count            = total.reads - reads.reads;
+    uint64_t bytes            = total.bytes - reads.bytes;
+
+    std::cout << ticks << " ticks over " << emu.frame() << " frames in " << seconds << " s, "
+              << ticks / seconds << " ticks/s, " << tickUs / std::max(ticks, 1) << " us, "
+              << count / std::max(ticks, 1) << " reads and " << bytes / std::max(ticks, 1)
+              << " bytes per tick, " << mismatches << " mismatches, " << unchecked
+              << " unchecked.\n";
+
+    Ra2ob::tagCaptureStats captures = g.captureStats();
+
+    std::cout << captures.rate * 100 << "% of " << captures.captures
+              << " captures within one frame, " << captures.retried << " retried, "
+              << captures.torn << " torn.\n";
+
+    if (pages) {
+        Ra2ob::tagPageCacheStats cache = g._pageCache.stats();
+        uint64_t synced                = std::max<uint64_t>(cache.clean + cache.loaded, 1);
+
+        std::cout << cache.pages << " pages cached, " << cache.clean * 100 / synced
+                  << "% of them reused unread over " << cache.syncs << " syncs.\n";
+    }
+
+    if (g._readLog != nullptr) {
+        Ra2ob::tagReadLogStats log = g._readLog->stats();
+        uint64_t logged            = std::max<uint64_t>(log.reads, 1);
+
+        g._readLog->close();
+        std::cout << log.reads << " reads in " << readLogPath << ", " << log.same * 100 / logged
+                  << "% unchanged, " << log.bytes / std::max(ticks, 1) << " bytes per tick.\n";
+    }
+
+    if (!tracePath.empty()) {
+        Ra2ob::Tracer::stop();
+        if (!Ra2ob::Tracer::save(tracePath)) {
+            return 1;
+        }
+        std::cout << "Trace written to " << tracePath << ", " << Ra2ob::Tracer::dropped()
+                  << " events dropped.\n";
+    }
+
+    if (profile) {
+        Ra2ob::printProfile(g.profile());
+        Ra2ob::printLatency(g._latency);
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
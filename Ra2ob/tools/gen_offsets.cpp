@@ -0,0 +1,175 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "Ra2ob/src/Constants.hpp"
+#include "Ra2ob/src/third_party/json.hpp"
+
+using json = nlohmann::json;
+
+/**
+ * Compile the offset json files into a header of constexpr tables, run by the build.
+ *
+ * ra2ob_gen_offsets <unit_offsets.json> <panel_offsets.json> <OffsetTables.hpp>
+ *
+ * Entries come out in the order Game::loadUnitsFromJson() would load them.
+ */
+
+std::string quote(const std::string& s) {
+    std::string ret = "\"";
+
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            ret += '\\';
+        }
+        ret += c;
+    }
+
+    return ret + "\"";
+}
+
+std::string unitType(const std::string& key) {
+    if (key == "Building" || key == "Tank" || key == "Infantry" || key == "Aircraft") {
+        return "UnitType::" + key;
+    }
+    return "UnitType::Unknown";
+}
+
+std::string fieldType(const json& entry) {
+    std::string type = entry.contains("Type") ? entry["Type"].get<std::string>() : "Int";
+
+    if (type != "Int" && type != "Uint" && type != "Bool" && type != "Float") {
+        throw std::invalid_argument("unknown type " + type);
+    }
+    return type;
+}
+
+std::string pathStep(const json& step) {
+    std::ostringstream out;
+
+    out << "0x" << std::hex
+        << (step.is_string() ? std::stoul(step.get<std::string>(), nullptr, 16)
+                             : step.get<uint32_t>());
+    return out.str();
+}
+
+bool readJson(const std::string& filePath, json* data) {
+    std::ifstream f(filePath);
+
+    try {
+        *data = json::parse(f);
+    } catch (const json::parse_error& e) {
+        std::cerr << filePath << " parse error: " << e.what() << "\n";
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 4) {
+        std::cerr << "Usage: ra2ob_gen_offsets <unit_offsets.json> <panel_offsets.json> "
+                     "<OffsetTables.hpp>\n";
+        return 1;
+    }
+
+    json units;
+    json numerics;
+
+    if (!readJson(argv[1], &units) || !readJson(argv[2], &numerics)) {
+        return 1;
+    }
+
+    std::ostringstream out;
+
+    out << "// Generated by ra2ob_gen_offsets from config/, do not edit.\n\n"
+        << "#ifndef RA2OB_OFFSETTABLES_HPP_\n"
+        << "#define RA2OB_OFFSETTABLES_HPP_\n\n"
+        << "#include <array>\n\n"
+        << "#include \"Ra2ob/src/Constants.hpp\"\n\n"
+        << "namespace Ra2ob {\n\n";
+
+    try {
+        std::ostringstream paths;
+        int pathCount = 0;
+
+        out << "constexpr tagNumericEntry NUMERICTABLE[] = {\n";
+
+        for (auto& it : numerics) {
+            if (it.contains("Path")) {
+                const json& path = it["Path"];
+                std::string type = fieldType(it);
+                int size         = type == "Bool" ? 1 : 4;
+
+                if (it.contains("Size")) {
+                    size = it["Size"];
+                }
+
+                if (path.empty() || path.size() > Ra2ob::PATHMAXDEPTH) {
+                    throw std::invalid_argument("path of " + it["Name"].get<std::string>());
+                }
+
+                paths << "    tagPathEntry{" << quote(it["Name"]) << ", {";
+                for (size_t i = 0; i < path.size(); i++) {
+                    paths << (i == 0 ? "" : ", ") << pathStep(path[i]);
+                }
+                paths << "}, " << path.size() << ", FieldType::" << type << ", " << size
+                      << "},\n";
+
+                pathCount++;
+                continue;
+            }
+
+            std::string offset = it["Offset"];
+
+            out << "    {" << quote(it["Name"]) << ", 0x" << std::hex
+                << std::stoul(offset, nullptr, 16) << std::dec << "},\n";
+        }
+
+        out << "};\n\n";
+
+        // A std::array, since there may be no paths at all.
+        out << "constexpr std::array<tagPathEntry, " << pathCount << "> PATHTABLE = {{\n"
+            << paths.str() << "}};\n\n";
+
+        out << "constexpr tagUnitEntry UNITTABLE[] = {\n";
+
+        for (auto& ut : units.items()) {
+            for (auto& u : ut.value()) {
+                if (u.empty()) {
+                    continue;
+                }
+
+                std::string offset  = u["Offset"];
+                bool show           = !(u.contains("Show") && u["Show"] == 0);
+                int index           = u.contains("Index") ? u["Index"].get<int>() : 99;
+                std::string invalid = u.contains("Invalid") ? u["Invalid"].get<std::string>() : "";
+
+                out << "    {" << quote(u["Name"]) << ", 0x" << std::hex
+                    << std::stoul(offset, nullptr, 16) << std::dec << ", " << unitType(ut.key())
+                    << ", " << index << ", " << (show ? "true" : "false") << ", "
+                    << quote(invalid) << "},\n";
+            }
+        }
+
+        out << "};\n\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid offset entry: " << e.what() << "\n";
+        return 1;
+    }
+
+    out << "}  // end of namespace Ra2ob\n\n"
+        << "#endif  // RA2OB_OFFSETTABLES_HPP_\n";
+
+    std::ofstream f(argv[3], std::ios::binary);
+    f << out.str();
+
+    if (!f) {
+        std::cerr << "Could not write " << argv[3] << "\n";
+        return 1;
+    }
+
+    return 0;
+}
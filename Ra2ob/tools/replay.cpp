@@ -0,0 +1,106 @@
+#include <chrono>  // NOLINT
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "Ra2ob/Ra2ob"
+
+/**
+ * Run Game against a read log as fast as it goes, with no game or Windows needed.
+ *
+ * ra2ob_replay <reads.rl> [--ordered 1] [--serial 1] [--profile 1] [--record match.tl]
+ *
+ * Each tick replays a recorded one, reads of the same address and size within it get what
+ * the recorded ones got. --ordered serves the reads in the order recorded where they come in
+ * it and counts those that did not. --serial runs the refresh stages one after another,
+ * --record writes the ticks to a timeline. Exits non-zero if a tick read anything the log
+ * does not hold.
+ */
+
+using Ra2ob::Game;
+using Ra2ob::ReadReplay;
+
+int main(int argc, char* argv[]) {
+    std::string logPath;
+    std::string recordPath;
+    bool ordered = false;
+    bool serial  = false;
+    bool profile = false;
+    bool usage   = argc < 2;
+
+    for (int i = 2; i < argc; i += 2) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            usage = true;
+        } else if (std::strcmp(argv[i], "--ordered") == 0) {
+            ordered = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--serial") == 0) {
+            serial = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            profile = std::atoi(value) != 0;
+        } else if (std::strcmp(argv[i], "--record") == 0) {
+            recordPath = value;
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage) {
+        std::cerr << "Usage: ra2ob_replay <reads.rl> [--ordered 1] [--serial 1] [--profile 1] "
+                     "[--record match.tl]\n";
+        return 1;
+    }
+
+    logPath = argv[1];
+
+    ReadReplay replay;
+
+    if (!replay.open(logPath, ordered ? Ra2ob::ReplayMode::Ordered : Ra2ob::ReplayMode::Lookup)) {
+        return 1;
+    }
+
+    Game g;
+    g._gameInfo.valid = true;
+    g._serialRefresh  = serial;
+
+    if (!g.attachReplay(&replay)) {
+        if (replay.segments() <= 1) {
+            std::cerr << logPath << " holds no ticks.\n";
+        }
+        return 1;
+    }
+
+    if (!recordPath.empty() && !g.startRecording(recordPath)) {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int ticks  = 0;
+
+    while (!replay.finished()) {
+        g.tick();
+        ticks++;
+    }
+
+    g.stopRecording();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                         .count();
+    Ra2ob::tagReplayStats stats = replay.stats();
+
+    std::cout << ticks << " ticks to frame " << g._snapshot.currentFrame << " in " << seconds
+              << " s, " << seconds * 1e6 / std::max(ticks, 1) << " us per tick, "
+              << stats.served << " reads served, " << stats.missed << " missed";
+    if (ordered) {
+        std::cout << ", " << stats.reordered << " out of order";
+    }
+    std::cout << ".\n";
+
+    if (profile) {
+        Ra2ob::printProfile(g.profile());
+    }
+
+    return stats.missed == 0 ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Ra2ob/src/Timeline.hpp"
+#include "Ra2ob/src/Viewer.hpp"
+
+/**
+ * Dump recorded states from a timeline file.
+ *
+ * ra2ob_seek <timeline> <at> [<to> [<step>]] [--json]
+ *
+ * Positions are frames ("7380") or game time ("12:30"), step defaults to 10 seconds.
+ */
+
+int parsePosition(const std::string& s) {
+    size_t colon = s.find(':');
+
+    if (colon == std::string::npos) {
+        return std::stoi(s);
+    }
+
+    int minutes = std::stoi(s.substr(0, colon));
+    int seconds = std::stoi(s.substr(colon + 1));
+
+    return (minutes * 60 + seconds) * Ra2ob::GAMESPEED;
+}
+
+void dump(Ra2ob::Timeline& tl, Ra2ob::Viewer& viewer, int frame, bool asJson) {
+    Ra2ob::tagGameInfo gi;
+
+    if (!tl.seek(frame, &gi)) {
+        std::cerr << "No state recorded at frame " << frame << ".\n";
+        return;
+    }
+
+    if (asJson) {
+        json j = gi;
+        std::cout << j.dump() << std::endl;
+        return;
+    }
+
+    std::cout << "[Frame " << frame << " / "
+              << Ra2ob::convertFrameToTimeString(frame, Ra2ob::GAMESPEED) << "]" << std::endl;
+    viewer.print(gi, 0);
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool asJson = false;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            asJson = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() < 2) {
+        std::cerr << "Usage: ra2ob_seek <timeline> <at> [<to> [<step>]] [--json]\n";
+        return 1;
+    }
+
+    Ra2ob::Timeline tl(args[0]);
+    if (!tl.isOpen()) {
+        return 1;
+    }
+
+    int from = 0;
+    int to   = 0;
+    int step = 10 * Ra2ob::GAMESPEED;
+
+    try {
+        from = parsePosition(args[1]);
+        to   = args.size() > 2 ? parsePosition(args[2]) : from;
+        step = args.size() > 3 ? parsePosition(args[3]) : step;
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid position.\n";
+        return 1;
+    }
+
+    if (step <= 0) {
+        step = 1;
+    }
+
+    Ra2ob::Viewer viewer;
+
+    for (int frame = from; frame <= to; frame += step) {
+        dump(tl, viewer, frame, asJson);
+    }
+
+    return 0;
+}
@@ -0,0 +1,366 @@
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Ra2ob/Ra2ob"
+
+/**
+ * Check the SSE2 and AVX2 scanners against the scalar ones, through PatternScanner::setLevel().
+ *
+ * ra2ob_simd [--rounds n] [--seed n]
+ *
+ * PatternScanner::find() runs on random buffers of up to a few words with random patterns,
+ * wildcards at their edges and matches planted at the buffer's tail. ValueSearch::filter()
+ * runs every SearchOp on Int, Uint and Float slots of 1, 2, 4 and 8 bytes, over memory this
+ * process mapped at a 32-bit address and changed between filters. Every level the CPU has
+ * must find what Scalar finds. Exits non-zero if one does not.
+ */
+
+using Ra2ob::PatternScanner;
+using Ra2ob::Reader;
+using Ra2ob::ScanLevel;
+using Ra2ob::SearchOp;
+using Ra2ob::ValueSearch;
+
+constexpr uint32_t SELFBASE = 0x20000000;
+constexpr uint32_t SELFSIZE = 4 * Ra2ob::SEARCHPAGESIZE;
+constexpr int SEARCHSTEPS   = 8;  // Filters per search round.
+constexpr int MAXREPORTS    = 10;
+
+std::vector<ScanLevel> g_levels;  // Scalar first, then each the CPU has.
+int g_mismatches = 0;
+
+/**
+ * Map SELFSIZE bytes of this process at SELFBASE and return a Reader attached to the process
+ * itself, with no handle if that address is taken.
+ */
+Reader mapSelf(uint8_t** mem) {
+    void* want = reinterpret_cast<void*>(static_cast<uintptr_t>(SELFBASE));
+
+#ifdef _WIN32
+    void* got   = VirtualAlloc(want, SELFSIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    HANDLE self = GetCurrentProcess();
+#else
+    int flags   = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE | MAP_NORESERVE;
+    void* got   = mmap(want, SELFSIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+    HANDLE self = reinterpret_cast<HANDLE>(static_cast<intptr_t>(getpid()));
+#endif
+
+    if (got != want) {
+        std::cerr << "Could not map memory at " << std::hex << SELFBASE << std::dec
+                  << ", skipping ValueSearch.\n";
+        return Reader();
+    }
+
+    *mem = static_cast<uint8_t*>(got);
+
+    return Reader(self);
+}
+
+const char* levelName(ScanLevel level) {
+    switch (level) {
+        case ScanLevel::Avx2:
+            return "Avx2";
+        case ScanLevel::Sse2:
+            return "Sse2";
+        default:
+            return "Scalar";
+    }
+}
+
+const char* opName(SearchOp op) {
+    static const char* names[] = {"Equal", "Changed", "Unchanged", "Increased", "Decreased",
+                                  "ChangedBy"};
+    return names[static_cast<int>(op)];
+}
+
+void mismatch(const std::string& what) {
+    if (g_mismatches++ < MAXREPORTS) {
+        std::cerr << "Mismatch: " << what << "\n";
+    }
+}
+
+/**
+ * Every match of pattern in data, one find() after another.
+ */
+std::vector<size_t> findAll(const std::vector<uint8_t>& data, const Ra2ob::tagPattern& pattern) {
+    std::vector<size_t> ret;
+    size_t at = PatternScanner::find(data.data(), data.size(), pattern);
+
+    while (at != Ra2ob::SCANNOTFOUND) {
+        ret.push_back(at);
+        at = PatternScanner::find(data.data(), data.size(), pattern, at + 1);
+    }
+
+    return ret;
+}
+
+/**
+ * One random buffer and pattern, bytes from a small alphabet so that the first and last
+ * solid bytes often match without the rest.
+ */
+int checkPattern(std::mt19937& rng) {
+    std::vector<uint8_t> data(rng() % 200);
+    int length = 1 + rng() % 24;
+
+    for (auto& b : data) {
+        b = static_cast<uint8_t>(rng() % 3);
+    }
+
+    std::string text;
+    std::vector<int> bytes(length);
+
+    for (int i = 0; i < length; i++) {
+        bool edge = i == 0 || i == length - 1;
+        bool wild = rng() % (edge ? 2 : 4) == 0;
+        char hex[4];
+
+        bytes[i] = wild ? -1 : static_cast<int>(rng() % 3);
+        std::snprintf(hex, sizeof(hex), "%02X", bytes[i] < 0 ? 0 : bytes[i]);
+        text += (i == 0 ? "" : " ") + std::string(wild ? "??" : hex);
+    }
+
+    Ra2ob::tagPattern pattern;
+    if (!PatternScanner::parse(text, &pattern)) {
+        return 0;  // All wildcards.
+    }
+
+    // A match ending at the last byte, where the vector loops hand over to the scalar tail.
+    if (data.size() >= static_cast<size_t>(length) && rng() % 2 == 0) {
+        size_t at = data.size() - length;
+
+        for (int i = 0; i < length; i++) {
+            if (bytes[i] >= 0) {
+                data[at + i] = static_cast<uint8_t>(bytes[i]);
+            }
+        }
+    }
+
+    PatternScanner::setLevel(ScanLevel::Scalar);
+    std::vector<size_t> want = findAll(data, pattern);
+
+    for (size_t l = 1; l < g_levels.size(); l++) {
+        PatternScanner::setLevel(g_levels[l]);
+
+        if (findAll(data, pattern) != want) {
+            mismatch(std::string(levelName(g_levels[l])) + " find(\"" + text + "\") in " +
+                     std::to_string(data.size()) + " bytes");
+        }
+    }
+
+    return static_cast<int>(want.size());
+}
+
+/**
+ * A value for a slot: near zero, near the sign bit, or anything. Floats get NaNs, infinities,
+ * denormals and values within SEARCHFLOATEPS of each other.
+ */
+uint64_t randomSlot(std::mt19937& rng, Ra2ob::FieldType type, int size) {
+    if (type == Ra2ob::FieldType::Float) {
+        static const double values[] = {0.0, -0.0, 1.0, 1.0005, -1.0, 2.5, 1e-40, 1e30,
+                                        std::numeric_limits<double>::infinity(),
+                                        std::numeric_limits<double>::quiet_NaN()};
+        double v     = values[rng() % (sizeof(values) / sizeof(values[0]))];
+        uint64_t ret = 0;
+
+        if (size == 4) {
+            float f = static_cast<float>(v);
+            std::memcpy(&ret, &f, 4);
+        } else {
+            std::memcpy(&ret, &v, 8);
+        }
+        return ret;
+    }
+
+    uint64_t sign = 1ull << (size * 8 - 1);
+    uint64_t near = static_cast<uint64_t>(static_cast<int>(rng() % 5) - 2);
+
+    switch (rng() % 3) {
+        case 0:
+            return near;
+        case 1:
+            return sign + near;
+        default:
+            return (static_cast<uint64_t>(rng()) << 32) | rng();
+    }
+}
+
+/**
+ * What Scalar and each other level keep inside mem after the same filters.
+ */
+std::vector<uint32_t> candidates(const ValueSearch& search) {
+    std::vector<uint32_t> ret;
+
+    for (uint32_t addr : search.results(search.count())) {
+        if (addr >= SELFBASE && addr - SELFBASE < SELFSIZE) {
+            ret.push_back(addr);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * SEARCHSTEPS random filters on one slot type, each level with its own search, all of them
+ * reading the same memory.
+ */
+int checkSearch(std::mt19937& rng, Reader self, uint8_t* mem, Ra2ob::FieldType type, int size) {
+    static const SearchOp ops[] = {SearchOp::Changed,   SearchOp::Unchanged,
+                                   SearchOp::Increased, SearchOp::Decreased,
+                                   SearchOp::ChangedBy, SearchOp::Equal};
+
+    std::vector<ValueSearch> searches(g_levels.size(), ValueSearch(type, size));
+    uint64_t mask = size == 8 ? ~0ull : (1ull << (size * 8)) - 1;
+    int slots     = SELFSIZE / size;
+    int kept      = 0;
+
+    for (int s = 0; s < slots; s++) {
+        uint64_t v = randomSlot(rng, type, size);
+        std::memcpy(mem + s * size, &v, size);
+    }
+
+    for (auto& search : searches) {
+        search.snapshot(self);
+    }
+
+    for (int step = 0; step < SEARCHSTEPS; step++) {
+        // Equal first, leaving few candidates in the rest of the process, which is not compared.
+        SearchOp op    = step == 0 ? SearchOp::Equal : ops[rng() % 6];
+        int delta      = static_cast<int>(rng() % 5) - 2;
+        double operand = type == Ra2ob::FieldType::Float ? 1.0 : delta;
+
+        for (int s = 0; s < slots; s++) {
+            uint8_t* at = mem + s * size;
+            uint64_t v  = 0;
+
+            std::memcpy(&v, at, size);
+
+            switch (rng() % 4) {
+                case 0:
+                    break;
+                case 1:
+                    v = randomSlot(rng, type, size);
+                    break;
+                default:
+                    v = type == Ra2ob::FieldType::Float ? randomSlot(rng, type, size)
+                                                        : (v + static_cast<uint64_t>(delta)) & mask;
+            }
+
+            std::memcpy(at, &v, size);
+        }
+
+        std::vector<uint32_t> want;
+
+        for (size_t l = 0; l < g_levels.size(); l++) {
+            PatternScanner::setLevel(g_levels[l]);
+            searches[l].filter(self, op, operand);
+
+            std::vector<uint32_t> got = candidates(searches[l]);
+
+            if (l == 0) {
+                want = got;
+            } else if (got != want) {
+                mismatch(std::string(levelName(g_levels[l])) + " filter " + opName(op) + " on " +
+                         Ra2ob::PathPlan::fieldTypeName(type) + " " + std::to_string(size) +
+                         ", step " + std::to_string(step) + ": " + std::to_string(got.size()) +
+                         " candidates, Scalar " + std::to_string(want.size()));
+            }
+        }
+
+        kept += static_cast<int>(want.size());
+    }
+
+    return kept;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds    = 2000;
+    uint32_t seed = 1;
+    bool usage    = false;
+
+    for (int i = 1; i < argc; i += 2) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (value == nullptr) {
+            usage = true;
+        } else if (std::strcmp(argv[i], "--rounds") == 0) {
+            rounds = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--seed") == 0) {
+            seed = static_cast<uint32_t>(std::atoi(value));
+        } else {
+            usage = true;
+        }
+    }
+
+    if (usage) {
+        std::cerr << "Usage: ra2ob_simd [--rounds n] [--seed n]\n";
+        return 1;
+    }
+
+    PatternScanner::setLevel(ScanLevel::Avx2);
+    ScanLevel best = PatternScanner::level();
+
+    for (int l = 0; l <= static_cast<int>(best); l++) {
+        g_levels.push_back(static_cast<ScanLevel>(l));
+    }
+
+    if (g_levels.size() == 1) {
+        std::cout << "No SIMD level on this CPU, only Scalar runs.\n";
+    }
+
+    for (size_t l = 1; l < g_levels.size(); l++) {
+        std::cout << "Checking " << levelName(g_levels[l]) << " against Scalar.\n";
+    }
+
+    std::mt19937 rng(seed);
+    long matches = 0;
+
+    for (int i = 0; i < rounds; i++) {
+        matches += checkPattern(rng);
+    }
+
+    std::cout << rounds << " patterns, " << matches << " matches.\n";
+
+    uint8_t* mem = nullptr;
+    Reader self  = mapSelf(&mem);
+
+    if (self.attached()) {
+        const Ra2ob::FieldType types[] = {Ra2ob::FieldType::Int, Ra2ob::FieldType::Uint,
+                                          Ra2ob::FieldType::Float};
+        const int sizes[] = {1, 2, 4, 8};
+        long kept         = 0;
+        int searches      = 0;
+
+        for (int i = 0; i < std::max(1, rounds / 100); i++) {
+            for (auto type : types) {
+                for (int size : sizes) {
+                    if (Ra2ob::PathPlan::validSize(type, size)) {
+                        kept += checkSearch(rng, self, mem, type, size);
+                        searches++;
+                    }
+                }
+            }
+        }
+
+        std::cout << searches << " searches of " << SEARCHSTEPS << " filters, " << kept
+                  << " candidates kept.\n";
+    }
+
+    PatternScanner::setLevel(best);
+
+    std::cout << g_mismatches << " mismatches.\n";
+
+    return g_mismatches == 0 ? 0 : 1;
+}